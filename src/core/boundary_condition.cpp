@@ -16,6 +16,8 @@
 
 #include "core/boundary_condition.hpp"
 
+#include <algorithm>
+
 #include "util/error.hpp"
 
 namespace mocc {
@@ -84,6 +86,18 @@ BoundaryCondition::BoundaryCondition(const BoundaryCondition &rhs)
     return;
 }
 
+void BoundaryCondition::copy_all(real_t *out) const
+{
+    std::copy(data_.dataFirst(), data_.dataFirst() + data_.size(), out);
+    return;
+}
+
+void BoundaryCondition::set_all(const real_t *in)
+{
+    std::copy(in, in + data_.size(), data_.dataFirst());
+    return;
+}
+
 void BoundaryCondition::initialize_scalar(real_t val)
 {
     // Start with all zeros
@@ -142,20 +156,23 @@ void BoundaryCondition::initialize_spectrum(const ArrayB1 &spectrum)
     return;
 }
 
-void BoundaryCondition::update(int group, const BoundaryCondition &out)
+void BoundaryCondition::update(int group, const BoundaryCondition &out,
+                               int out_group)
 {
-    assert(out.n_group_ == 1);
+    assert(out_group < out.n_group_);
 
     for (int iang = 0; iang < n_angle_; iang++) {
-        this->update(group, iang, out);
+        this->update(group, iang, out, out_group);
     }
     return;
 }
 
 void BoundaryCondition::update(int group, int angle,
-                               const BoundaryCondition &out)
+                               const BoundaryCondition &out, int out_group)
 {
-    int group_offset = bc_per_group_ * group;
+    assert(out_group < out.n_group_);
+    int group_offset     = bc_per_group_ * group;
+    int out_group_offset = out.bc_per_group_ * out_group;
 
     for (Normal n : AllNormals) {
         int size    = size_[angle][(int)n];
@@ -167,18 +184,21 @@ void BoundaryCondition::update(int group, int angle,
         assert(iang_in < n_angle_);
         const auto &angle_in = ang_quad_[iang_in];
         int offset_in        = group_offset + offset_(iang_in, (int)n);
-        int offset_out       = out.offset_(angle, (int)n);
-        ;
+        int offset_out = out_group_offset + out.offset_(angle, (int)n);
 
+        // Work through raw pointers rather than blitz slices, so that
+        // different groups may be updated concurrently
+        real_t *in = &data_(offset_in);
         switch (bc_[(int)(angle_in.upwind_surface(n))]) {
         case Boundary::VACUUM:
-            data_(blitz::Range(offset_in, offset_in + size - 1)) = 0.0;
+            std::fill(in, in + size, 0.0);
             break;
 
-        case Boundary::REFLECT:
-            data_(blitz::Range(offset_in, offset_in + size - 1)) =
-                out.data_(blitz::Range(offset_out, offset_out + size - 1));
+        case Boundary::REFLECT: {
+            const real_t *o = &out.data_(offset_out);
+            std::copy(o, o + size, in);
             break;
+        }
 
         case Boundary::PRESCRIBED:
             break;
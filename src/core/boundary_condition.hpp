@@ -104,6 +104,18 @@ public:
      */
     void initialize_spectrum(const ArrayB1 &spectrum);
 
+    /**
+     * \brief Copy all of the boundary values, for all groups, to the passed
+     * buffer, which must have room for \ref size() values.
+     */
+    void copy_all(real_t *out) const;
+
+    /**
+     * \brief Set all of the boundary values, for all groups, from the passed
+     * buffer.
+     */
+    void set_all(const real_t *in);
+
     /**
      * \brief Return a const pointer to the beginning of a boundary
      * condition face
@@ -169,12 +181,15 @@ public:
      *
      * \param group the energy group to update
      * \param out the "outgoing" angular flux boundary condition to use in
-     * the update. It should only have one group of storage
+     * the update. This usually only has one group of storage
+     * \param out_group the group of \p out from which to take the outgoing
+     * values. Only useful when \p out stores a block of groups, as with the
+     * group-batched MoC sweep.
      *
      * This would be used for a Jacobi-style iteration on the boundary
      * source.
      */
-    void update(int group, const BoundaryCondition &out);
+    void update(int group, const BoundaryCondition &out, int out_group = 0);
 
     /**
      * \brief Update the boundary condition from a single outgoing angle for
@@ -182,8 +197,10 @@ public:
      *
      * \param group the energy group to treat
      * \param angle the angle index of the outgoing angle. See below.
-     * \param out a single-group \ref BoundaryCondition object storing the
-     * outgoing boundary values to use.
+     * \param out a \ref BoundaryCondition object storing the outgoing
+     * boundary values to use. Usually single-group.
+     * \param out_group the group of \p out from which to take the outgoing
+     * values.
      *
      * This would be used for a Gauss-Seidel-style iteration on the boundary
      * source.
@@ -192,7 +209,8 @@ public:
      * on the various domain boundary conditions, corresponding boundary
      * values may be updated on \c this
      */
-    void update(int group, int angle, const BoundaryCondition &out);
+    void update(int group, int angle, const BoundaryCondition &out,
+                int out_group = 0);
 
     friend std::ostream &operator<<(std::ostream &os,
                                     const BoundaryCondition &bc);
@@ -16,7 +16,9 @@
 
 #include "cmfd.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <exception>
 #include <iomanip>
 #include <string>
 #include <vector>
@@ -24,6 +26,7 @@
 #include "util/error.hpp"
 #include "util/files.hpp"
 #include "util/global_config.hpp"
+#include "util/string_utils.hpp"
 #include "util/validate_input.hpp"
 
 typedef Eigen::Triplet<mocc::real_t> T;
@@ -32,8 +35,18 @@ typedef Eigen::SparseMatrix<mocc::real_t> M;
 namespace {
 using namespace mocc;
 const std::vector<std::string> recognized_attributes = {
-    "enabled",  "k_tol",          "psi_tol",     "residual_reduction",
-    "max_iter", "negative_fixup", "dump_current"};
+    "enabled",        "k_tol",
+    "psi_tol",        "residual_reduction",
+    "max_iter",       "negative_fixup",
+    "dump_current",   "wielandt_shift",
+    "coupled",        "preconditioner",
+    "preconditioner_tol", "two_level",
+    "update_tol",     "energy_collapse"};
+
+// When using a Wielandt shift, keep the shift at least this many times the
+// most recent change in k, so that early iterations with a poor estimate of k
+// don't shift past the fundamental mode.
+const mocc::real_t wielandt_dk_factor = 10.0;
 
 /**
  * \brief Helper function for making the CMFD mesh
@@ -61,7 +74,16 @@ Mesh make_cmfd_mesh(const CoreMesh *mesh)
 namespace mocc {
 CMFD::CMFD(const pugi::xml_node &input, const CoreMesh *mesh,
            SP_XSMeshHomogenized_t xsmesh)
-    : timer_(RootTimer.new_timer("CMFD", true)),
+    : CMFD(input, mesh, xsmesh, RootTimer, true)
+{
+    return;
+}
+
+CMFD::CMFD(const pugi::xml_node &input, const CoreMesh *mesh,
+           SP_XSMeshHomogenized_t xsmesh, Timer &parent_timer,
+           bool allow_collapse)
+    : timer_(parent_timer.new_timer(allow_collapse ? "CMFD" : "Collapsed CMFD",
+                                    true)),
       timer_init_(timer_.new_timer("Initialization", true)),
       timer_setup_(timer_.new_timer("Setup Linear System")),
       timer_solve_(timer_.new_timer("Solve")),
@@ -84,13 +106,21 @@ CMFD::CMFD(const pugi::xml_node &input, const CoreMesh *mesh,
       d_tilde_(n_surf_, n_group_),
       s_hat_(n_surf_, n_group_),
       s_tilde_(n_surf_, n_group_),
+      xsrm_(n_cell_, n_group_),
+      rows_skipped_(n_group_, 0),
       n_solve_(0),
       k_tol_(1.0e-6),
       psi_tol_(1.0e-5),
       resid_reduction_(0.001),
       max_iter_(100),
       zero_fixup_(false),
-      dump_current_(false)
+      dump_current_(false),
+      coupled_(false),
+      two_level_(false),
+      update_tol_(0.0),
+      wielandt_shift_(0.0),
+      k_shift_(0.0),
+      precond_tol_(0.01)
 {
     // Check input attributes
     validate_input(input, recognized_attributes);
@@ -113,6 +143,7 @@ CMFD::CMFD(const pugi::xml_node &input, const CoreMesh *mesh,
         m.setFromTriplets(structure.begin(), structure.end());
         m.makeCompressed();
     }
+    m_1g_ = m_.front();
 
     // Parse options from the XML, if present
     if (!input.empty()) {
@@ -161,6 +192,124 @@ CMFD::CMFD(const pugi::xml_node &input, const CoreMesh *mesh,
         if (!input.attribute("dump_current").empty()) {
             dump_current_ = input.attribute("dump_current").as_bool(false);
         }
+
+        // Wielandt shift
+        if (!input.attribute("wielandt_shift").empty()) {
+            wielandt_shift_ = input.attribute("wielandt_shift").as_float(-1.0);
+            if (wielandt_shift_ <= 0.0) {
+                throw EXCEPT("Wielandt shift is invalid.");
+            }
+        }
+
+        // Coupled multigroup solve
+        if (!input.attribute("coupled").empty()) {
+            coupled_ = input.attribute("coupled").as_bool(false);
+        }
+
+        // Incremental matrix updates
+        if (!input.attribute("update_tol").empty()) {
+            update_tol_ = input.attribute("update_tol").as_float(-1.0);
+            if (update_tol_ < 0.0) {
+                throw EXCEPT("Update tolerance is invalid.");
+            }
+            // The homogenized cross sections are shared with the sweeper
+            // that provided them (e.g. the Sn sweeper in 2D3D), which should
+            // not be left with the stale cross sections of skipped pins.
+            // Skip them in a private copy instead.
+            if (update_tol_ > 0.0) {
+                xsmesh_.detach();
+                xsmesh_.set_update_tolerance(update_tol_);
+            }
+        }
+
+        // Two-level acceleration
+        if (!input.attribute("two_level").empty()) {
+            two_level_ = input.attribute("two_level").as_bool(false);
+        }
+    }
+
+    // The Wielandt shift is only implemented for the coupled solve
+    if (wielandt_shift_ > 0.0) {
+        coupled_ = true;
+    }
+
+    // Preconditioner for the coupled solve
+    auto precond_type = CMFDPreconditioner::Type::ILU;
+    if (!input.attribute("preconditioner").empty()) {
+        std::string in_str = input.attribute("preconditioner").value();
+        sanitize(in_str);
+        if (in_str == "ilu") {
+            precond_type = CMFDPreconditioner::Type::ILU;
+        } else if (in_str == "block_jacobi") {
+            precond_type = CMFDPreconditioner::Type::BLOCK_JACOBI;
+        } else if (in_str == "diagonal") {
+            precond_type = CMFDPreconditioner::Type::DIAGONAL;
+        } else {
+            throw EXCEPT("Unrecognized CMFD preconditioner: " + in_str);
+        }
+    }
+    solver_mg_.preconditioner().configure(precond_type, n_cell_, n_group_);
+
+    if (!input.attribute("preconditioner_tol").empty()) {
+        precond_tol_ = input.attribute("preconditioner_tol").as_float(-1.0);
+        if (precond_tol_ < 0.0) {
+            throw EXCEPT("Preconditioner tolerance is invalid.");
+        }
+    }
+
+    // Energy collapse
+    if (allow_collapse && !input.attribute("energy_collapse").empty()) {
+        VecI n_fine =
+            explode_string<int>(input.attribute("energy_collapse").value());
+        int n_total = 0;
+        for (int n : n_fine) {
+            if (n < 1) {
+                throw EXCEPT("Invalid number of groups in energy collapse.");
+            }
+            n_total += n;
+        }
+        if (n_total != n_group_) {
+            throw EXCEPT("Energy collapse does not match the number of "
+                         "groups.");
+        }
+
+        if ((int)n_fine.size() < n_group_) {
+            coarse_group_.reserve(n_group_);
+            for (int cg = 0; cg < (int)n_fine.size(); cg++) {
+                coarse_group_.insert(coarse_group_.end(), n_fine[cg], cg);
+            }
+
+            // Start from a flat spectrum. The real collapse happens at the
+            // beginning of each solve.
+            auto xsmesh_collapsed =
+                std::make_shared<XSMeshHomogenized>(xsmesh_, coarse_group_);
+            ArrayB2 flat(n_cell_, n_group_);
+            flat = 1.0;
+            xsmesh_collapsed->collapse(xsmesh_, flat);
+            collapsed_.reset(
+                new CMFD(input, mesh, xsmesh_collapsed, timer_, false));
+
+            // The solution options belong to the collapsed system
+            coupled_        = false;
+            two_level_      = false;
+            wielandt_shift_ = 0.0;
+
+            LogFile << "CMFD collapsed to " << n_fine.size() << " groups"
+                    << std::endl;
+        }
+    }
+
+    // The block-Jacobi preconditioner stores and inverts a dense block of
+    // n_group^2 entries for every cell, which gets out of hand for large
+    // group structures
+    if (coupled_ &&
+        (precond_type == CMFDPreconditioner::Type::BLOCK_JACOBI) &&
+        (n_group_ > CMFDPreconditioner::max_block_groups)) {
+        std::stringstream msg;
+        msg << "Block-Jacobi CMFD preconditioner is limited to "
+            << CMFDPreconditioner::max_block_groups
+            << " groups. Use the ILU preconditioner or an energy_collapse.";
+        throw EXCEPT(msg.str());
     }
 
     timer_.toc();
@@ -189,6 +338,20 @@ void CMFD::solve(real_t &k)
     // Set up the linear systems
     this->setup_solve();
 
+    if (collapsed_) {
+        timer_solve_.tic();
+        this->solve_collapsed(k);
+        this->store_currents();
+
+        solve_iterations_.push_back(collapsed_->solve_iterations_.back());
+        solve_shift_.push_back(collapsed_->solve_shift_.back());
+        n_solve_++;
+
+        timer_solve_.toc();
+        timer_.toc();
+        return;
+    }
+
     timer_solve_.tic();
 
     real_t k_old = k;
@@ -209,9 +372,14 @@ void CMFD::solve(real_t &k)
               << std::endl;
     LogScreen.flags(flags);
 
+    if (coupled_) {
+        solver_mg_.setTolerance(resid_reduction_ * r0);
+    }
+
     int iter       = 0;
     real_t psi_err = 1.0;
     real_t ri      = 0.0; // Iteration residual
+    k_shift_       = 0.0;
     while (true) {
         iter++;
         // Compute fission source
@@ -219,20 +387,44 @@ void CMFD::solve(real_t &k)
         this->fission_source(k);
         real_t tfis_old = tfis;
 
+        // Pick the Wielandt shift for this iteration. The first iteration
+        // has no estimate of the change in k, so it goes unshifted.
+        real_t rk_shift = 0.0;
+        if ((wielandt_shift_ > 0.0) && (iter > 1)) {
+            k_shift_ = k + std::max(wielandt_shift_,
+                                    wielandt_dk_factor * std::abs(k - k_old));
+            rk_shift = 1.0 / k_shift_;
+        }
+
         ri = 0.0;
-        for (int group = 0; group < n_group_; group++) {
-            source_.initialize_group(group);
-            source_.fission(fs_, group);
-            source_.in_scatter(group);
-            source_.scale(mesh_.coarse_volume());
+        if (coupled_) {
+            ri = this->solve_coupled(k, rk_shift);
+        } else {
+            for (int group = 0; group < n_group_; group++) {
+                source_.initialize_group(group);
+                source_.fission(fs_, group);
+                source_.in_scatter(group);
+                source_.scale(mesh_.coarse_volume());
 
-            ri += this->solve_1g(group);
+                ri += this->solve_1g(group);
+            }
         }
         ri = std::sqrt(ri) / (n_cell_ * n_group_);
 
         tfis  = this->total_fission();
         k_old = k;
-        k     = k * tfis / tfis_old;
+        if (rk_shift > 0.0) {
+            // The eigenvalue of the shifted system is 1/k - 1/k_s
+            real_t lambda = (1.0 / k - rk_shift) * tfis_old / tfis;
+            k             = 1.0 / (rk_shift + lambda);
+        } else {
+            k = k * tfis / tfis_old;
+        }
+
+        if (two_level_) {
+            this->solve_two_level(k, r0);
+            tfis = this->total_fission();
+        }
 
         // Convergence check
         psi_err = 0.0;
@@ -271,6 +463,9 @@ void CMFD::solve(real_t &k)
     // Calculate the resultant currents and store back onto the coarse data
     this->store_currents();
 
+    solve_iterations_.push_back(iter);
+    solve_shift_.push_back(k_shift_);
+
     n_solve_++;
 
     timer_solve_.toc();
@@ -278,6 +473,18 @@ void CMFD::solve(real_t &k)
     return;
 } // solve()
 
+void CMFD::reset()
+{
+    n_solve_ = 0;
+    k_shift_ = 0.0;
+    xsmesh_.reset_update();
+    precond_mg_.resize(0, 0);
+    if (collapsed_) {
+        collapsed_->reset();
+    }
+    return;
+}
+
 real_t CMFD::solve_1g(int group)
 {
     ArrayB1 flux_1g = coarse_data_.flux(blitz::Range::all(), group);
@@ -334,223 +541,587 @@ void CMFD::setup_solve()
 {
     timer_setup_.tic();
 
+    // Construct the system matrix for each group. The groups are independent,
+    // so they are set up concurrently. Exceptions may not leave the parallel
+    // region, so the first one is stashed and re-thrown afterwards.
+    bool incremental = (update_tol_ > 0.0) && (n_solve_ > 0);
+    std::exception_ptr setup_error = nullptr;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int group = 0; group < n_group_; group++) {
+        try {
+            this->setup_group(group, incremental);
+        } catch (...) {
+#pragma omp critical
+            if (!setup_error) {
+                setup_error = std::current_exception();
+            }
+        }
+    }
+    if (setup_error) {
+        std::rethrow_exception(setup_error);
+    }
+
+    if (coupled_) {
+        this->setup_multigroup();
+    }
+
+    timer_setup_.toc();
+    return;
+} // setup_solve
+
+void CMFD::setup_group(int group, bool incremental)
+{
     const Mesh::BCArray_t bc = mesh_.boundary_array();
-    // Construct the system matrix
 
     int nz        = fine_mesh_->nz();
     int n_mplanes = fine_mesh_->n_macroplanes();
-    int group     = 0;
-    for (auto &m : m_) {
-        // Diffusion coefficients
-        VecF d_coeff(n_cell_);
-        VecF xsrm(n_cell_);
-        for (const auto &xsr : xsmesh_) {
-            real_t d  = 1.0 / (3.0 * xsr.xsmactr(group));
-            real_t rm = xsr.xsmacrm(group);
-            for (const int i : xsr.reg()) {
-                d_coeff[i] = d;
-                xsrm[i]    = rm;
-            }
+    auto &m       = m_[group];
+
+    // Diffusion coefficients
+    VecF d_coeff(n_cell_);
+    VecF xsrm(n_cell_);
+    for (const auto &xsr : xsmesh_) {
+        real_t d  = 1.0 / (3.0 * xsr.xsmactr(group));
+        real_t rm = xsr.xsmacrm(group);
+        for (const int i : xsr.reg()) {
+            d_coeff[i] = d;
+            xsrm[i]    = rm;
         }
+    }
 
-        // Surface diffusivity (d_tilde) and non-linear correction coefficient
-        // (d_hat) There are lots of options to optimize this, mostly algebraic
-        // simplifications, but this is very conformal to the canonical
-        // formulations of CMFD found in the literature. If this starts taking
-        // too much time, optimize.
-        ArrayB1 d_tilde = d_tilde_(blitz::Range::all(), group);
-        ArrayB1 d_hat   = d_hat_(blitz::Range::all(), group);
-        ArrayB1 s_tilde = s_tilde_(blitz::Range::all(), group);
-        ArrayB1 s_hat   = s_hat_(blitz::Range::all(), group);
+    // Homogenize the currents to a coarser axial mesh. This is all done with
+    // element access, rather than blitz slices, since slicing touches the
+    // reference count of the underlying arrays, which isn't thread safe.
+    VecF current(n_surf_, 0.0);
+    if (n_mplanes != nz) {
+        for (int iz = 0; iz < nz; iz++) {
+            int mplane     = fine_mesh_->macroplane_index(iz);
+            real_t dz      = fine_mesh_->dz(iz);
+            int stt_fine   = fine_mesh_->plane_surf_xy_begin(iz);
+            int stp_fine   = fine_mesh_->plane_surf_end(iz);
+            int stt_coarse = mesh_.plane_surf_xy_begin(mplane);
+            for (int is = 0; is < stp_fine - stt_fine; is++) {
+                current[stt_coarse + is] +=
+                    dz * coarse_data_.current(stt_fine + is, group);
+            }
+        }
+        // Normalize the radial currents
+        for (int iz = 0; iz < (int)mesh_.nz(); iz++) {
+            int stt = mesh_.plane_surf_xy_begin(iz);
+            int stp = mesh_.plane_surf_end(iz);
+            // since we are using the separate CMFD mesh, the dz here is the
+            // macroplane height, which we want
+            for (int is = stt; is < stp; is++) {
+                current[is] /= mesh_.dz(iz);
+            }
+        }
 
-        // Homogenize the currents to a coarser axial mesh
-        if (fine_mesh_->n_macroplanes() != nz) {
-            current_1g_        = 0.0;
-            int current_mplane = 0;
-            for (int iz = 0; iz < nz; iz++) {
-                int mplane     = fine_mesh_->macroplane_index(iz);
-                real_t dz      = fine_mesh_->dz(iz);
-                int stt_fine   = fine_mesh_->plane_surf_xy_begin(iz);
-                int stp_fine   = fine_mesh_->plane_surf_end(iz) - 1;
-                int stt_coarse = mesh_.plane_surf_xy_begin(mplane);
-                int stp_coarse = mesh_.plane_surf_end(mplane) - 1;
-                current_1g_(blitz::Range(stt_coarse, stp_coarse)) +=
-                    dz *
-                    coarse_data_.current(blitz::Range(stt_fine, stp_fine),
-                                         group);
-            }
-            // Normalize the radial currents
-            for (int iz = 0; iz < (int)mesh_.nz(); iz++) {
-                int stt = mesh_.plane_surf_xy_begin(iz);
-                int stp = mesh_.plane_surf_end(iz) - 1;
-                // since we are using the separate CMFD mesh, the dz here is the
-                // macroplane height, which we want
-                current_1g_(blitz::Range(stt, stp)) /= mesh_.dz(iz);
-            }
-
-            // Now apply the z-normal currents
-            current_mplane = -1;
-            for (int iz = 0; iz < nz; iz++) {
-                int mplane = fine_mesh_->macroplane_index(iz);
-                if (current_mplane != mplane) {
-                    int stt_fine   = fine_mesh_->plane_surf_begin(iz);
-                    int stp_fine   = fine_mesh_->plane_surf_xy_begin(iz) - 1;
-                    int stt_coarse = mesh_.plane_surf_begin(mplane);
-                    int stp_coarse = mesh_.plane_surf_xy_begin(mplane) - 1;
-                    current_1g_(blitz::Range(stt_coarse, stp_coarse)) =
-                        coarse_data_.current(blitz::Range(stt_fine, stp_fine),
-                                             group);
-                    current_mplane = mplane;
+        // Now apply the z-normal currents
+        int current_mplane = -1;
+        for (int iz = 0; iz < nz; iz++) {
+            int mplane = fine_mesh_->macroplane_index(iz);
+            if (current_mplane != mplane) {
+                int stt_fine   = fine_mesh_->plane_surf_begin(iz);
+                int stp_fine   = fine_mesh_->plane_surf_xy_begin(iz);
+                int stt_coarse = mesh_.plane_surf_begin(mplane);
+                for (int is = 0; is < stp_fine - stt_fine; is++) {
+                    current[stt_coarse + is] =
+                        coarse_data_.current(stt_fine + is, group);
                 }
+                current_mplane = mplane;
+            }
+        }
+        // Lastly, grab the top surface currents
+        int stt_fine   = fine_mesh_->plane_surf_begin(nz);
+        int stp_fine   = fine_mesh_->plane_surf_xy_begin(nz);
+        int stt_coarse = mesh_.plane_surf_begin(n_mplanes);
+        for (int is = 0; is < stp_fine - stt_fine; is++) {
+            current[stt_coarse + is] =
+                coarse_data_.current(stt_fine + is, group);
+        }
+    } else {
+        for (int is = 0; is < n_surf_; is++) {
+            current[is] = coarse_data_.current(is, group);
+        }
+    }
+
+    // Surface diffusivity (d_tilde) and non-linear correction coefficient
+    // (d_hat) There are lots of options to optimize this, mostly algebraic
+    // simplifications, but this is very conformal to the canonical
+    // formulations of CMFD found in the literature. If this starts taking
+    // too much time, optimize.
+    VecF d_tilde(n_surf_);
+    VecF d_hat(n_surf_);
+
+    // Loop over the surfaces in the mesh, and calculate the inter-cell
+    // coupling coefficients
+    for (int is = 0; is < n_surf_; is++) {
+        auto cells  = mesh_.coarse_neigh_cells(is);
+        Normal norm = mesh_.surface_normal(is);
+
+        real_t diffusivity_1 = 0.0;
+        real_t diffusivity_2 = 0.0;
+        if (cells.first > -1) {
+            diffusivity_1 =
+                d_coeff[cells.first] / mesh_.cell_thickness(cells.first, norm);
+        } else {
+            switch (bc[(int)(norm)][0]) {
+            case Boundary::REFLECT:
+                diffusivity_1 = 0.0 / 2.0;
+                break;
+            case Boundary::VACUUM:
+                diffusivity_1 = 0.5 / 2.0;
+                break;
+            default:
+                throw EXCEPT("Unsupported boundary type");
             }
-            // Lastly, grab the top surface currents
-            int stt_fine   = fine_mesh_->plane_surf_begin(nz);
-            int stp_fine   = fine_mesh_->plane_surf_xy_begin(nz) - 1;
-            int stt_coarse = mesh_.plane_surf_begin(n_mplanes);
-            int stp_coarse = mesh_.plane_surf_xy_begin(n_mplanes) - 1;
-            current_1g_(blitz::Range(stt_coarse, stp_coarse)) =
-                coarse_data_.current(blitz::Range(stt_fine, stp_fine), group);
+        }
+
+        if (cells.second > -1) {
+            diffusivity_2 = d_coeff[cells.second] /
+                            mesh_.cell_thickness(cells.second, norm);
         } else {
-            current_1g_ = coarse_data_.current(blitz::Range::all(), group);
+            switch (bc[(int)(norm)][1]) {
+            case Boundary::REFLECT:
+                diffusivity_2 = 0.0 / 2.0;
+                break;
+            case Boundary::VACUUM:
+                diffusivity_2 = 0.5 / 2.0;
+                break;
+            default:
+                throw EXCEPT("Unsupported boundary type");
+            }
         }
 
-        // Loop over the surfaces in the mesh, and calculate the inter-cell
-        // coupling coefficients
+        d_tilde[is] = 2.0 * diffusivity_1 * diffusivity_2 /
+                      (diffusivity_1 + diffusivity_2);
+
+        // S-tilde is a mess. Since surface flux is calculated as
+        // phi = s_tilde*flux_left + (1-s_tilde)*flux_right, there is an
+        // inherent binding to a cell, as well as a surface. We assume
+        // the convention that if possible the bound cell is the one to
+        // the "left" of the surface. When such a cell is not present
+        // (domain boundary), the cell is to the "right"
+        real_t stil = (diffusivity_1 > 0.0)
+                          ? diffusivity_1 / (diffusivity_1 + diffusivity_2)
+                          : diffusivity_2 / (diffusivity_1 + diffusivity_2);
+
+        s_tilde_(is, group) = stil;
+
+        // If we have currents defined from a transport sweeper or the
+        // like, calculate D-hat coefficients
+        bool have_data = norm == Normal::Z_NORM
+                             ? coarse_data_.has_axial_data()
+                             : coarse_data_.has_radial_data();
+        if (have_data) {
+            real_t j        = current[is];
+            real_t sfc_flux = coarse_data_.surface_flux(is, group);
+            real_t flux_l   = cells.first >= 0
+                                ? coarse_data_.flux(cells.first, group)
+                                : 0.0;
+            real_t flux_r = cells.second >= 0
+                                ? coarse_data_.flux(cells.second, group)
+                                : 0.0;
+            d_hat[is] =
+                (j + d_tilde[is] * (flux_r - flux_l)) / (flux_l + flux_r);
+            if (!std::isfinite(d_hat[is])) {
+                d_hat[is] = 0.0;
+            }
+            s_hat_(is, group) = (cells.first >= 0)
+                                    ? (sfc_flux - stil * flux_l -
+                                       (1.0 - stil) * flux_r) /
+                                          (flux_l + flux_r)
+                                    : (sfc_flux - stil * flux_r) / (flux_r);
+        } else {
+            d_hat[is]         = 0.0;
+            s_hat_(is, group) = 0.0;
+        }
+    } // surfaces
+
+    // Figure out which rows of the matrix need new coefficients. When doing
+    // an incremental update, surface coefficients that haven't changed beyond
+    // the tolerance keep their old values, so that the matrix stays
+    // consistent with what is stored in d_tilde_ and d_hat_.
+    std::vector<bool> dirty(n_cell_, true);
+    bool any_dirty = true;
+    if (incremental) {
+        any_dirty = false;
+        for (int i = 0; i < n_cell_; i++) {
+            dirty[i] = std::abs(xsrm[i] - xsrm_(i, group)) >
+                       update_tol_ * std::abs(xsrm_(i, group));
+        }
         for (int is = 0; is < n_surf_; is++) {
-            auto cells  = mesh_.coarse_neigh_cells(is);
-            Normal norm = mesh_.surface_normal(is);
-
-            real_t diffusivity_1 = 0.0;
-            real_t diffusivity_2 = 0.0;
-            if (cells.first > -1) {
-                diffusivity_1 = d_coeff[cells.first] /
-                                mesh_.cell_thickness(cells.first, norm);
-            } else {
-                switch (bc[(int)(norm)][0]) {
-                case Boundary::REFLECT:
-                    diffusivity_1 = 0.0 / 2.0;
-                    break;
-                case Boundary::VACUUM:
-                    diffusivity_1 = 0.5 / 2.0;
-                    break;
-                default:
-                    throw EXCEPT("Unsupported boundary type");
+            real_t scale =
+                std::abs(d_tilde_(is, group)) + std::abs(d_hat_(is, group));
+            bool changed =
+                (std::abs(d_tilde[is] - d_tilde_(is, group)) +
+                 std::abs(d_hat[is] - d_hat_(is, group))) > update_tol_ * scale;
+            if (changed) {
+                auto cells = mesh_.coarse_neigh_cells(is);
+                if (cells.first >= 0) {
+                    dirty[cells.first] = true;
+                }
+                if (cells.second >= 0) {
+                    dirty[cells.second] = true;
                 }
+            } else {
+                d_tilde[is] = d_tilde_(is, group);
+                d_hat[is]   = d_hat_(is, group);
             }
+        }
+        for (int i = 0; i < n_cell_; i++) {
+            any_dirty = any_dirty || dirty[i];
+        }
+    }
+    rows_skipped_[group] = std::count(dirty.begin(), dirty.end(), false);
 
-            if (cells.second > -1) {
-                diffusivity_2 = d_coeff[cells.second] /
-                                mesh_.cell_thickness(cells.second, norm);
-            } else {
-                switch (bc[(int)(norm)][1]) {
-                case Boundary::REFLECT:
-                    diffusivity_2 = 0.0 / 2.0;
-                    break;
-                case Boundary::VACUUM:
-                    diffusivity_2 = 0.5 / 2.0;
-                    break;
-                default:
-                    throw EXCEPT("Unsupported boundary type");
-                }
+    for (int is = 0; is < n_surf_; is++) {
+        d_tilde_(is, group) = d_tilde[is];
+        d_hat_(is, group)   = d_hat[is];
+    }
+    for (int i = 0; i < n_cell_; i++) {
+        if (dirty[i]) {
+            xsrm_(i, group) = xsrm[i];
+        } else {
+            xsrm[i] = xsrm_(i, group);
+        }
+    }
+
+    // With an energy collapse, the coefficients are only needed to
+    // reconstruct the currents, so there is nothing to assemble
+    if (any_dirty && !collapsed_) {
+        this->assemble_matrix(m, xsrm, d_tilde, d_hat, dirty);
+
+        // The one-group solvers are only needed for the group-by-group
+        // iteration
+        if (!coupled_) {
+            solvers_[group].compute(m);
+            solvers_[group].setMaxIterations(150);
+        }
+    }
+
+    return;
+}
+
+void CMFD::assemble_matrix(Eigen::SparseMatrix<real_t> &m, const VecF &xsrm,
+                           const VecF &d_tilde, const VecF &d_hat,
+                           const std::vector<bool> &dirty) const
+{
+    // put values into the matrix. Optimal access patterns in sparse
+    // matrix representations are not obvious, so the best way is to
+    // iterate through the matrix linearly and act according to the
+    // indices (i.e.  row/col) that we get for each coefficient.
+    for (int k = 0; k < m.outerSize(); k++) {
+        for (M::InnerIterator it(m, k); it; ++it) {
+            auto i = it.row();
+            auto j = it.col();
+            if (!dirty[i]) {
+                continue;
             }
+            if (i == j) {
+                // Diagonal element
+                real_t v = mesh_.coarse_volume(i) * xsrm[i];
+                for (auto is : AllSurfaces) {
+                    int surf = mesh_.coarse_surf(i, is);
+                    real_t a = mesh_.coarse_area(i, is);
+
+                    // Switch sign of D-hat if necessary
+                    real_t d_hat_ij = d_hat[surf];
+                    if ((is == Surface::WEST) || (is == Surface::SOUTH) ||
+                        (is == Surface::BOTTOM)) {
+                        d_hat_ij = -d_hat_ij;
+                    }
 
-            d_tilde(is) = 2.0 * diffusivity_1 * diffusivity_2 /
-                          (diffusivity_1 + diffusivity_2);
-
-            // S-tilde is a mess. Since surface flux is calculated as
-            // phi = s_tilde*flux_left + (1-s_tilde)*flux_right, there is an
-            // inherent binding to a cell, as well as a surface. We assume
-            // the convention that if possible the bound cell is the one to
-            // the "left" of the surface. When such a cell is not present
-            // (domain boundary), the cell is to the "right"
-            real_t stil = (diffusivity_1 > 0.0)
-                              ? diffusivity_1 / (diffusivity_1 + diffusivity_2)
-                              : diffusivity_2 / (diffusivity_1 + diffusivity_2);
-
-            s_tilde(is) = stil;
-
-            // If we have currents defined from a transport sweeper or the
-            // like, calculate D-hat coefficients
-            bool have_data = norm == Normal::Z_NORM
-                                 ? coarse_data_.has_axial_data()
-                                 : coarse_data_.has_radial_data();
-            if (have_data) {
-                real_t j        = current_1g_(is);
-                real_t sfc_flux = coarse_data_.surface_flux(is, group);
-                real_t flux_l   = cells.first >= 0
-                                    ? coarse_data_.flux(cells.first, group)
-                                    : 0.0;
-                real_t flux_r = cells.second >= 0
-                                    ? coarse_data_.flux(cells.second, group)
-                                    : 0.0;
-                d_hat(is) =
-                    (j + d_tilde(is) * (flux_r - flux_l)) / (flux_l + flux_r);
-                if (!std::isfinite(d_hat(is))) {
-                    d_hat(is) = 0.0;
+                    v += a * (d_tilde[surf] + d_hat_ij);
                 }
-                s_hat(is) = (cells.first >= 0)
-                                ? (sfc_flux - s_tilde(is) * flux_l -
-                                   (1.0 - s_tilde(is)) * flux_r) /
-                                      (flux_l + flux_r)
-                                : (sfc_flux - s_tilde(is) * flux_r) / (flux_r);
+                it.valueRef() = v;
             } else {
-                d_hat(is) = 0.0;
-                s_hat(is) = 0.0;
+                // off-diagonal element
+                auto pair       = mesh_.coarse_interface(i, j);
+                real_t a        = mesh_.coarse_area(i, pair.second);
+                int surf        = pair.first;
+                real_t d_hat_ij = d_hat[surf];
+                // Switch sign of D-hat if necessary
+                if ((pair.second == Surface::WEST) ||
+                    (pair.second == Surface::SOUTH) ||
+                    (pair.second == Surface::BOTTOM)) {
+                    d_hat_ij = -d_hat_ij;
+                }
+
+                real_t v      = a * (d_hat_ij - d_tilde[surf]);
+                it.valueRef() = v;
             }
-        } // surfaces
+        }
+    } // matrix element loop
+
+    return;
+}
+
+void CMFD::setup_multigroup()
+{
+    int n = n_cell_ * n_group_;
+
+    std::vector<T> loss;
+    std::vector<T> fission;
+    for (int group = 0; group < n_group_; group++) {
+        int offset = group * n_cell_;
 
-        // put values into the matrix. Optimal access patterns in sparse
-        // matrix representations are not obvious, so the best way is to
-        // iterate through the matrix linearly and act according to the
-        // indices (i.e.  row/col) that we get for each coefficient.
+        // Within-group loss
+        const auto &m = m_[group];
         for (int k = 0; k < m.outerSize(); k++) {
             for (M::InnerIterator it(m, k); it; ++it) {
-                auto i = it.row();
-                auto j = it.col();
-                if (i == j) {
-                    // Diagonal element
-                    real_t v = mesh_.coarse_volume(i) * xsrm[i];
-                    for (auto is : AllSurfaces) {
-                        int surf = mesh_.coarse_surf(i, is);
-                        real_t a = mesh_.coarse_area(i, is);
-
-                        // Switch sign of D-hat if necessary
-                        real_t d_hat_ij = d_hat(surf);
-                        if ((is == Surface::WEST) || (is == Surface::SOUTH) ||
-                            (is == Surface::BOTTOM)) {
-                            d_hat_ij = -d_hat_ij;
-                        }
-
-                        v += a * (d_tilde(surf) + d_hat_ij);
+                loss.push_back(
+                    T(offset + it.row(), offset + it.col(), it.value()));
+            }
+        }
+
+        for (const auto &xsr : xsmesh_) {
+            // In-scatter from other groups
+            const ScatteringRow &scat_row = xsr.xsmacsc().to(group);
+            int igg                       = scat_row.min_g;
+            for (auto sc : scat_row) {
+                if (igg != group) {
+                    for (const int i : xsr.reg()) {
+                        loss.push_back(T(offset + i, igg * n_cell_ + i,
+                                         -sc * mesh_.coarse_volume(i)));
                     }
-                    it.valueRef() = v;
-                } else {
-                    // off-diagonal element
-                    auto pair       = mesh_.coarse_interface(i, j);
-                    real_t a        = mesh_.coarse_area(i, pair.second);
-                    int surf        = pair.first;
-                    real_t d_hat_ij = d_hat(surf);
-                    // Switch sign of D-hat if necessary
-                    if ((pair.second == Surface::WEST) ||
-                        (pair.second == Surface::SOUTH) ||
-                        (pair.second == Surface::BOTTOM)) {
-                        d_hat_ij = -d_hat_ij;
+                }
+                igg++;
+            }
+
+            // Fission
+            real_t chi = xsr.xsmacch(group);
+            if (chi > 0.0) {
+                for (int ig = 0; ig < n_group_; ig++) {
+                    real_t chi_nf = chi * xsr.xsmacnf(ig);
+                    for (const int i : xsr.reg()) {
+                        fission.push_back(
+                            T(offset + i, ig * n_cell_ + i,
+                              chi_nf * mesh_.coarse_volume(i)));
                     }
+                }
+            }
+        }
+    }
+
+    loss_mg_.resize(n, n);
+    loss_mg_.setFromTriplets(loss.begin(), loss.end());
+    fission_mg_.resize(n, n);
+    fission_mg_.setFromTriplets(fission.begin(), fission.end());
+
+    x_mg_.resize(n);
+    b_mg_.resize(n);
+    solver_mg_.setMaxIterations(1000);
+
+    return;
+}
+
+real_t CMFD::solve_coupled(real_t k, real_t rk_shift)
+{
+    m_mg_ = loss_mg_ - rk_shift * fission_mg_;
+
+    // Only pay for a new preconditioner if the system has changed enough to
+    // make the old one stale
+    bool refactor = (precond_mg_.rows() != m_mg_.rows()) ||
+                    ((m_mg_ - precond_mg_).norm() >
+                     precond_tol_ * precond_mg_.norm());
+    if (refactor) {
+        precond_mg_ = m_mg_;
+    }
+    solver_mg_.preconditioner().freeze(!refactor);
+    solver_mg_.compute(m_mg_);
+
+    // Right-hand side is the fission source, scaled by (1/k - 1/k_s)/(1/k)
+    real_t scale = 1.0 - k * rk_shift;
+    for (int group = 0; group < n_group_; group++) {
+        int offset = group * n_cell_;
+        for (const auto &xsr : xsmesh_) {
+            real_t chi = xsr.xsmacch(group) * scale;
+            for (const int i : xsr.reg()) {
+                b_mg_[offset + i] = chi * fs_(i) * mesh_.coarse_volume(i);
+            }
+        }
+        for (int i = 0; i < n_cell_; i++) {
+            x_mg_[offset + i] = coarse_data_.flux(i, group);
+        }
+    }
+
+    real_t resid = (m_mg_ * x_mg_ - b_mg_).squaredNorm();
+
+    x_mg_ = solver_mg_.solveWithGuess(b_mg_, x_mg_);
+
+    for (int group = 0; group < n_group_; group++) {
+        int offset = group * n_cell_;
+        for (int i = 0; i < n_cell_; i++) {
+            coarse_data_.flux(i, group) = x_mg_[offset + i];
+        }
+    }
+
+    return resid;
+}
 
-                    real_t v      = a * (d_hat_ij - d_tilde(surf));
-                    it.valueRef() = v;
+void CMFD::solve_collapsed(real_t &k)
+{
+    CoarseData &coarse = collapsed_->coarse_data_;
+    int n_coarse       = collapsed_->n_group_;
+
+    // Restrict the cross sections, flux, currents and surface fluxes to the
+    // coarse groups
+    collapsed_->xsmesh_.collapse(xsmesh_, coarse_data_.flux);
+
+    VecI n_fine(n_coarse, 0);
+    coarse.flux         = 0.0;
+    coarse.current      = 0.0;
+    coarse.surface_flux = 0.0;
+    for (int ig = 0; ig < n_group_; ig++) {
+        int cg = coarse_group_[ig];
+        n_fine[cg]++;
+        for (int i = 0; i < (int)coarse.flux.extent(0); i++) {
+            coarse.flux(i, cg) += coarse_data_.flux(i, ig);
+        }
+        for (int is = 0; is < (int)coarse.current.extent(0); is++) {
+            coarse.current(is, cg) += coarse_data_.current(is, ig);
+            coarse.surface_flux(is, cg) += coarse_data_.surface_flux(is, ig);
+        }
+    }
+    coarse.set_has_radial_data(coarse_data_.has_radial_data());
+    coarse.set_has_axial_data(coarse_data_.has_axial_data());
+
+    ArrayB2 flux_restricted(coarse.flux.shape());
+    flux_restricted = coarse.flux;
+
+    collapsed_->solve(k);
+
+    // Prolong the change in the coarse-group flux back to the transport
+    // groups
+    for (int ig = 0; ig < n_group_; ig++) {
+        int cg = coarse_group_[ig];
+        for (int i = 0; i < (int)coarse.flux.extent(0); i++) {
+            real_t restricted = flux_restricted(i, cg);
+            if (restricted > 0.0) {
+                coarse_data_.flux(i, ig) *= coarse.flux(i, cg) / restricted;
+            } else {
+                coarse_data_.flux(i, ig) = coarse.flux(i, cg) / n_fine[cg];
+            }
+        }
+    }
+
+    return;
+} // solve_collapsed
+
+void CMFD::solve_two_level(real_t &k, real_t r0)
+{
+    // Restrict the multigroup flux and cross sections to one group
+    VecF flux_1g(n_cell_, 0.0);
+    VecF xsrm_1g(n_cell_, 0.0);
+    VecF xsnf_1g(n_cell_, 0.0);
+    for (const auto &xsr : xsmesh_) {
+        real_t chi = 0.0;
+        for (int ig = 0; ig < n_group_; ig++) {
+            chi += xsr.xsmacch(ig);
+        }
+        for (const int i : xsr.reg()) {
+            for (int ig = 0; ig < n_group_; ig++) {
+                real_t flux = coarse_data_.flux(i, ig);
+                flux_1g[i] += flux;
+                xsrm_1g[i] += xsr.xsmacrm(ig) * flux;
+                xsnf_1g[i] += chi * xsr.xsmacnf(ig) * flux;
+
+                // Scattering into other groups is not lost from the one-group
+                // system
+                const ScatteringRow &scat_row = xsr.xsmacsc().to(ig);
+                int igg                       = scat_row.min_g;
+                for (auto sc : scat_row) {
+                    if (igg != ig) {
+                        xsrm_1g[i] -= sc * coarse_data_.flux(i, igg);
+                    }
+                    igg++;
                 }
             }
-        } // matrix element loop
+        }
+    }
+    for (int i = 0; i < n_cell_; i++) {
+        xsrm_1g[i] /= flux_1g[i];
+        xsnf_1g[i] /= flux_1g[i];
+    }
 
-        solvers_[group].compute(m);
-        solvers_[group].setMaxIterations(150);
+    // Collapse the surface diffusivities with the flux on either side of each
+    // surface, and pick D-hats that preserve the multigroup net currents
+    VecF d_tilde_1g(n_surf_);
+    VecF d_hat_1g(n_surf_);
+    for (int is = 0; is < n_surf_; is++) {
+        auto cells    = mesh_.coarse_neigh_cells(is);
+        real_t j      = 0.0;
+        real_t d_flux = 0.0;
+        for (int ig = 0; ig < n_group_; ig++) {
+            real_t flux_l =
+                cells.first >= 0 ? coarse_data_.flux(cells.first, ig) : 0.0;
+            real_t flux_r =
+                cells.second >= 0 ? coarse_data_.flux(cells.second, ig) : 0.0;
+            j += -d_tilde_(is, ig) * (flux_r - flux_l) +
+                 d_hat_(is, ig) * (flux_r + flux_l);
+            d_flux += d_tilde_(is, ig) * (flux_r + flux_l);
+        }
+        real_t flux_l = cells.first >= 0 ? flux_1g[cells.first] : 0.0;
+        real_t flux_r = cells.second >= 0 ? flux_1g[cells.second] : 0.0;
+
+        d_tilde_1g[is] = d_flux / (flux_l + flux_r);
+        d_hat_1g[is] =
+            (j + d_tilde_1g[is] * (flux_r - flux_l)) / (flux_l + flux_r);
+        if (!std::isfinite(d_tilde_1g[is]) || !std::isfinite(d_hat_1g[is])) {
+            d_tilde_1g[is] = 0.0;
+            d_hat_1g[is]   = 0.0;
+        }
+    }
+
+    this->assemble_matrix(m_1g_, xsrm_1g, d_tilde_1g, d_hat_1g,
+                          std::vector<bool>(n_cell_, true));
+    solver_1g_.compute(m_1g_);
+    solver_1g_.setTolerance(resid_reduction_ * r0);
+
+    // Power iteration on the one-group system
+    VectorX x(n_cell_);
+    VectorX b(n_cell_);
+    for (int i = 0; i < n_cell_; i++) {
+        x[i] = flux_1g[i];
+    }
+    real_t k_1g = k;
+    real_t tfis = 0.0;
+    for (int i = 0; i < n_cell_; i++) {
+        tfis += xsnf_1g[i] * x[i] * mesh_.coarse_volume(i);
+    }
+    for (int iter = 0; iter < max_iter_; iter++) {
+        for (int i = 0; i < n_cell_; i++) {
+            b[i] = xsnf_1g[i] * x[i] * mesh_.coarse_volume(i) / k_1g;
+        }
+        x = solver_1g_.solveWithGuess(b, x);
+
+        real_t tfis_old = tfis;
+        tfis            = 0.0;
+        for (int i = 0; i < n_cell_; i++) {
+            tfis += xsnf_1g[i] * x[i] * mesh_.coarse_volume(i);
+        }
+        real_t k_old = k_1g;
+        k_1g         = k_1g * tfis / tfis_old;
+        if (std::abs(k_1g - k_old) < 0.1 * k_tol_) {
+            break;
+        }
+    }
+
+    // Prolong the change in the one-group flux back to the multigroup flux
+    for (int i = 0; i < n_cell_; i++) {
+        real_t ratio = x[i] / flux_1g[i];
+        if (!std::isfinite(ratio)) {
+            continue;
+        }
+        for (int ig = 0; ig < n_group_; ig++) {
+            coarse_data_.flux(i, ig) *= ratio;
+        }
+    }
+    k = k_1g;
 
-        group++;
-    } // group loop
-    timer_setup_.toc();
     return;
-} // setup_solve
+}
 
 void CMFD::store_currents()
 {
@@ -667,6 +1238,23 @@ real_t CMFD::residual(int group) const
 
 void CMFD::output(H5Node &node) const
 {
+    if (!solve_iterations_.empty()) {
+        // With an energy collapse, the solution options live on the
+        // collapsed CMFD
+        const CMFD &solver = collapsed_ ? *collapsed_ : *this;
+        auto g             = node.create_group("cmfd");
+        VecI dims(1, solve_iterations_.size());
+        g.write("iterations", solve_iterations_, dims);
+        if (solver.wielandt_shift_ > 0.0) {
+            g.write("shift", solve_shift_, dims);
+        }
+        if (solver.coupled_) {
+            VecI n_factor(
+                1, solver.solver_mg_.preconditioner().n_factorizations());
+            g.write("preconditioner_factorizations", n_factor, VecI(1, 1));
+        }
+    }
+
     if (!dump_current_) {
         return;
     }
@@ -704,7 +1292,11 @@ void CMFD::print(int iter, real_t k, real_t k_err, real_t psi_err,
     LogScreen << "       " << std::setprecision(5) << std::setw(6) << std::fixed
               << RootTimer.time() << " " << iter << " " << std::setprecision(10)
               << k << " " << std::scientific << k_err << " " << std::scientific
-              << psi_err << " " << std::scientific << resid_ratio << std::endl;
+              << psi_err << " " << std::scientific << resid_ratio;
+    if (k_shift_ > 0.0) {
+        LogScreen << " " << std::fixed << std::setprecision(5) << k_shift_;
+    }
+    LogScreen << std::endl;
     LogScreen.flags(flags);
     return;
 }
@@ -22,6 +22,7 @@
 
 #include "util/global_config.hpp"
 #include "util/timers.hpp"
+#include "cmfd_preconditioner.hpp"
 #include "coarse_data.hpp"
 #include "eigen_interface.hpp"
 #include "mesh.hpp"
@@ -31,6 +32,14 @@
 namespace mocc {
 class CMFD : public HasOutput {
 public:
+    /**
+     * \brief Construct a CMFD solver.
+     *
+     * If the input has an \c energy_collapse attribute, the CMFD system is
+     * solved in a coarser group structure. The attribute lists the number of
+     * consecutive transport groups in each CMFD group, starting from the
+     * highest energy. See \ref solve_collapsed().
+     */
     CMFD(const pugi::xml_node &input, const CoreMesh *mesh,
          SP_XSMeshHomogenized_t xsmesh);
 
@@ -90,6 +99,9 @@ public:
         assert(tol > REAL_FUZZ);
 
         k_tol_ = tol;
+        if (collapsed_) {
+            collapsed_->set_k_tolerance(tol);
+        }
         return;
     }
 
@@ -101,12 +113,62 @@ public:
         assert(tol > REAL_FUZZ);
 
         psi_tol_ = tol;
+        if (collapsed_) {
+            collapsed_->set_psi_tolerance(tol);
+        }
         return;
     }
 
+    /**
+     * \brief Return the number of matrix rows, summed over all groups, that
+     * were left alone by the most recent setup of the linear systems.
+     *
+     * This is only ever non-zero when doing incremental updates (\c
+     * update_tol).
+     */
+    int n_rows_skipped() const
+    {
+        int n = 0;
+        for (int ns : rows_skipped_) {
+            n += ns;
+        }
+        return n;
+    }
+
+    /**
+     * \brief Return the number of pins that were not re-homogenized by the
+     * most recent solve.
+     */
+    int n_pins_skipped() const
+    {
+        return xsmesh_.n_skipped();
+    }
+
+    /**
+     * \brief Forget everything carried over from previous solves.
+     *
+     * Following a reset, the next \ref solve() homogenizes every pin,
+     * assembles every row of the linear systems and factors a new
+     * preconditioner, so its result depends only on the \ref CoarseData and
+     * the eigenvalue that it is handed.
+     */
+    void reset();
+
     void output(H5Node &node) const;
 
 private:
+    /**
+     * \brief Construct a CMFD solver, with its timers under the passed
+     * \ref Timer.
+     *
+     * \param allow_collapse whether to honor the \c energy_collapse
+     * attribute. The collapsed CMFD is built from the same input, so it
+     * needs to ignore it.
+     */
+    CMFD(const pugi::xml_node &input, const CoreMesh *mesh,
+         SP_XSMeshHomogenized_t xsmesh, Timer &parent_timer,
+         bool allow_collapse);
+
     // Private methods
     /**
      * \brief Compute and return the L-2 norm of the residual of the CMFD
@@ -163,6 +225,115 @@ norm = std::sqrt(norm)/(n_cell_*n_group_);
     real_t residual(int group) const;
     real_t solve_1g(int group);
     void fission_source(real_t k);
+
+    /**
+     * \brief Assemble the coupled multigroup loss and fission operators.
+     *
+     * The multigroup loss operator contains the one-group matrices in \c m_
+     * along its diagonal blocks, and the inter-group scattering in the
+     * off-diagonal blocks. The fission operator contains \f$ V \chi_g
+     * \nu\Sigma_{f,g'}\f$. Unknowns are ordered group-major, so cell \c i of
+     * group \c g is at <tt>g*n_cell_ + i</tt>.
+     *
+     * \pre \ref setup_solve() has assembled the one-group matrices.
+     */
+    void setup_multigroup();
+
+    /**
+     * \brief Perform one (possibly Wielandt-shifted) inverse power iteration
+     * on the coupled multigroup system.
+     *
+     * \param k the current estimate of the eigenvalue
+     * \param rk_shift the reciprocal of the shift eigenvalue, \f$1/k_s\f$, or
+     * zero for an unshifted iteration
+     *
+     * This solves the coupled multigroup system
+     * \f[
+     *  \left(M - \frac{1}{k_s}F\right)\phi^{n+1} = \left(\frac{1}{k} -
+     *  \frac{1}{k_s}\right)F\phi^n
+     * \f]
+     * and stores the new flux on the \ref CoarseData. All groups are solved at
+     * once, so upscatter is treated implicitly rather than lagged. This also
+     * matters for the shifted system, since treating the shifted fission
+     * source group-by-group lags the coupling from the thermal to the fast
+     * groups, which undoes most of the benefit of the shift.
+     *
+     * The preconditioner is only refactored when the system matrix has
+     * drifted from the one it was last factored with by more than \c
+     * precond_tol_, relative to the Frobenius norm.
+     *
+     * Returns the squared L-2 norm of the residual of the system, before the
+     * solve, to be consistent with \ref residual(int).
+     *
+     * \pre The fission source has been calculated for \c k and stored in
+     * \c fs_.
+     */
+    real_t solve_coupled(real_t k, real_t rk_shift);
+
+    /**
+     * \brief Accelerate the multigroup flux with a one-group CMFD solve.
+     *
+     * \param [in,out] k the current estimate of the eigenvalue. Replaced with
+     * the eigenvalue of the one-group system.
+     * \param [in] r0 the initial residual of the multigroup system. The
+     * one-group linear solves are converged to \c resid_reduction of it, the
+     * same as the multigroup solves.
+     *
+     * This is the restriction/prolongation step of two-level CMFD. The current
+     * multigroup flux is collapsed to one group, using the homogenized cross
+     * sections for the removal and fission, and a one-group D-hat is chosen
+     * for each surface so that the one-group system reproduces the net
+     * currents of the multigroup system. The one-group eigenvalue problem is
+     * then solved by power iteration, which is cheap compared to a multigroup
+     * outer iteration, and the multigroup flux in each cell is scaled by the
+     * change in the one-group flux.
+     *
+     * The one-group system has the same spatial fidelity as the multigroup
+     * system, so this mostly targets the slowly-converging, global flux shape
+     * error that dominates power iteration on large cores.
+     *
+     * \pre \ref setup_solve() has been called for the current state of the
+     * CMFD system.
+     */
+    void solve_two_level(real_t &k, real_t r0);
+
+    /**
+     * \brief Solve the CMFD system in the coarse group structure.
+     *
+     * \param [in,out] k the eigenvalue
+     *
+     * The homogenized cross sections are collapsed to the coarse groups,
+     * weighted by the current CMFD flux. The flux, currents and surface
+     * fluxes are summed over each coarse group and handed to \ref
+     * collapsed_, which solves the few-group system with all of the usual
+     * options. The resulting coarse-group flux is prolonged back to the
+     * transport groups by scaling the flux in each cell by the change in
+     * its coarse-group flux, which preserves the spectrum within each
+     * coarse group. Transport-group currents are then reconstructed from
+     * the transport-group coupling coefficients, so that consumers of the
+     * \ref CoarseData see the same thing that they would from a full CMFD
+     * solve.
+     *
+     * This makes the cost of the CMFD solve nearly independent of the number
+     * of transport groups.
+     */
+    void solve_collapsed(real_t &k);
+
+    /**
+     * \brief Fill the coefficients of a one-group CMFD matrix.
+     *
+     * \param m the matrix to fill. Must already have the CMFD sparsity
+     * pattern
+     * \param xsrm the removal cross section in each cell
+     * \param d_tilde the surface diffusivities
+     * \param d_hat the non-linear surface current corrections
+     * \param dirty whether each row of the matrix should be filled. Rows that
+     * are not dirty are left alone.
+     */
+    void assemble_matrix(Eigen::SparseMatrix<real_t> &m, const VecF &xsrm,
+                         const VecF &d_tilde, const VecF &d_hat,
+                         const std::vector<bool> &dirty) const;
+
     void print(int iter, real_t k, real_t k_err, real_t psi_err,
                real_t resid_ratio);
 
@@ -184,8 +355,23 @@ norm = std::sqrt(norm)/(n_cell_*n_group_);
      * can it, since the flux is allowed to change, which in turn will
      * affect the new D-hats. While this conusmes more memory to store the
      * systems for each group, it should be faster.
+     *
+     * The groups are set up concurrently. See \ref setup_group().
      */
     void setup_solve();
+
+    /**
+     * \brief Compute the coupling coefficients and fill the matrix for a
+     * single group.
+     *
+     * \param group the group to set up
+     * \param incremental whether to only update the rows of the matrix whose
+     * coefficients have changed by more than \c update_tol_ since they were
+     * last assembled
+     *
+     * This is safe to call concurrently for different groups.
+     */
+    void setup_group(int group, bool incremental);
     real_t total_fission();
 
     // Private data
@@ -229,6 +415,13 @@ norm = std::sqrt(norm)/(n_cell_*n_group_);
     ArrayB2 s_hat_;
     ArrayB2 s_tilde_;
 
+    // Removal cross sections that the matrices were last assembled with
+    ArrayB2 xsrm_;
+
+    // Number of rows of each group's matrix that were skipped by the most
+    // recent incremental setup
+    VecI rows_skipped_;
+
     // Number of times solve() has been called
     int n_solve_;
 
@@ -241,6 +434,52 @@ norm = std::sqrt(norm)/(n_cell_*n_group_);
     // Other options
     bool zero_fixup_;
     bool dump_current_;
+
+    // Solve all groups at once, rather than group-by-group
+    bool coupled_;
+
+    // Accelerate each outer iteration with a collapsed one-group solve, and
+    // the one-group system to do it with
+    bool two_level_;
+    Eigen::SparseMatrix<real_t> m_1g_;
+    Eigen::BiCGSTAB<Eigen::SparseMatrix<real_t>> solver_1g_;
+
+    // Relative change in the coefficients below which the matrices and the
+    // homogenized cross sections are left alone between calls to solve(). If
+    // zero, everything is rebuilt every time.
+    real_t update_tol_;
+
+    // Collapsed CMFD solver and the coarse group of each transport group,
+    // if using an energy collapse
+    std::unique_ptr<CMFD> collapsed_;
+    VecI coarse_group_;
+
+    // Minimum Wielandt shift, k_s - k. When this is not positive, the
+    // unshifted power iteration is used.
+    real_t wielandt_shift_;
+    // Current shift eigenvalue, k_s. Zero if unshifted.
+    real_t k_shift_;
+
+    // Coupled multigroup loss and fission operators, the (possibly shifted)
+    // system matrix, and its solver. These are only used for the coupled
+    // solve.
+    Eigen::SparseMatrix<real_t> loss_mg_;
+    Eigen::SparseMatrix<real_t> fission_mg_;
+    Eigen::SparseMatrix<real_t> m_mg_;
+    Eigen::BiCGSTAB<Eigen::SparseMatrix<real_t>, CMFDPreconditioner>
+        solver_mg_;
+    VectorX x_mg_;
+    VectorX b_mg_;
+
+    // System matrix that the preconditioner was last factored with, and the
+    // relative change in the matrix that triggers a new factorization
+    Eigen::SparseMatrix<real_t> precond_mg_;
+    real_t precond_tol_;
+
+    // Number of outer iterations and the final shift eigenvalue for each call
+    // to solve(). These go to the HDF5 output.
+    VecI solve_iterations_;
+    VecF solve_shift_;
 };
 typedef std::unique_ptr<CMFD> UP_CMFD_t;
 }
@@ -0,0 +1,117 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "cmfd_preconditioner.hpp"
+
+#include <cassert>
+
+namespace mocc {
+CMFDPreconditioner::CMFDPreconditioner()
+    : type_(Type::DIAGONAL),
+      n_cell_(0),
+      n_group_(0),
+      frozen_(false),
+      is_initialized_(false),
+      n_factorizations_(0),
+      info_(Eigen::Success)
+{
+    return;
+}
+
+void CMFDPreconditioner::configure(Type type, int n_cell, int n_group)
+{
+    type_           = type;
+    n_cell_         = n_cell;
+    n_group_        = n_group;
+    is_initialized_ = false;
+    return;
+}
+
+void CMFDPreconditioner::factor(const Matrix_t &mat)
+{
+    info_ = Eigen::Success;
+
+    switch (type_) {
+    case Type::DIAGONAL:
+        inv_diag_ = mat.diagonal();
+        for (int i = 0; i < inv_diag_.size(); i++) {
+            inv_diag_[i] = (inv_diag_[i] != 0.0) ? 1.0 / inv_diag_[i] : 1.0;
+        }
+        break;
+
+    case Type::BLOCK_JACOBI: {
+        assert(mat.rows() == n_cell_ * n_group_);
+        std::vector<MatrixX> blocks(n_cell_,
+                                    MatrixX::Zero(n_group_, n_group_));
+        // Pick out the entries that couple groups within the same cell
+        for (int k = 0; k < mat.outerSize(); k++) {
+            for (Matrix_t::InnerIterator it(mat, k); it; ++it) {
+                int i = it.row() % n_cell_;
+                if (i == it.col() % n_cell_) {
+                    blocks[i](it.row() / n_cell_, it.col() / n_cell_) =
+                        it.value();
+                }
+            }
+        }
+
+        inv_blocks_.resize(n_cell_);
+        for (int i = 0; i < n_cell_; i++) {
+            inv_blocks_[i] = blocks[i].inverse();
+        }
+        break;
+    }
+
+    case Type::ILU:
+        ilu_.compute(mat);
+        info_ = ilu_.info();
+        break;
+    }
+
+    is_initialized_ = true;
+    n_factorizations_++;
+    return;
+}
+
+VectorX CMFDPreconditioner::apply(const VectorX &b) const
+{
+    assert(is_initialized_);
+
+    switch (type_) {
+    case Type::DIAGONAL:
+        return inv_diag_.cwiseProduct(b);
+
+    case Type::BLOCK_JACOBI: {
+        VectorX x(b.size());
+        VectorX b_cell(n_group_);
+        for (int i = 0; i < n_cell_; i++) {
+            for (int g = 0; g < n_group_; g++) {
+                b_cell[g] = b[g * n_cell_ + i];
+            }
+            VectorX x_cell = inv_blocks_[i] * b_cell;
+            for (int g = 0; g < n_group_; g++) {
+                x[g * n_cell_ + i] = x_cell[g];
+            }
+        }
+        return x;
+    }
+
+    case Type::ILU:
+        return ilu_.solve(b);
+    }
+
+    return b;
+}
+}
@@ -0,0 +1,143 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Sparse>
+
+#include "util/global_config.hpp"
+#include "eigen_interface.hpp"
+
+namespace mocc {
+/**
+ * \brief Preconditioner for the coupled multigroup CMFD system.
+ *
+ * This provides the interface that the Eigen iterative solvers expect of a
+ * preconditioner, so that it can be plugged into \c Eigen::BiCGSTAB. Three
+ * flavors are supported:
+ *  - \c DIAGONAL: plain Jacobi scaling, the same as Eigen's default,
+ *  - \c BLOCK_JACOBI: the exact inverse of the group-to-group coupling in
+ *  each cell, neglecting the spatial coupling,
+ *  - \c ILU: an incomplete LU factorization (\c Eigen::IncompleteLUT).
+ *
+ * The block-Jacobi preconditioner assumes that unknowns are ordered
+ * group-major, so that cell \c i of group \c g is at <tt>g*n_cell + i</tt>.
+ * Its dense blocks make it a poor fit for large group structures, so the
+ * CMFD input refuses it beyond \ref max_block_groups groups.
+ *
+ * Since factorization isn't free (especially for ILU), the preconditioner
+ * can be frozen with \ref freeze(). While frozen, calls to \ref compute()
+ * from the solver keep the existing factorization, as long as there is one.
+ */
+class CMFDPreconditioner {
+public:
+    typedef Eigen::SparseMatrix<real_t> Matrix_t;
+
+    enum class Type { DIAGONAL, BLOCK_JACOBI, ILU };
+
+    /**
+     * \brief Largest number of groups supported by \c BLOCK_JACOBI, which
+     * stores a dense block of n_group^2 entries for each cell.
+     */
+    static const int max_block_groups = 16;
+
+    enum {
+        ColsAtCompileTime    = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic
+    };
+
+    CMFDPreconditioner();
+
+    /**
+     * \brief Specify the type of preconditioner and the shape of the system.
+     *
+     * This discards any existing factorization.
+     */
+    void configure(Type type, int n_cell, int n_group);
+
+    /**
+     * \brief Keep (or stop keeping) the current factorization when the
+     * solver asks for a new one.
+     */
+    void freeze(bool frozen)
+    {
+        frozen_ = frozen;
+        return;
+    }
+
+    /**
+     * \brief Return the number of times that the preconditioner has actually
+     * been factorized.
+     */
+    int n_factorizations() const
+    {
+        return n_factorizations_;
+    }
+
+    template <typename MatType>
+    CMFDPreconditioner &analyzePattern(const MatType &)
+    {
+        return *this;
+    }
+
+    template <typename MatType>
+    CMFDPreconditioner &factorize(const MatType &mat)
+    {
+        return this->compute(mat);
+    }
+
+    template <typename MatType> CMFDPreconditioner &compute(const MatType &mat)
+    {
+        if (!(frozen_ && is_initialized_)) {
+            this->factor(Matrix_t(mat));
+        }
+        return *this;
+    }
+
+    template <typename Rhs> VectorX solve(const Rhs &b) const
+    {
+        return this->apply(b);
+    }
+
+    Eigen::ComputationInfo info()
+    {
+        return info_;
+    }
+
+private:
+    void factor(const Matrix_t &mat);
+    VectorX apply(const VectorX &b) const;
+
+    Type type_;
+    int n_cell_;
+    int n_group_;
+    bool frozen_;
+    bool is_initialized_;
+    int n_factorizations_;
+    Eigen::ComputationInfo info_;
+
+    // Inverse of the diagonal, for DIAGONAL
+    VectorX inv_diag_;
+
+    // Inverse of the group coupling block for each cell, for BLOCK_JACOBI
+    std::vector<MatrixX> inv_blocks_;
+
+    // Factorization for ILU
+    Eigen::IncompleteLUT<real_t> ilu_;
+};
+}
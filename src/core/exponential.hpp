@@ -20,6 +20,8 @@
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 
 #include "util/global_config.hpp"
 
@@ -134,4 +136,128 @@ template <int N> class Exponential_UnsafeLinear : public Exponential_Linear<N> {
                (this->d_[i + 1] - this->d_[i]) * v * this->rspace_;
     }
 };
+
+/**
+ * This version of \ref Exponential uses range reduction and a polynomial,
+ * rather than a table lookup. The argument is split as x = k ln(2) + r, with
+ * |r| <= ln(2)/2, so that exp(x) = 2^k exp(r). exp(r) is evaluated with a
+ * degree-11 Taylor polynomial and 2^k is assembled directly in the exponent
+ * bits of a double.
+ *
+ * There are no branches or gathers, so a loop over calls to \ref exp() can
+ * be vectorized by the compiler (AVX2/AVX-512, given the right -march). The
+ * relative error is about 1e-14 in double precision. Arguments are clamped
+ * to [-708, 708], which keeps 2^k a normal number.
+ */
+class Exponential_Poly : public Exponential {
+public:
+    Exponential_Poly()
+    {
+    }
+
+    inline real_t exp(real_t v) const
+    {
+        const double log2e = 1.4426950408889634074;
+        const double ln2hi = 6.93145751953125e-1;
+        const double ln2lo = 1.42860682030941723212e-6;
+        // Adding 1.5*2^52 rounds to the nearest integer, leaving k + 1023 in
+        // the low bits of the mantissa. Shifting those into the exponent field
+        // then gives 2^k. This avoids floor() and double-to-integer
+        // conversions, neither of which vectorize on all targets.
+        const double shift = 6755399441055744.0 + 1023.0;
+
+        double x  = std::min(std::max((double)v, -708.0), 708.0);
+        double kb = x * log2e + shift;
+        double k  = kb - shift;
+        double r  = (x - k * ln2hi) - k * ln2lo;
+
+        double p = 1.0 / 39916800.0;
+        p        = p * r + 1.0 / 3628800.0;
+        p        = p * r + 1.0 / 362880.0;
+        p        = p * r + 1.0 / 40320.0;
+        p        = p * r + 1.0 / 5040.0;
+        p        = p * r + 1.0 / 720.0;
+        p        = p * r + 1.0 / 120.0;
+        p        = p * r + 1.0 / 24.0;
+        p        = p * r + 1.0 / 6.0;
+        p        = p * r + 0.5;
+        p        = p * r + 1.0;
+        p        = p * r + 1.0;
+
+        uint64_t bits;
+        std::memcpy(&bits, &kb, sizeof(bits));
+        bits <<= 52;
+        double scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+
+        return p * scale;
+    }
+
+    real_t max_error()
+    {
+        real_t max_error = 0.0;
+        for (int i = 0; i < 100000; i++) {
+            real_t x   = -10.0 + 1.0e-4 * (0.5 + i);
+            real_t e   = std::exp(x);
+            real_t err = std::abs((this->exp(x) - e) / e);
+            max_error  = std::max(max_error, err);
+        }
+        return max_error;
+    }
+};
+
+/**
+ * \brief Evaluate 1 - exp(-tau) over arrays of optical thickness, using a
+ * method selected at runtime.
+ *
+ * MoC needs 1 - exp(-tau) for every segment on a ray. Evaluating these for a
+ * whole ray at once, rather than interleaved with the flux propagation,
+ * allows the \ref Method::POLY variant to vectorize across segments. The
+ * \ref Method::TABLE variant uses \ref Exponential_Linear, and \ref
+ * Method::LIBM calls the standard library.
+ */
+class ExponentialBatch {
+public:
+    enum class Method { LIBM, TABLE, POLY };
+
+    ExponentialBatch(Method method = Method::POLY) : method_(method)
+    {
+    }
+
+    /**
+     * \brief Replace each of the \p n values in \p tau with 1 - exp(-tau)
+     */
+    void one_minus_exp(real_t *tau, int n) const
+    {
+        switch (method_) {
+        case Method::POLY:
+#pragma omp simd
+            for (int i = 0; i < n; i++) {
+                tau[i] = 1.0 - poly_.exp(-tau[i]);
+            }
+            break;
+        case Method::TABLE:
+            for (int i = 0; i < n; i++) {
+                tau[i] = 1.0 - table_.exp(-tau[i]);
+            }
+            break;
+        case Method::LIBM:
+            for (int i = 0; i < n; i++) {
+                tau[i] = 1.0 - std::exp(-tau[i]);
+            }
+            break;
+        }
+        return;
+    }
+
+    Method method() const
+    {
+        return method_;
+    }
+
+private:
+    Method method_;
+    Exponential_Linear<10000> table_;
+    Exponential_Poly poly_;
+};
 }
@@ -0,0 +1,115 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "inner_iteration_control.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace mocc {
+InnerIterationControl::InnerIterationControl()
+    : n_max_(1), tol_min_(0.0), tol_(0.0)
+{
+    return;
+}
+
+void InnerIterationControl::configure(int n_group, unsigned n_inner,
+                                      real_t tol)
+{
+    n_max_   = n_inner;
+    tol_min_ = std::max(tol, (real_t)0.0);
+    tol_     = tol_min_;
+
+    flux_prev_.assign(n_group, VecF());
+    n_observed_.assign(n_group, 0);
+    first_change_.assign(n_group, -1.0);
+    last_change_.assign(n_group, -1.0);
+    rate_.assign(n_group, -1.0);
+    last_n_inner_.assign(n_group, n_max_);
+
+    return;
+}
+
+void InnerIterationControl::set_tolerance(real_t tol)
+{
+    tol_ = std::max(tol, tol_min_);
+    return;
+}
+
+unsigned InnerIterationControl::n_inner(int group)
+{
+    assert(group < (int)last_n_inner_.size());
+
+    unsigned n = n_max_;
+    if (adaptive() && (first_change_[group] >= 0.0)) {
+        if (first_change_[group] <= tol_) {
+            n = 1;
+        } else if ((rate_[group] > 0.0) && (rate_[group] < 1.0)) {
+            real_t n_more =
+                std::log(tol_ / first_change_[group]) / std::log(rate_[group]);
+            n = 1 + (unsigned)std::ceil(n_more);
+        }
+        n = std::max(1u, std::min(n, n_max_));
+    }
+
+    last_n_inner_[group] = n;
+    return n;
+}
+
+void InnerIterationControl::begin(int group, const ArrayB1 &flux)
+{
+    if (!adaptive()) {
+        return;
+    }
+
+    flux_prev_[group].assign(flux.begin(), flux.end());
+    n_observed_[group] = 0;
+    return;
+}
+
+void InnerIterationControl::observe(int group, const ArrayB1 &flux)
+{
+    if (!adaptive()) {
+        return;
+    }
+
+    VecF &prev = flux_prev_[group];
+    assert((int)prev.size() == (int)flux.size());
+
+    real_t diff = 0.0;
+    real_t norm = 0.0;
+    int i       = 0;
+    for (auto v : flux) {
+        real_t e = v - prev[i];
+        diff += e * e;
+        norm += v * v;
+        prev[i] = v;
+        i++;
+    }
+    real_t change = (norm > 0.0) ? std::sqrt(diff / norm) : 0.0;
+
+    if (n_observed_[group] == 0) {
+        first_change_[group] = change;
+    } else if (last_change_[group] > 0.0) {
+        rate_[group] = change / last_change_[group];
+    }
+    last_change_[group] = change;
+    n_observed_[group]++;
+
+    return;
+}
+}
@@ -0,0 +1,123 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <vector>
+#include "util/blitz_typedefs.hpp"
+#include "util/global_config.hpp"
+
+namespace mocc {
+/**
+ * \brief Choose the number of inner iterations to perform for each group.
+ *
+ * By default this just hands back a fixed number of inner iterations. When
+ * given a positive tolerance, it instead watches the relative change in the
+ * group scalar flux from one inner iteration to the next, and uses it to
+ * estimate how quickly the within-group scattering iteration converges.
+ * Assuming that the change shrinks geometrically, the number of inner
+ * iterations for the next sweep of a group is chosen to bring the change
+ * below the current tolerance, bounded by the fixed number of inner
+ * iterations.
+ *
+ * The tolerance is meant to be moved around by the outer iteration with
+ * \ref set_tolerance(), so that early outer iterations, with a poor fission
+ * source, don't waste time over-converging the scattering source.
+ */
+class InnerIterationControl {
+public:
+    InnerIterationControl();
+
+    /**
+     * \brief Set up the controller
+     *
+     * \param n_group the number of energy groups
+     * \param n_inner the maximum number of inner iterations. This is the
+     * number of inner iterations that is always performed if not adaptive
+     * \param tol the smallest tolerance that the controller will ever
+     * target. If not positive, the controller is not adaptive.
+     */
+    void configure(int n_group, unsigned n_inner, real_t tol);
+
+    bool adaptive() const
+    {
+        return tol_min_ > 0.0;
+    }
+
+    /**
+     * \brief Set the tolerance to target for the change in the flux of the
+     * last inner iteration. This is never looser than the tolerance passed to
+     * \ref configure().
+     */
+    void set_tolerance(real_t tol);
+
+    real_t tolerance() const
+    {
+        return tol_;
+    }
+
+    /**
+     * \brief Return the number of inner iterations to perform for the next
+     * sweep of the passed group, and remember it.
+     */
+    unsigned n_inner(int group);
+
+    /**
+     * \brief Return the number of inner iterations most recently chosen for
+     * each group.
+     */
+    const std::vector<unsigned> &last_n_inner() const
+    {
+        return last_n_inner_;
+    }
+
+    /**
+     * \brief Store the flux at the start of a sweep of the passed group.
+     *
+     * Does nothing if not adaptive.
+     */
+    void begin(int group, const ArrayB1 &flux);
+
+    /**
+     * \brief Record the change in the flux from the previous inner iteration
+     * of the passed group.
+     *
+     * Does nothing if not adaptive.
+     */
+    void observe(int group, const ArrayB1 &flux);
+
+private:
+    unsigned n_max_;
+    real_t tol_min_;
+    real_t tol_;
+
+    // Flux from the previous inner iteration of each group
+    std::vector<VecF> flux_prev_;
+
+    // Number of inner iterations observed so far in the current sweep of
+    // each group
+    std::vector<int> n_observed_;
+
+    // Relative flux change on the first inner iteration of the most recent
+    // sweep, the change on the most recent inner iteration, and the ratio of
+    // successive changes, for each group. Negative if unknown.
+    VecF first_change_;
+    VecF last_change_;
+    VecF rate_;
+
+    std::vector<unsigned> last_n_inner_;
+};
+}
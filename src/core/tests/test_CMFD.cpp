@@ -17,6 +17,7 @@
 #include "UnitTest++/UnitTest++.h"
 
 #include <memory>
+#include <string>
 
 #include "pugixml.hpp"
 
@@ -50,6 +51,192 @@ TEST(testCMFD)
     std::cout << k << std::endl;
 }
 
+// The Wielandt-shifted iteration should land on the same eigenvalue as plain
+// power iteration
+TEST(testCMFD_wielandt)
+{
+    auto mesh_xml = inline_xml_file("3x5.xml");
+    CoreMesh mesh(*mesh_xml);
+
+    auto cmfd_xml = inline_xml("<cmfd k_tol=\"1e-10\" "
+                               "psi_tol=\"1e-8\" "
+                               "max_iter=\"1000\" />");
+    auto wielandt_xml = inline_xml("<cmfd k_tol=\"1e-10\" "
+                                   "psi_tol=\"1e-8\" "
+                                   "max_iter=\"1000\" "
+                                   "wielandt_shift=\"0.05\" />");
+
+    std::shared_ptr<XSMeshHomogenized> xsmesh(
+        std::make_shared<XSMeshHomogenized>(mesh));
+
+    CMFD cmfd(*cmfd_xml, &mesh, xsmesh);
+    CMFD cmfd_wielandt(*wielandt_xml, &mesh, xsmesh);
+
+    real_t k = 1.0;
+    cmfd.solve(k);
+    real_t k_wielandt = 1.0;
+    cmfd_wielandt.solve(k_wielandt);
+
+    CHECK_CLOSE(k, k_wielandt, 0.000001);
+}
+
+// The coupled multigroup solve should agree with the group-by-group
+// iteration, regardless of the preconditioner
+TEST(testCMFD_coupled)
+{
+    auto mesh_xml = inline_xml_file("3x5.xml");
+    CoreMesh mesh(*mesh_xml);
+
+    std::shared_ptr<XSMeshHomogenized> xsmesh(
+        std::make_shared<XSMeshHomogenized>(mesh));
+
+    auto cmfd_xml = inline_xml("<cmfd k_tol=\"1e-10\" "
+                               "psi_tol=\"1e-8\" "
+                               "max_iter=\"1000\" />");
+    CMFD cmfd(*cmfd_xml, &mesh, xsmesh);
+    real_t k = 1.0;
+    cmfd.solve(k);
+
+    for (std::string pc : {"diagonal", "block_jacobi", "ilu"}) {
+        std::string input = "<cmfd k_tol=\"1e-10\" "
+                            "psi_tol=\"1e-8\" "
+                            "max_iter=\"1000\" "
+                            "coupled=\"t\" "
+                            "preconditioner=\"" +
+                            pc + "\" />";
+        auto coupled_xml = inline_xml(input.c_str());
+        CMFD cmfd_coupled(*coupled_xml, &mesh, xsmesh);
+
+        real_t k_coupled = 1.0;
+        cmfd_coupled.solve(k_coupled);
+
+        CHECK_CLOSE(k, k_coupled, 0.000001);
+    }
+}
+
+// Two-level acceleration changes the path to convergence, not the answer
+TEST(testCMFD_two_level)
+{
+    auto mesh_xml = inline_xml_file("3x5.xml");
+    CoreMesh mesh(*mesh_xml);
+
+    auto cmfd_xml = inline_xml("<cmfd k_tol=\"1e-10\" "
+                               "psi_tol=\"1e-8\" "
+                               "max_iter=\"1000\" />");
+    auto two_level_xml = inline_xml("<cmfd k_tol=\"1e-10\" "
+                                    "psi_tol=\"1e-8\" "
+                                    "max_iter=\"1000\" "
+                                    "two_level=\"t\" />");
+
+    std::shared_ptr<XSMeshHomogenized> xsmesh(
+        std::make_shared<XSMeshHomogenized>(mesh));
+
+    CMFD cmfd(*cmfd_xml, &mesh, xsmesh);
+    CMFD cmfd_two_level(*two_level_xml, &mesh, xsmesh);
+
+    real_t k = 1.0;
+    cmfd.solve(k);
+    real_t k_two_level = 1.0;
+    cmfd_two_level.solve(k_two_level);
+
+    CHECK_CLOSE(k, k_two_level, 0.000001);
+}
+
+// Nothing changes between the two solves, so the incremental update should
+// skip everything the second time around, and still give the same answer.
+// Each CMFD gets its own XSMesh, so nothing done by the incremental one can
+// leak into the baseline.
+TEST(testCMFD_incremental)
+{
+    auto mesh_xml = inline_xml_file("3x5.xml");
+    CoreMesh mesh(*mesh_xml);
+
+    auto cmfd_xml = inline_xml("<cmfd k_tol=\"1e-10\" "
+                               "psi_tol=\"1e-8\" "
+                               "max_iter=\"1000\" />");
+    auto incremental_xml = inline_xml("<cmfd k_tol=\"1e-10\" "
+                                      "psi_tol=\"1e-8\" "
+                                      "max_iter=\"1000\" "
+                                      "update_tol=\"1e-6\" />");
+
+    std::shared_ptr<XSMeshHomogenized> xsmesh(
+        std::make_shared<XSMeshHomogenized>(mesh));
+    std::shared_ptr<XSMeshHomogenized> xsmesh_incremental(
+        std::make_shared<XSMeshHomogenized>(mesh));
+
+    // Give the XSMeshes a (constant) fine-mesh flux, so that they actually
+    // do flux-weighted updates
+    int ng = xsmesh->n_group();
+    ArrayB2 fine_flux(mesh.n_reg(MeshTreatment::PLANE), ng);
+    fine_flux = 1.0;
+    xsmesh->set_flux(fine_flux);
+    xsmesh_incremental->set_flux(fine_flux);
+
+    CMFD cmfd(*cmfd_xml, &mesh, xsmesh);
+    CMFD cmfd_incremental(*incremental_xml, &mesh, xsmesh_incremental);
+
+    int n_row = mesh.n_reg(MeshTreatment::PIN_PLANE) * ng;
+    int n_pin = xsmesh->size();
+
+    real_t k             = 1.0;
+    real_t k_incremental = 1.0;
+
+    // The first solve has nothing to compare against
+    cmfd.solve(k);
+    cmfd_incremental.solve(k_incremental);
+    CHECK_CLOSE(k, k_incremental, 0.000001);
+    CHECK_EQUAL(0, cmfd_incremental.n_rows_skipped());
+    CHECK_EQUAL(0, cmfd_incremental.n_pins_skipped());
+
+    // The second one should skip everything, but only for the incremental
+    // CMFD
+    cmfd.solve(k);
+    cmfd_incremental.solve(k_incremental);
+    CHECK_CLOSE(k, k_incremental, 0.000001);
+    CHECK_EQUAL(0, cmfd.n_rows_skipped());
+    CHECK_EQUAL(0, cmfd.n_pins_skipped());
+    CHECK_EQUAL(n_row, cmfd_incremental.n_rows_skipped());
+    CHECK_EQUAL(n_pin, cmfd_incremental.n_pins_skipped());
+}
+
+// The collapsed system is consistent with the multigroup one, so when it is
+// handed a converged multigroup flux and currents, it should keep the same
+// eigenvalue
+TEST(testCMFD_collapse)
+{
+    auto mesh_xml = inline_xml_file("3x5.xml");
+    CoreMesh mesh(*mesh_xml);
+
+    auto cmfd_xml = inline_xml("<cmfd k_tol=\"1e-10\" "
+                               "psi_tol=\"1e-8\" "
+                               "max_iter=\"1000\" />");
+    auto collapse_xml = inline_xml("<cmfd k_tol=\"1e-10\" "
+                                   "psi_tol=\"1e-8\" "
+                                   "max_iter=\"1000\" "
+                                   "energy_collapse=\"3 4\" />");
+
+    std::shared_ptr<XSMeshHomogenized> xsmesh(
+        std::make_shared<XSMeshHomogenized>(mesh));
+
+    CMFD cmfd(*cmfd_xml, &mesh, xsmesh);
+    CMFD cmfd_collapse(*collapse_xml, &mesh, xsmesh);
+
+    real_t k = 1.0;
+    cmfd.solve(k);
+
+    CoarseData &data  = cmfd_collapse.coarse_data();
+    data.flux         = cmfd.coarse_data().flux;
+    data.current      = cmfd.coarse_data().current;
+    data.surface_flux = cmfd.coarse_data().surface_flux;
+    data.set_has_radial_data(true);
+    data.set_has_axial_data(true);
+
+    real_t k_collapse = 1.0;
+    cmfd_collapse.solve(k_collapse);
+
+    CHECK_CLOSE(k, k_collapse, 0.000001);
+}
+
 int main()
 {
     return UnitTest::RunAllTests();
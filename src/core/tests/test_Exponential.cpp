@@ -91,6 +91,58 @@ TEST(exp_coarse)
 
 }
 
+TEST(exp_poly)
+{
+    Exponential_Poly exp;
+
+    std::cout << "max error from exp_poly: " << exp.max_error() << std::endl;
+    CHECK(exp.max_error() < 1e-13);
+
+    // Go well outside of the typical table range, both ways
+    real_t max_err = 0.0;
+    for (real_t x = -700.0; x < 700.0; x += 0.01) {
+        real_t exp_t = exp.exp(x);
+        real_t exp_r = std::exp(x);
+        real_t err   = std::abs(exp_r - exp_t) / exp_r;
+        max_err      = std::max(max_err, err);
+    }
+    std::cout << "max_err: " << max_err << std::endl;
+    CHECK(max_err < 1e-13);
+
+    // Clamped, but still sane
+    CHECK(exp.exp(-1000.0) < 1e-300);
+    CHECK(exp.exp(-1000.0) >= 0.0);
+}
+
+TEST(exp_batch)
+{
+    int n = 2001;
+    VecF tau(n);
+    VecF ref(n);
+    for (int i = 0; i < n; i++) {
+        tau[i] = 0.005 * i;
+        ref[i] = 1.0 - std::exp(-tau[i]);
+    }
+
+    std::vector<std::pair<ExponentialBatch::Method, real_t>> methods = {
+        {ExponentialBatch::Method::LIBM, REAL_FUZZ},
+        {ExponentialBatch::Method::TABLE, 2e-8},
+        {ExponentialBatch::Method::POLY, 1e-14}};
+
+    for (const auto &m : methods) {
+        ExponentialBatch exp(m.first);
+        VecF e_tau = tau;
+        exp.one_minus_exp(e_tau.data(), n);
+
+        real_t max_err = 0.0;
+        for (int i = 0; i < n; i++) {
+            max_err = std::max(max_err, std::abs(e_tau[i] - ref[i]));
+        }
+        std::cout << "batch max_err: " << max_err << std::endl;
+        CHECK(max_err < m.second);
+    }
+}
+
 int main(int, const char *[])
 {
     return UnitTest::RunAllTests();
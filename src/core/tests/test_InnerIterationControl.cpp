@@ -0,0 +1,79 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "UnitTest++/UnitTest++.h"
+
+#include "core/inner_iteration_control.hpp"
+
+using namespace mocc;
+
+// Run a fake sweep, where the flux converges to 1.0 by a factor of 10 each
+// inner iteration
+void fake_sweep(InnerIterationControl &control, int group, unsigned n_inner)
+{
+    ArrayB1 flux(4);
+    flux = 2.0;
+    control.begin(group, flux);
+    real_t error = 0.1;
+    for (unsigned inner = 0; inner < n_inner; inner++) {
+        flux = 1.0 + error;
+        control.observe(group, flux);
+        error *= 0.1;
+    }
+}
+
+TEST(fixed)
+{
+    InnerIterationControl control;
+    control.configure(2, 5, 0.0);
+    CHECK(!control.adaptive());
+
+    fake_sweep(control, 0, 5);
+    CHECK_EQUAL(5u, control.n_inner(0));
+    CHECK_EQUAL(5u, control.n_inner(1));
+}
+
+TEST(adaptive)
+{
+    InnerIterationControl control;
+    control.configure(2, 10, 1.0e-6);
+    CHECK(control.adaptive());
+
+    // Nothing known yet, so do the most work
+    CHECK_EQUAL(10u, control.n_inner(0));
+    fake_sweep(control, 0, 10);
+
+    // The tolerance can't go below the one that we configured with
+    control.set_tolerance(1.0e-12);
+    CHECK_CLOSE(1.0e-6, control.tolerance(), 1.0e-12);
+    unsigned n_tight = control.n_inner(0);
+
+    control.set_tolerance(1.0e-3);
+    unsigned n_loose = control.n_inner(0);
+
+    CHECK(n_loose < n_tight);
+    CHECK(n_loose >= 1u);
+    CHECK(n_tight <= 10u);
+    CHECK_EQUAL(n_loose, control.last_n_inner()[0]);
+
+    // The other group hasn't been swept
+    CHECK_EQUAL(10u, control.n_inner(1));
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -101,6 +101,22 @@ TransportSweeper::TransportSweeper(const pugi::xml_node &input)
     return;
 }
 
+void TransportSweeper::sweep_multigroup(const ArrayB2 &source)
+{
+    assert(source_);
+    assert((int)source.extent(0) == n_reg_);
+    assert((int)source.extent(1) == n_group_);
+
+    for (int group = 0; group < n_group_; group++) {
+        for (int i = 0; i < n_reg_; i++) {
+            (*source_)[i] = source(i, group);
+        }
+        this->sweep(group);
+    }
+
+    return;
+}
+
 real_t TransportSweeper::total_fission(bool old) const
 {
     real_t tfis      = 0.0;
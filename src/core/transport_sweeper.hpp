@@ -26,6 +26,7 @@
 #include "core/angular_quadrature.hpp"
 #include "core/coarse_data.hpp"
 #include "core/eigen_interface.hpp"
+#include "core/inner_iteration_control.hpp"
 #include "core/output_interface.hpp"
 #include "core/source.hpp"
 #include "core/source_factory.hpp"
@@ -54,6 +55,21 @@ public:
      */
     virtual void sweep(int group) = 0;
 
+    /**
+     * \brief Perform a transport sweep of all groups, using a multigroup
+     * source that has been formed ahead of time.
+     *
+     * \param source the multigroup source, less self-scatter, indexed as
+     * (region, group)
+     *
+     * This supports Jacobi-style group iteration, where the source for every
+     * group is formed from the previous iterate before any group is swept.
+     * The default implementation loads each group's source into the \ref
+     * Source and calls \ref sweep() for that group. Sweepers that are able
+     * to share work between groups should override it.
+     */
+    virtual void sweep_multigroup(const ArrayB2 &source);
+
     /**
      * \brief Initialize the solution variables (scalar, boundary flux,
      * etc.) to reasonable initial guesses.
@@ -68,6 +84,29 @@ public:
      */
     virtual void update_incoming_flux() = 0;
 
+    /**
+     * \brief Return the number of incoming boundary angular flux values that
+     * the sweeper carries from one sweep to the next.
+     *
+     * Together with the scalar flux, these make up the state of the sweeper
+     * between sweeps, which solvers that treat a sweep as a function of that
+     * state (e.g. \ref JFNKEigenSolver) need to be able to get at.
+     */
+    virtual int n_boundary_values() const = 0;
+
+    /**
+     * \brief Copy the incoming boundary angular flux values, for all groups,
+     * to the passed buffer, which must have room for \ref
+     * n_boundary_values() values.
+     */
+    virtual void get_boundary_values(real_t *out) const = 0;
+
+    /**
+     * \brief Set the incoming boundary angular flux values, for all groups,
+     * from the passed buffer.
+     */
+    virtual void set_boundary_values(const real_t *in) = 0;
+
     /**
      * \brief Return a const reference to the Sweeper's \ref
      * AngularQuadrature
@@ -305,6 +344,27 @@ public:
      */
     virtual ArrayB3 pin_powers() const;
 
+    /**
+     * \brief Set the tolerance for adaptive inner iterations
+     *
+     * This has no effect unless the sweeper was configured for adaptive inner
+     * iterations. See \ref InnerIterationControl. Sweepers that delegate to
+     * other sweepers should pass this along to them.
+     */
+    virtual void set_inner_tolerance(real_t tol)
+    {
+        inner_control_.set_tolerance(tol);
+        return;
+    }
+
+    /**
+     * \brief Return a const reference to the inner iteration controller
+     */
+    virtual const InnerIterationControl &inner_control() const
+    {
+        return inner_control_;
+    }
+
     /**
      * \brief Return a const reference to the region volumes
      */
@@ -348,6 +408,10 @@ protected:
 
     // Do incoming flux updates?
     bool do_incoming_update_;
+
+    // Chooses the number of inner iterations for each group sweep. Sweepers
+    // that do inner iterations should configure this.
+    InnerIterationControl inner_control_;
 };
 
 typedef std::unique_ptr<TransportSweeper> UP_Sweeper_t;
@@ -16,10 +16,12 @@
 
 #include "xs_mesh_homogenized.hpp"
 
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <numeric>
 #include <sstream>
+#include <vector>
 #include "pugixml.hpp"
 #include "util/files.hpp"
 #include "util/h5file.hpp"
@@ -27,7 +29,12 @@
 
 namespace mocc {
 XSMeshHomogenized::XSMeshHomogenized(const CoreMesh &mesh)
-    : XSMesh(mesh, MeshTreatment::PIN), mesh_(mesh), flux_(nullptr)
+    : XSMesh(mesh, MeshTreatment::PIN),
+      mesh_(mesh),
+      flux_(nullptr),
+      update_tol_(0.0),
+      n_skipped_(0),
+      hold_(false)
 {
     // Set up the non-xs part of the xs mesh
     eubounds_ = mesh_.mat_lib().g_bounds();
@@ -170,11 +177,120 @@ XSMeshHomogenized::XSMeshHomogenized(XSMeshHomogenized &other,
     return;
 }
 
+XSMeshHomogenized::XSMeshHomogenized(const XSMeshHomogenized &fine,
+                                     const VecI &coarse_group)
+    : XSMesh(fine),
+      mesh_(fine.mesh_),
+      flux_(nullptr),
+      update_tol_(0.0),
+      n_skipped_(0),
+      hold_(false),
+      coarse_group_(coarse_group)
+{
+    assert(coarse_group_.size() == fine.ng_);
+    ng_ = coarse_group_.back() + 1;
+
+    // The upper bound of a coarse group is that of its first fine group
+    eubounds_.assign(ng_, 0.0);
+    for (int ig = (int)fine.ng_ - 1; ig >= 0; ig--) {
+        eubounds_[coarse_group_[ig]] = fine.eubounds_[ig];
+    }
+
+    // Resizing gives us new storage, rather than the fine cross sections
+    // that came along with the copy
+    int n_xsreg = regions_.size();
+    this->allocate_xs(n_xsreg, ng_);
+    xstr_ = 0.0;
+    xsnf_ = 0.0;
+    xsch_ = 0.0;
+    xsf_  = 0.0;
+    xsrm_ = 0.0;
+    for (int ixsreg = 0; ixsreg < n_xsreg; ixsreg++) {
+        regions_[ixsreg] = XSMeshRegion(
+            fine.regions_[ixsreg].reg(), &xstr_(ixsreg, 0),
+            &xsnf_(ixsreg, 0), &xsch_(ixsreg, 0), &xsf_(ixsreg, 0),
+            &xsrm_(ixsreg, 0), ScatteringMatrix());
+    }
+
+    return;
+}
+
+void XSMeshHomogenized::collapse(const XSMeshHomogenized &fine,
+                                 const ArrayB2 &flux)
+{
+    assert(!coarse_group_.empty());
+    assert(fine.regions_.size() == regions_.size());
+
+    int ng_fine = fine.ng_;
+    int n_xsreg = regions_.size();
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int ixsreg = 0; ixsreg < n_xsreg; ixsreg++) {
+        const auto &xsr_fine = fine.regions_[ixsreg];
+        auto &xsr            = regions_[ixsreg];
+
+        // Weighting flux for each fine group, and its sum over each coarse
+        // group
+        VecF w(ng_fine, 0.0);
+        for (int ig = 0; ig < ng_fine; ig++) {
+            for (const int i : xsr.reg()) {
+                w[ig] += flux(i, ig);
+            }
+        }
+        VecF w_sum(ng_, 0.0);
+        for (int ig = 0; ig < ng_fine; ig++) {
+            w_sum[coarse_group_[ig]] += w[ig];
+        }
+        for (int ig = 0; ig < ng_fine; ig++) {
+            if (!(w_sum[coarse_group_[ig]] > 0.0)) {
+                w[ig] = 1.0;
+            }
+        }
+        w_sum.assign(ng_, 0.0);
+        for (int ig = 0; ig < ng_fine; ig++) {
+            w_sum[coarse_group_[ig]] += w[ig];
+        }
+
+        for (int ig = 0; ig < (int)ng_; ig++) {
+            xstr_(ixsreg, ig) = 0.0;
+            xsnf_(ixsreg, ig) = 0.0;
+            xsch_(ixsreg, ig) = 0.0;
+            xsf_(ixsreg, ig)  = 0.0;
+        }
+
+        ArrayB2 scat(ng_, ng_);
+        scat = 0.0;
+        for (int ig = 0; ig < ng_fine; ig++) {
+            int cg   = coarse_group_[ig];
+            real_t f = w[ig] / w_sum[cg];
+            xstr_(ixsreg, cg) += f * xsr_fine.xsmactr(ig);
+            xsnf_(ixsreg, cg) += f * xsr_fine.xsmacnf(ig);
+            xsf_(ixsreg, cg) += f * xsr_fine.xsmacf(ig);
+            xsch_(ixsreg, cg) += xsr_fine.xsmacch(ig);
+
+            const ScatteringRow &row = xsr_fine.xsmacsc(ig);
+            for (int igg = row.min_g; igg <= row.max_g; igg++) {
+                int cgg = coarse_group_[igg];
+                scat(cg, cgg) += row[igg] * w[igg] / w_sum[cgg];
+            }
+        }
+
+        xsr = XSMeshRegion(xsr.reg(), &xstr_(ixsreg, 0), &xsnf_(ixsreg, 0),
+                           &xsch_(ixsreg, 0), &xsf_(ixsreg, 0),
+                           &xsrm_(ixsreg, 0), ScatteringMatrix(scat));
+    }
+
+    state_++;
+    return;
+}
+
 /**
  * Update the XS mesh, incorporating a new estimate of the scalar flux.
  */
 void XSMeshHomogenized::update()
 {
+    if (hold_) {
+        return;
+    }
     if (!flux_) {
         // no update needed if doing volume-weighted cross sections
         return;
@@ -182,20 +298,92 @@ void XSMeshHomogenized::update()
         // For now assume that the flux is coming from a PLANE-type sweeper
         assert(flux_->extent(0) == (int)mesh_.n_reg(MeshTreatment::PLANE));
     }
-    int first_reg = 0;
-    int ixsreg    = 0;
+
+    // Gather the pins and their region offsets up front, so that they can be
+    // homogenized concurrently
+    std::vector<const Pin *> pins;
+    VecI first_reg;
+    pins.reserve(regions_.size());
+    first_reg.reserve(regions_.size());
+    int ireg = 0;
     for (const auto &mplane : mesh_.macroplanes()) {
         for (const auto &pin : mplane) {
-            this->homogenize_region_flux(ixsreg, first_reg, *pin,
-                                         regions_[ixsreg]);
-            first_reg += pin->n_reg();
-            ixsreg++;
+            pins.push_back(pin);
+            first_reg.push_back(ireg);
+            ireg += pin->n_reg();
+        }
+    }
+
+    // When doing incremental updates, the first update has nothing to compare
+    // against, so everything is homogenized
+    bool incremental = (update_tol_ > 0.0) && (flux_old_.size() > 0);
+    if ((update_tol_ > 0.0) && !incremental) {
+        flux_old_.resize(flux_->shape());
+    }
+
+    const ArrayB2 &flux = *flux_;
+    int n_pin           = pins.size();
+    int n_skipped       = 0;
+#pragma omp parallel for schedule(dynamic, 16) reduction(+ : n_skipped)
+    for (int ixsreg = 0; ixsreg < n_pin; ixsreg++) {
+        int stt = first_reg[ixsreg];
+        int stp = stt + pins[ixsreg]->n_reg();
+        if (incremental) {
+            bool changed = false;
+            for (int i = stt; (i < stp) && !changed; i++) {
+                for (int ig = 0; ig < (int)ng_; ig++) {
+                    if (std::abs(flux(i, ig) - flux_old_(i, ig)) >
+                        update_tol_ * std::abs(flux_old_(i, ig))) {
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+            if (!changed) {
+                n_skipped++;
+                continue;
+            }
+        }
+
+        this->homogenize_region_flux(ixsreg, stt, *pins[ixsreg],
+                                     regions_[ixsreg]);
+
+        if (update_tol_ > 0.0) {
+            for (int i = stt; i < stp; i++) {
+                for (int ig = 0; ig < (int)ng_; ig++) {
+                    flux_old_(i, ig) = flux(i, ig);
+                }
+            }
         }
     }
+    n_skipped_ = n_skipped;
     state_++;
     return;
 }
 
+void XSMeshHomogenized::detach()
+{
+    ArrayB2 xstr = xstr_.copy();
+    ArrayB2 xsnf = xsnf_.copy();
+    ArrayB2 xsch = xsch_.copy();
+    ArrayB2 xsf  = xsf_.copy();
+    ArrayB2 xsrm = xsrm_.copy();
+    xstr_.reference(xstr);
+    xsnf_.reference(xsnf);
+    xsch_.reference(xsch);
+    xsf_.reference(xsf);
+    xsrm_.reference(xsrm);
+
+    for (int ixsreg = 0; ixsreg < (int)regions_.size(); ixsreg++) {
+        XSMeshRegion &xsr = regions_[ixsreg];
+        xsr = XSMeshRegion(xsr.reg(), &xstr_(ixsreg, 0), &xsnf_(ixsreg, 0),
+                           &xsch_(ixsreg, 0), &xsf_(ixsreg, 0),
+                           &xsrm_(ixsreg, 0), xsr.xsmacsc());
+    }
+
+    return;
+}
+
 void XSMeshHomogenized::homogenize_region(int i, const Pin &pin,
                                           XSMeshRegion &xsr) const
 {
@@ -207,16 +395,16 @@ void XSMeshHomogenized::homogenize_region(int i, const Pin &pin,
 
     std::vector<VecF> scat(ng_, VecF(ng_, 0.0));
 
-    auto mat_lib   = mesh_.mat_lib();
-    auto &pin_mesh = pin.mesh();
-    auto areas     = pin_mesh.areas();
+    const auto &mat_lib  = mesh_.mat_lib();
+    const auto &pin_mesh = pin.mesh();
+    const auto &areas    = pin_mesh.areas();
 
     for (size_t ig = 0; ig < ng_; ig++) {
         int ireg     = 0;
         int ixsreg   = 0;
         real_t farea = 0.0;
         for (auto &mat_id : pin.mat_ids()) {
-            auto mat                      = mat_lib.get_material_by_id(mat_id);
+            const auto &mat               = mat_lib.get_material_by_id(mat_id);
             const ScatteringRow &scat_row = mat.xssc().to(ig);
             int gmin                      = scat_row.min_g;
             int gmax                      = scat_row.max_g;
@@ -264,8 +452,9 @@ void XSMeshHomogenized::homogenize_region_flux(int i, int first_reg,
 {
     assert(flux_);
 
-    // Extract a reference to the flux array.
-    const ArrayB2 flux = *flux_;
+    // Extract a reference to the flux array. This is a plain C++ reference
+    // rather than a blitz reference, since this is called concurrently.
+    const ArrayB2 &flux = *flux_;
 
     // Set the FSRs to be one element, representing the coarse mesh index to
     // which this \ref XSMeshRegion belongs.
@@ -277,9 +466,9 @@ void XSMeshHomogenized::homogenize_region_flux(int i, int first_reg,
 
     std::vector<VecF> scat(ng_, VecF(ng_, 0.0));
 
-    auto mat_lib   = mesh_.mat_lib();
-    auto &pin_mesh = pin.mesh();
-    auto areas     = pin_mesh.areas();
+    const auto &mat_lib  = mesh_.mat_lib();
+    const auto &pin_mesh = pin.mesh();
+    const auto &areas    = pin_mesh.areas();
 
     // Precompute the fission source in each region, since it is the
     // wieghting factor for chi
@@ -290,7 +479,7 @@ void XSMeshHomogenized::homogenize_region_flux(int i, int first_reg,
             int ireg_local = 0;
             int ixsreg     = 0;
             for (auto &mat_id : pin.mat_ids()) {
-                auto mat = mat_lib.get_material_by_id(mat_id);
+                const auto &mat = mat_lib.get_material_by_id(mat_id);
                 for (int i = 0; i < (int)pin_mesh.n_fsrs(ixsreg); i++) {
                     fs[ireg_local] +=
                         mat.xsnf(ig) * flux(ireg, ig) * areas[ireg_local];
@@ -314,7 +503,7 @@ void XSMeshHomogenized::homogenize_region_flux(int i, int first_reg,
         int ireg_local = 0;         // pin-local refion index
         int ixsreg     = 0;
         for (auto &mat_id : pin.mat_ids()) {
-            auto mat                      = mat_lib.get_material_by_id(mat_id);
+            const auto &mat               = mat_lib.get_material_by_id(mat_id);
             const ScatteringRow &scat_row = mat.xssc().to(ig);
             size_t gmin                   = scat_row.min_g;
             size_t gmax                   = scat_row.max_g;
@@ -63,6 +63,35 @@ public:
     XSMeshHomogenized(XSMeshHomogenized &other,
                       const std::vector<int> &regions);
 
+    /**
+     * \brief Construct a few-group \ref XSMeshHomogenized with the same
+     * regions as another
+     *
+     * \param fine the \ref XSMeshHomogenized to collapse
+     * \param coarse_group the coarse group to which each group of \p fine
+     * belongs. Coarse groups must be contiguous and in order.
+     *
+     * The new XSMesh gets its own storage, and its cross sections are only
+     * ever set by \ref collapse(); \ref update() leaves them alone.
+     */
+    XSMeshHomogenized(const XSMeshHomogenized &fine,
+                      const VecI &coarse_group);
+
+    /**
+     * \brief Collapse the cross sections of a fine-group XSMesh to the
+     * coarse group structure.
+     *
+     * \param fine the fine-group XSMesh, with the same regions as this one
+     * \param flux the fine-group flux to weight the cross sections with,
+     * indexed by (region, group), where the regions are those listed by
+     * XSMeshRegion::reg()
+     *
+     * The cross sections are flux-weighted, and the fission spectrum is
+     * summed. If there is no flux in any of the groups of a coarse group,
+     * the groups are weighted evenly.
+     */
+    void collapse(const XSMeshHomogenized &fine, const ArrayB2 &flux);
+
     /**
      * \brief \copybrief XSMesh::update()
      *
@@ -88,6 +117,71 @@ public:
         flux_ = &flux;
     }
 
+    /**
+     * \brief Only re-homogenize pins whose flux has changed by more than a
+     * relative tolerance since they were last homogenized.
+     *
+     * By default (zero tolerance), every pin is homogenized on every call to
+     * \ref update(). With a positive tolerance, a copy of the flux is kept to
+     * compare against.
+     */
+    void set_update_tolerance(real_t tol)
+    {
+        assert(tol >= 0.0);
+        update_tol_ = tol;
+    }
+
+    /**
+     * \brief Give this XSMesh its own copy of the cross sections.
+     *
+     * An \ref XSMeshHomogenized constructed as a map into another shares
+     * its cross sections with the original, so an \ref update() of one is
+     * seen by both. After detaching, this XSMesh starts from a copy of the
+     * current cross sections, and its updates are its own business. This is
+     * needed before doing incremental updates on a map, since skipping a pin
+     * would otherwise leave the other consumers with stale cross sections.
+     */
+    void detach();
+
+    /**
+     * \brief Return the number of pins that were skipped by the most recent
+     * incremental \ref update().
+     */
+    int n_skipped() const
+    {
+        return n_skipped_;
+    }
+
+    /**
+     * \brief Forget the flux that each pin was last homogenized with, so
+     * that the next \ref update() homogenizes every pin.
+     */
+    void reset_update()
+    {
+        flux_old_.free();
+    }
+
+    /**
+     * \brief Hold the homogenized cross sections at their current values.
+     *
+     * While held, \ref update() does nothing. This lets sweepers that share
+     * the cross sections run alongside a sweeper that is modifying the flux
+     * that they are homogenized with.
+     */
+    void set_hold(bool hold)
+    {
+        hold_ = hold;
+    }
+
+    /**
+     * Return whether the homogenized cross sections are being held. See \ref
+     * set_hold().
+     */
+    bool held() const
+    {
+        return hold_;
+    }
+
     /**
      * Generate output of important cross sections on the homogenized mesh
      */
@@ -99,6 +193,20 @@ private:
     // Possibly-associated flux for homogenization.
     const ArrayB2 *flux_;
 
+    // Relative flux change that triggers re-homogenization of a pin, and the
+    // flux that each pin was last homogenized with
+    real_t update_tol_;
+    ArrayB2 flux_old_;
+
+    // Number of pins skipped by the most recent update()
+    int n_skipped_;
+
+    // Whether update() is currently suppressed
+    bool hold_;
+
+    // Coarse group of each fine group, if this is a collapsed XSMesh
+    VecI coarse_group_;
+
     /**
     * \brief Populate the passed XSMeshRegion with homogenized cross sections
     * from a pin cell. No flux wieghting is performed, only volume weighting.
@@ -29,7 +29,13 @@ const static int out_w = 14;
 
 namespace {
 const std::vector<std::string> recognized_attributes = {
-    "type", "cmfd", "k_tol", "psi_tol", "max_iter", "min_iter"};
+    "type",     "cmfd",     "k_tol",           "psi_tol",
+    "max_iter", "min_iter", "group_iteration", "anderson_depth",
+    "cmfd_convergence"};
+
+// With adaptive inner iterations, the inner iterations are converged to this
+// fraction of the most recent fission source error
+const mocc::real_t inner_tolerance_factor = 0.1;
 }
 
 namespace mocc {
@@ -37,7 +43,10 @@ EigenSolver::EigenSolver(const pugi::xml_node &input, const CoreMesh &mesh)
     : fss_(input, mesh),
       fission_source_(fss_.sweeper()->n_reg_fission()),
       fission_source_prev_(fss_.sweeper()->n_reg_fission()),
-      min_iterations_(0)
+      min_iterations_(0),
+      cmfd_convergence_(CMFDConvergence::FIXED),
+      anderson_depth_(0),
+      anderson_used_(0)
 {
     LogFile << "Initializing Eigenvalue solver..." << std::endl;
 
@@ -81,6 +90,27 @@ EigenSolver::EigenSolver(const pugi::xml_node &input, const CoreMesh &mesh)
         min_iterations_ = in_int;
     }
 
+    // CMFD convergence criteria
+    if (!input.attribute("cmfd_convergence").empty()) {
+        std::string in_str = input.attribute("cmfd_convergence").value();
+        sanitize(in_str);
+        if (in_str == "fixed") {
+            cmfd_convergence_ = CMFDConvergence::FIXED;
+        } else if (in_str == "float") {
+            cmfd_convergence_ = CMFDConvergence::FLOAT;
+        } else {
+            throw EXCEPT("Unrecognized CMFD convergence option.");
+        }
+    }
+
+    // Anderson acceleration
+    if (!input.attribute("anderson_depth").empty()) {
+        anderson_depth_ = input.attribute("anderson_depth").as_int(-1);
+        if (anderson_depth_ < 0) {
+            throw EXCEPT("Invalid Anderson acceleration depth.");
+        }
+    }
+
     // Read in dump iterations if present
     if (!input.child("dump_iterations").empty()) {
         dump_iterations_ =
@@ -153,6 +183,10 @@ void EigenSolver::solve()
 
     fss_.sweeper()->calc_fission_source(keff_, fission_source_);
 
+    // Nothing is known about the fission source yet, so start the adaptive
+    // inner iterations from the loose end, as if its error were of order one
+    fss_.sweeper()->set_inner_tolerance(inner_tolerance_factor);
+
     LogScreen << std::setw(out_w) << "Time" << std::setw(out_w) << "Iter."
               << std::setw(out_w) << "k" << std::setw(out_w) << "k error"
               << std::setw(out_w) << "psi error" << std::endl;
@@ -183,10 +217,26 @@ void EigenSolver::solve()
         }
         error_psi_ = std::sqrt(efis / n_fissile_regions_);
 
+        // Tighten the inner iterations along with the outer iterations
+        const auto &inner_control = fss_.sweeper()->inner_control();
+        if (inner_control.adaptive()) {
+            LogFile << "Inner iterations (tolerance "
+                    << inner_control.tolerance() << "):";
+            for (auto n : inner_control.last_n_inner()) {
+                LogFile << " " << n;
+            }
+            LogFile << std::endl;
+            fss_.sweeper()->set_inner_tolerance(inner_tolerance_factor *
+                                                error_psi_);
+        }
+
         convergence_.push_back(
             ConvergenceCriteria(keff_, error_k_, error_psi_));
 
         iteration_times_.push_back(RootTimer.time());
+        if (anderson_depth_ > 0) {
+            anderson_history_.push_back(anderson_used_);
+        }
 
         this->print(n_iterations + 1, convergence_.back());
 
@@ -235,6 +285,9 @@ void EigenSolver::step()
     // jive with the normalization that is being done for the convergence
     // criterion.
     fss_.sweeper()->calc_fission_source(keff_, fission_source_);
+    if (anderson_depth_ > 0) {
+        this->anderson_mix();
+    }
     fission_source_prev_ = fission_source_;
     fss_.step();
 
@@ -272,8 +325,7 @@ void EigenSolver::do_cmfd()
     // Set the convergence criteria for this solve, there are a few ways we
     // can do this. This needs some work. Should probably be converging the
     // CMFD-transport sweeper residual, rather than the actual CMFD solution.
-    CMFDConvergence conv = CMFDConvergence::FIXED;
-    switch (conv) {
+    switch (cmfd_convergence_) {
     case CMFDConvergence::FIXED:
         break;
     case CMFDConvergence::FLOAT:
@@ -282,6 +334,8 @@ void EigenSolver::do_cmfd()
 
         real_t psi_tol = std::max(error_psi_ / 1000.0, tolerance_psi_ / 10.0);
         cmfd_->set_psi_tolerance(psi_tol);
+        LogFile << "CMFD tolerances: " << k_tol << " " << psi_tol
+                << std::endl;
         break;
     }
     cmfd_->solve(keff_);
@@ -290,6 +344,71 @@ void EigenSolver::do_cmfd()
     return;
 }
 
+void EigenSolver::anderson_mix()
+{
+    int n = fission_source_.size();
+
+    // Work with the shape of the fission source, since its magnitude drifts
+    // along with k
+    real_t total = 0.0;
+    for (const auto &v : fission_source_) {
+        total += v;
+    }
+    VectorX g(n);
+    for (int i = 0; i < n; i++) {
+        g[i] = fission_source_(i) / total;
+    }
+
+    anderson_used_ = 0;
+    if (anderson_x_.size() == n) {
+        // Update the history with the newest iterate
+        VectorX f = g - anderson_x_;
+        if (anderson_g_.size() == n) {
+            anderson_dg_.push_back(g - anderson_g_);
+            anderson_df_.push_back(f - anderson_f_);
+            if ((int)anderson_dg_.size() > anderson_depth_) {
+                anderson_dg_.pop_front();
+                anderson_df_.pop_front();
+            }
+        }
+        anderson_g_ = g;
+        anderson_f_ = f;
+
+        int m = anderson_df_.size();
+        if (m > 0) {
+            MatrixX df(n, m);
+            MatrixX dg(n, m);
+            for (int j = 0; j < m; j++) {
+                df.col(j) = anderson_df_[j];
+                dg.col(j) = anderson_dg_[j];
+            }
+            VectorX gamma = df.colPivHouseholderQr().solve(f);
+            VectorX x     = g - dg * gamma;
+
+            // Safeguard against unphysical fission sources
+            if (x.allFinite() && (x.minCoeff() >= 0.0)) {
+                g              = x;
+                anderson_used_ = m;
+            } else {
+                LogFile << "Anderson-mixed fission source is negative. "
+                           "Restarting the mixing history."
+                        << std::endl;
+                anderson_dg_.clear();
+                anderson_df_.clear();
+            }
+        }
+    }
+
+    // Remember the input to the next sweep, and preserve the total fission
+    // source
+    anderson_x_ = g;
+    for (int i = 0; i < n; i++) {
+        fission_source_(i) = g[i] * total;
+    }
+
+    return;
+}
+
 void EigenSolver::output(H5Node &file) const
 {
     VecF k;
@@ -312,6 +431,9 @@ void EigenSolver::output(H5Node &file) const
         g.write("error_psi", error_psi, dims);
         g.write("iteration_time", iteration_times_);
         g.write("abscissae", iteration_times_);
+        if (anderson_depth_ > 0) {
+            g.write("anderson_depth", anderson_history_, dims);
+        }
     }
 
     fss_.output(file);
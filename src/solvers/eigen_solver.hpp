@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <deque>
 #include <iosfwd>
 #include "util/h5file.hpp"
 #include "util/pugifwd.hpp"
@@ -56,6 +57,14 @@ public:
         return fss_.sweeper();
     }
 
+    /**
+     * \brief Return the convergence history, one entry per outer iteration.
+     */
+    const std::vector<ConvergenceCriteria> &convergence() const
+    {
+        return convergence_;
+    }
+
     // Implement the output interface
     void output(H5Node &file) const;
 
@@ -97,6 +106,9 @@ private:
     // CMFD accelerator
     UP_CMFD_t cmfd_;
 
+    // How to pick the CMFD convergence criteria for each solve
+    CMFDConvergence cmfd_convergence_;
+
     // Vector in indices after which to dump the state of the solver
     VecI dump_iterations_;
 
@@ -104,6 +116,21 @@ private:
     // at. Make useful absiccae for convergence plots and the like
     VecF iteration_times_;
 
+    // Anderson acceleration of the fission source. The depth is the maximum
+    // number of previous iterates to mix; zero disables the acceleration.
+    // The histories are kept as differences between successive iterates of
+    // the fission source shape, G(x), and the residual, G(x) - x.
+    int anderson_depth_;
+    std::deque<VectorX> anderson_dg_;
+    std::deque<VectorX> anderson_df_;
+    VectorX anderson_x_;
+    VectorX anderson_g_;
+    VectorX anderson_f_;
+    // Number of iterates actually mixed on the most recent step, and for
+    // each iteration, for the output
+    int anderson_used_;
+    VecI anderson_history_;
+
     // Methods
     // Print the current state of the eigenvalue solver
     void print(int iter, ConvergenceCriteria conv);
@@ -112,5 +139,24 @@ private:
      * \brief Perform a CMFD accelerator solve
      */
     void do_cmfd();
+
+    /**
+     * \brief Replace the fission source with an Anderson-mixed fission
+     * source.
+     *
+     * The outer iteration is treated as a fixed-point iteration on the shape
+     * of the fission source, \f$x_{n+1} = G(x_n)\f$, where \f$G\f$ is a
+     * transport sweep (and CMFD solve, if enabled). The new fission source
+     * is taken as the combination of the most recent iterates that minimizes
+     * the L-2 norm of the residual, \f$G(x) - x\f$.
+     *
+     * If the mixed fission source has any negative values, it is discarded
+     * in favor of the plain power iteration update and the history is
+     * cleared. The total fission source is always preserved, so that the
+     * eigenvalue update in \ref step() is unaffected.
+     *
+     * \pre \c fission_source_ contains \f$G(x_n)\f$.
+     */
+    void anderson_mix();
 };
 }
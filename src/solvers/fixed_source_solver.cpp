@@ -16,11 +16,15 @@
 
 #include "fixed_source_solver.hpp"
 
+#include <cmath>
+#include <iomanip>
 #include <iostream>
 #include "pugixml.hpp"
 #include "util/error.hpp"
 #include "util/files.hpp"
 #include "util/h5file.hpp"
+#include "util/string_utils.hpp"
+#include "gmres.hpp"
 #include "transport_sweeper_factory.hpp"
 
 namespace mocc {
@@ -30,9 +34,26 @@ FixedSourceSolver::FixedSourceSolver(const pugi::xml_node &input,
       source_(sweeper_->create_source(input.child("source"))),
       fs_(nullptr),
       ng_(sweeper_->n_group()),
+      gmres_(false),
+      gmres_restart_(20),
+      jacobi_(false),
       fixed_source_(false) {
     LogFile << "Initializing Fixed-Source solver..." << std::endl;
 
+    // Determine the group iteration scheme
+    if (!input.attribute("group_iteration").empty()) {
+        std::string in_string = input.attribute("group_iteration").value();
+        sanitize(in_string);
+        if (in_string == "jacobi" || in_string == "j") {
+            jacobi_ = true;
+            mg_source_.resize(sweeper_->n_reg(), ng_);
+            LogFile << "Using Jacobi group iteration" << std::endl;
+        } else if (in_string == "gs") {
+        } else {
+            throw EXCEPT("Unrecognized group iteration option.");
+        }
+    }
+
     std::string type = input.attribute("type").value();
     // See if we are creating a fully-specified FSS. If the passed-in input is
     // type="fixed_source" do extra stuff.
@@ -58,6 +79,44 @@ FixedSourceSolver::FixedSourceSolver(const pugi::xml_node &input,
                 << std::endl;
         LogFile << "Flux tolerance: " << flux_tol_ << std::endl;
 
+        // Iteration scheme
+        if (!input.attribute("iteration").empty()) {
+            std::string in_string = input.attribute("iteration").value();
+            sanitize(in_string);
+            if (in_string == "gmres") {
+                gmres_ = true;
+            } else if (in_string == "source") {
+            } else {
+                throw EXCEPT("Unrecognized fixed source iteration option.");
+            }
+        }
+        if (gmres_) {
+            gmres_restart_ = input.attribute("gmres_restart").as_int(20);
+            if (gmres_restart_ < 1) {
+                throw EXCEPT("Invalid GMRES restart length (gmres_restart).");
+            }
+            for (auto bc : mesh.boundary()) {
+                if ((bc != Boundary::VACUUM) && (bc != Boundary::PRESCRIBED)) {
+                    throw EXCEPT("GMRES fixed source iteration only supports "
+                                 "vacuum and prescribed boundary conditions.");
+                }
+            }
+            // GMRES needs a sweep to be a fixed, affine map of the flux.
+            // Adaptive inner iterations and sweepers that lean on CMFD
+            // between sweeps both make it depend on the iteration history.
+            if (sweeper_->inner_control().adaptive()) {
+                throw EXCEPT("GMRES fixed source iteration does not support "
+                             "adaptive inner iterations (inner_tol).");
+            }
+            std::string sweeper_type =
+                input.child("sweeper").attribute("type").value();
+            if ((sweeper_type == "2d3d") || (sweeper_type == "moc_2d3d")) {
+                throw EXCEPT("GMRES fixed source iteration does not support "
+                             "sweepers that require CMFD.");
+            }
+            LogFile << "Using GMRES(" << gmres_restart_ << ")" << std::endl;
+        }
+
         // Source
         if (input.child("source").empty()) {
             throw EXCEPT("Top-level fixed source solver needs an explicit "
@@ -78,6 +137,11 @@ FixedSourceSolver::FixedSourceSolver(const pugi::xml_node &input,
 // Perform source iteration
 void FixedSourceSolver::solve()
 {
+    if (gmres_) {
+        this->solve_gmres();
+        return;
+    }
+
     this->initialize();
     real_t resid = 0.0;
     for (size_t iouter = 0; iouter < max_iter_; iouter++) {
@@ -98,11 +162,104 @@ void FixedSourceSolver::solve()
     return;
 }
 
+void FixedSourceSolver::solve_gmres()
+{
+    this->initialize();
+
+    const int n = sweeper_->n_reg() * ng_;
+
+    // G(0) is the flux due to the fixed source alone, which is the right-hand
+    // side of (I - M)x = b
+    VectorX b   = this->sweep_flux(VectorX::Zero(n));
+    int n_sweep = 1;
+
+    LinearOperator op = [this, &b](const VectorX &v) -> VectorX {
+        return v - (this->sweep_flux(v) - b);
+    };
+    GMRESResult result =
+        gmres(op, b, gmres_restart_, (int)max_iter_ - n_sweep, flux_tol_);
+    n_sweep += result.n_apply;
+    const VectorX &x = result.x;
+    LogScreen << n_sweep << " " << std::setprecision(15) << result.resid
+              << std::endl;
+
+    // Confirm convergence with the true residual. This also leaves the
+    // sweeper with the flux from a sweep of the solution, as source
+    // iteration would
+    bool converged = false;
+    if (result.converged && (n_sweep < (int)max_iter_)) {
+        VectorX r = this->sweep_flux(x) - x;
+        n_sweep++;
+        converged = r.norm() < flux_tol_;
+    }
+
+    if (!converged) {
+        // Hand back the latest GMRES iterate
+        ArrayB2 &flux = sweeper_->flux();
+        int n_reg     = sweeper_->n_reg();
+        for (int ig = 0; ig < (int)ng_; ig++) {
+            for (int i = 0; i < n_reg; i++) {
+                flux(i, ig) = x[ig * n_reg + i];
+            }
+        }
+        LogScreen << "Maximum number (" << max_iter_ << ") of sweeps "
+                     "performed before convergence!"
+                  << std::endl;
+    }
+
+    LogFile << "GMRES fixed source solve took " << n_sweep << " sweeps"
+            << std::endl;
+    return;
+}
+
+VectorX FixedSourceSolver::sweep_flux(const VectorX &flux_in)
+{
+    ArrayB2 &flux = sweeper_->flux();
+    int n_reg     = sweeper_->n_reg();
+    for (int ig = 0; ig < (int)ng_; ig++) {
+        for (int i = 0; i < n_reg; i++) {
+            flux(i, ig) = flux_in[ig * n_reg + i];
+        }
+    }
+
+    this->step();
+
+    VectorX flux_out(flux_in.size());
+    for (int ig = 0; ig < (int)ng_; ig++) {
+        for (int i = 0; i < n_reg; i++) {
+            flux_out[ig * n_reg + i] = flux(i, ig);
+        }
+    }
+    return flux_out;
+}
+
 // Perform a single group sweep
 void FixedSourceSolver::step()
 {
     // Tell the sweeper to stash its old flux
     sweeper_->store_old_flux();
+
+    if (jacobi_) {
+        // Form the sources for all groups from the previous iterate, then
+        // sweep them all together
+        int n_reg = sweeper_->n_reg();
+        for (size_t ig = 0; ig < ng_; ig++) {
+            source_->initialize_group(ig);
+            if (fs_) {
+                source_->fission(*fs_, ig);
+            }
+
+            source_->in_scatter(ig);
+
+            for (int i = 0; i < n_reg; i++) {
+                mg_source_(i, (int)ig) = (*source_)[i];
+            }
+        }
+
+        sweeper_->sweep_multigroup(mg_source_);
+        return;
+    }
+
     for (size_t ig = 0; ig < ng_; ig++) {
         // Set up the source
         source_->initialize_group(ig);
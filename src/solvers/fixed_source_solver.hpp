@@ -17,6 +17,7 @@
 #pragma once
 
 #include "core/core_mesh.hpp"
+#include "core/eigen_interface.hpp"
 #include "util/h5file.hpp"
 #include "util/pugifwd.hpp"
 #include "core/source.hpp"
@@ -46,12 +47,22 @@ public:
     * Ideally, this would solve a fixed source problem subject to the
     * configuration in the XML input. This can either be to some sort of
     * tolerance, or for a fixed number of group sweeps.
+    *
+    * By default this performs source iteration. With \c iteration="gmres",
+    * the problem is handed to \ref solve_gmres() instead.
     */
     void solve();
 
     /**
     * Instructs the sweeper to store the old value of the flux, then performs a
     * group sweep.
+    *
+    * By default, groups are swept in Gauss-Seidel fashion, with each group's
+    * in-scatter source using the most recent flux of the other groups. If
+    * the solver is configured with \c group_iteration="jacobi", the sources
+    * for all groups are formed up front from the previous iterate and the
+    * sweeper is allowed to sweep all groups at once (see \ref
+    * TransportSweeper::sweep_multigroup()).
     */
     void step();
 
@@ -116,9 +127,49 @@ private:
     const ArrayB1 *fs_;
     size_t ng_;
 
+    // Whether to solve a standalone problem with GMRES rather than source
+    // iteration, and the number of sweeps between GMRES restarts
+    bool gmres_;
+    int gmres_restart_;
+
+    // Whether to use Jacobi-style group iteration, and the multigroup source
+    // to use if so
+    bool jacobi_;
+    ArrayB2 mg_source_;
+
     // Stuff that we should only need if we are doing a standalone FS solve
     bool fixed_source_;
     size_t max_iter_;
     real_t flux_tol_;
+
+    /**
+     * \brief Solve the fixed-source problem with restarted GMRES
+     *
+     * A call to \ref step() maps the multigroup scalar flux to a new one,
+     * \f$ G(\phi) = M\phi + b \f$, where \f$ b \f$ is the flux due to the
+     * fixed source alone. Source iteration looks for the fixed point of
+     * \f$ G \f$, which is the solution of \f$ (I - M)\phi = b \f$. Here,
+     * that system is solved with GMRES, using the sweeper to apply \f$ M \f$
+     * without ever forming it. Each GMRES iteration costs one sweep, the
+     * same as an iteration of source iteration, but converges much faster
+     * for scattering-dominated problems. The GMRES residual is the change
+     * in the flux over a sweep, so \c flux_tol means the same thing as for
+     * source iteration.
+     *
+     * The angular flux on the domain boundary is stored by the sweeper
+     * rather than the GMRES vector, so only vacuum and prescribed boundary
+     * conditions, for which \f$ G \f$ depends only on the scalar flux, are
+     * supported. For the same reason, adaptive inner iterations and the 2D3D
+     * sweepers, which are coupled through CMFD, are rejected.
+     */
+    void solve_gmres();
+
+    /**
+     * \brief Load the passed multigroup flux into the sweeper, perform a
+     * \ref step(), and return the resulting flux.
+     *
+     * The flux vectors are ordered group-major, (group, region).
+     */
+    VectorX sweep_flux(const VectorX &flux_in);
 };
 }
@@ -0,0 +1,117 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "gmres.hpp"
+
+#include <cmath>
+
+namespace mocc {
+GMRESResult gmres(const LinearOperator &op, const VectorX &b, int restart,
+                  int max_apply, real_t tol)
+{
+    const int n = b.size();
+    const int m = restart;
+
+    GMRESResult result;
+    result.x        = VectorX::Zero(n);
+    result.n_apply  = 0;
+    result.n_krylov = 0;
+
+    VectorX r = b;
+
+    MatrixX V(n, m + 1);
+    MatrixX H(m + 1, m);
+    VectorX cs(m);
+    VectorX sn(m);
+    VectorX g(m + 1);
+
+    result.resid     = r.norm();
+    result.converged = result.resid < tol;
+    while (!result.converged && (result.resid > 0.0) &&
+           (result.n_apply < max_apply)) {
+        // Arnoldi process, with Givens rotations to keep the least-squares
+        // problem upper triangular
+        H.setZero();
+        g.setZero();
+        g(0)           = result.resid;
+        V.col(0)       = r / result.resid;
+        int k          = 0;
+        bool breakdown = false;
+        while ((k < m) && (result.n_apply < max_apply)) {
+            VectorX w = op(V.col(k));
+            result.n_apply++;
+
+            for (int j = 0; j <= k; j++) {
+                H(j, k) = V.col(j).dot(w);
+                w -= H(j, k) * V.col(j);
+            }
+            H(k + 1, k) = w.norm();
+            breakdown   = H(k + 1, k) <= 0.0;
+            if (!breakdown) {
+                V.col(k + 1) = w / H(k + 1, k);
+            }
+
+            for (int j = 0; j < k; j++) {
+                real_t h    = cs(j) * H(j, k) + sn(j) * H(j + 1, k);
+                H(j + 1, k) = -sn(j) * H(j, k) + cs(j) * H(j + 1, k);
+                H(j, k)     = h;
+            }
+            real_t d = std::sqrt(H(k, k) * H(k, k) +
+                                 H(k + 1, k) * H(k + 1, k));
+            if (d == 0.0) {
+                // The new column is entirely in the span of the previous
+                // ones, so the Hessenberg matrix is singular. Drop the column
+                // and settle for the solution on the first k vectors.
+                break;
+            }
+            cs(k)       = H(k, k) / d;
+            sn(k)       = H(k + 1, k) / d;
+            H(k, k)     = d;
+            H(k + 1, k) = 0.0;
+            g(k + 1)    = -sn(k) * g(k);
+            g(k)        = cs(k) * g(k);
+            k++;
+
+            result.resid     = std::abs(g(k));
+            result.converged = result.resid < tol;
+            if (breakdown || result.converged) {
+                break;
+            }
+        }
+        result.n_krylov = k;
+
+        if (k > 0) {
+            VectorX y = H.topLeftCorner(k, k)
+                            .triangularView<Eigen::Upper>()
+                            .solve(g.head(k));
+            result.x += V.leftCols(k) * y;
+        }
+
+        if (breakdown || result.converged ||
+            (result.n_apply >= max_apply)) {
+            break;
+        }
+
+        // Restart from the true residual
+        r = b - op(result.x);
+        result.n_apply++;
+        result.resid     = r.norm();
+        result.converged = result.resid < tol;
+    }
+
+    return result;
+}
+}
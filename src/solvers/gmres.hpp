@@ -0,0 +1,65 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <functional>
+#include "util/global_config.hpp"
+#include "core/eigen_interface.hpp"
+
+namespace mocc {
+/**
+ * A matrix-free linear operator, returning the product of the operator with
+ * the passed vector
+ */
+typedef std::function<VectorX(const VectorX &)> LinearOperator;
+
+/**
+ * Outcome of a call to \ref gmres()
+ */
+struct GMRESResult {
+    /// The solution estimate
+    VectorX x;
+    /// Number of times the operator was applied
+    int n_apply;
+    /// Number of Krylov vectors in the final restart cycle
+    int n_krylov;
+    /// Residual norm at exit
+    real_t resid;
+    /// Whether \c resid fell below the tolerance
+    bool converged;
+};
+
+/**
+ * \brief Solve \f$ Ax = b \f$ with restarted GMRES, starting from \f$ x = 0
+ * \f$
+ *
+ * \param op the operator, \f$ A \f$
+ * \param b the right-hand side
+ * \param restart the maximum number of Krylov vectors per restart cycle
+ * \param max_apply the maximum number of applications of \p op
+ * \param tol the absolute residual norm at which to stop
+ *
+ * Within a cycle, the residual is the estimate from the Givens-rotated
+ * Hessenberg system, which costs nothing to evaluate. Each restart begins
+ * from the true residual, \f$ b - Ax \f$, which costs one application of \p
+ * op. The solve stops on convergence, when \p max_apply is reached, or when
+ * the Arnoldi process breaks down, in which case the Krylov space is
+ * invariant and restarting would not improve on the solution.
+ */
+GMRESResult gmres(const LinearOperator &op, const VectorX &b, int restart,
+                  int max_apply, real_t tol);
+}
@@ -0,0 +1,369 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "jfnk_eigen_solver.hpp"
+
+#include <cmath>
+#include <iomanip>
+#include "pugixml.hpp"
+#include "util/error.hpp"
+#include "util/files.hpp"
+#include "util/utils.hpp"
+#include "util/validate_input.hpp"
+#include "core/globals.hpp"
+#include "gmres.hpp"
+
+const static int out_w = 14;
+
+namespace {
+const std::vector<std::string> recognized_attributes = {
+    "type",       "cmfd",        "k_tol",     "psi_tol",        "max_iter",
+    "power_iter", "krylov_iter", "krylov_tol", "group_iteration"};
+
+// Relative size of the finite difference perturbation used to approximate
+// Jacobian-vector products. This is larger than the usual square root of
+// machine precision, since G is only as smooth as the inner iterations and
+// CMFD solve are converged.
+const mocc::real_t fd_perturbation = 1.0e-6;
+
+// Convergence criteria for the CMFD solve inside G. These need to be far
+// below the finite difference perturbation, or the Jacobian-vector products
+// are dominated by the CMFD iteration error rather than the change in G.
+const mocc::real_t cmfd_tolerance = 1.0e-4 * fd_perturbation;
+}
+
+namespace mocc {
+JFNKEigenSolver::JFNKEigenSolver(const pugi::xml_node &input,
+                                 const CoreMesh &mesh)
+    : fss_(input, mesh),
+      fission_source_(fss_.sweeper()->n_reg_fission()),
+      fission_source_prev_(fss_.sweeper()->n_reg_fission()),
+      n_power_(3),
+      krylov_max_(10),
+      krylov_tol_(0.1),
+      n_flux_(fss_.sweeper()->n_reg() * fss_.sweeper()->n_group()),
+      n_boundary_(fss_.sweeper()->n_boundary_values()),
+      total_fission_(1.0),
+      n_sweep_(0),
+      n_krylov_(0)
+{
+    LogFile << "Initializing JFNK Eigenvalue solver..." << std::endl;
+
+    if (input.empty()) {
+        throw EXCEPT("No input specified for the eigenvalue solver.");
+    }
+
+    validate_input(input, recognized_attributes);
+
+    // K tolerance
+    tolerance_k_ = input.attribute("k_tol").as_float(-1.0);
+    if (tolerance_k_ <= 0.0) {
+        throw EXCEPT("Invalid k tolerance.");
+    }
+
+    // Psi tolerance
+    tolerance_psi_ = input.attribute("psi_tol").as_float(-1.0);
+    if (tolerance_psi_ <= 0.0) {
+        throw EXCEPT("Invalid psi tolerance.");
+    }
+
+    // Max iterations
+    int in_int = input.attribute("max_iter").as_int(-1);
+    if (in_int < 0) {
+        throw EXCEPT("Invalid number of maximum iterations.");
+    }
+    max_iterations_ = in_int;
+
+    // Initial power iterations
+    if (!input.attribute("power_iter").empty()) {
+        n_power_ = input.attribute("power_iter").as_int(-1);
+        if (n_power_ < 0) {
+            throw EXCEPT("Invalid number of initial power iterations.");
+        }
+    }
+
+    // Krylov iteration controls
+    if (!input.attribute("krylov_iter").empty()) {
+        krylov_max_ = input.attribute("krylov_iter").as_int(-1);
+        if (krylov_max_ < 1) {
+            throw EXCEPT("Invalid number of Krylov iterations.");
+        }
+    }
+    if (!input.attribute("krylov_tol").empty()) {
+        krylov_tol_ = input.attribute("krylov_tol").as_float(-1.0);
+        if ((krylov_tol_ <= 0.0) || (krylov_tol_ >= 1.0)) {
+            throw EXCEPT("Invalid Krylov tolerance.");
+        }
+    }
+
+    LogFile << "Power iterations: " << n_power_ << std::endl;
+    LogFile << "Krylov iterations per Newton step: " << krylov_max_
+            << std::endl;
+    LogFile << "Krylov tolerance: " << krylov_tol_ << std::endl;
+
+    // Count the number of fissile mesh regions
+    n_fissile_regions_ = 0;
+    for (const auto &xsr : fss_.sweeper()->xs_mesh()) {
+        bool has_fission = false;
+        for (int ig = 0; ig < xsr.n_group(); ig++) {
+            if (xsr.xsmacnf(ig) > 0.0) {
+                has_fission = true;
+                break;
+            }
+        }
+        if (has_fission) {
+            n_fissile_regions_ += xsr.reg().size();
+        }
+    }
+
+    // CMFD acceleration
+    bool do_cmfd = input.attribute("cmfd").as_bool(false);
+    if (do_cmfd) {
+        cmfd_.reset(new CMFD(input.child("cmfd"), &mesh,
+                             fss_.sweeper()->get_homogenized_xsmesh()));
+        CoarseData *const cd = cmfd_->get_data();
+        fss_.sweeper()->set_coarse_data(cd);
+        cmfd_->set_k_tolerance(cmfd_tolerance);
+        cmfd_->set_psi_tolerance(cmfd_tolerance);
+    }
+
+    LogFile << "Done initializing JFNK Eigenvalue solver." << std::endl;
+
+    return;
+}
+
+void JFNKEigenSolver::solve()
+{
+    LogScreen << "Converging to: \n"
+                 "\t Eigenvalue: "
+              << tolerance_k_ << "\n"
+              << "\t Fission Source (L-2 norm): " << tolerance_psi_ << "\n"
+              << "\t Max Iterations: " << max_iterations_ << "\n\n";
+
+    fss_.initialize();
+    fss_.set_fission_source(&fission_source_);
+
+    // Start from the initial guess of the sweeper, with k = 1
+    TransportSweeper *sweeper = fss_.sweeper();
+    const ArrayB2 &flux       = sweeper->flux();
+    int n_reg                 = sweeper->n_reg();
+    u_.resize(n_flux_ + n_boundary_ + 1);
+    for (int ig = 0; ig < sweeper->n_group(); ig++) {
+        for (int i = 0; i < n_reg; i++) {
+            u_[ig * n_reg + i] = flux(i, ig);
+        }
+    }
+    sweeper->get_boundary_values(u_.data() + n_flux_);
+    u_[n_flux_ + n_boundary_] = 1.0;
+
+    total_fission_ = sweeper->total_fission(false);
+    if (!(total_fission_ > 0.0)) {
+        throw EXCEPT("The JFNK eigenvalue solver needs a fissile problem.");
+    }
+
+    g_ = this->outer_iteration(u_);
+
+    LogScreen << std::setw(out_w) << "Time" << std::setw(out_w) << "Iter."
+              << std::setw(out_w) << "k" << std::setw(out_w) << "k error"
+              << std::setw(out_w) << "psi error" << std::setw(out_w)
+              << "Sweeps" << std::endl;
+
+    for (size_t n_iterations = 0; n_iterations < max_iterations_;
+         n_iterations++) {
+        if ((int)n_iterations < n_power_) {
+            u_ = g_;
+            g_ = this->outer_iteration(u_);
+        } else {
+            this->step();
+        }
+
+        convergence_.push_back(ConvergenceCriteria(
+            g_[n_flux_ + n_boundary_], error_k_, error_psi_));
+        iteration_times_.push_back(RootTimer.time());
+        sweep_history_.push_back(n_sweep_);
+
+        this->print(n_iterations + 1, convergence_.back());
+
+        // Check for NaN
+        if (convergence_.back().k != convergence_.back().k) {
+            throw EXCEPT("Eigenvalue is not a number. Giving up.");
+        }
+
+        if ((error_k_ < tolerance_k_) && (error_psi_ < tolerance_psi_)) {
+            LogScreen << "Convergence criteria satisfied!" << std::endl;
+            break;
+        }
+
+        if (n_iterations == (max_iterations_ - 1)) {
+            LogScreen << "Maximum number of iterations reached!" << std::endl;
+        }
+    }
+
+    LogFile << "JFNK eigenvalue solve took " << n_sweep_ << " sweeps"
+            << std::endl;
+
+    return;
+} // solve()
+
+void JFNKEigenSolver::step()
+{
+    const int n = u_.size();
+    const int m = krylov_max_;
+
+    // Solve J du = -F(u) with GMRES, starting from du = 0. The Jacobian is
+    // never formed; its product with a vector, v, is approximated by
+    //    J v = v - (G(u + eps v) - G(u)) / eps
+    VectorX f       = u_ - g_;
+    real_t f_norm   = f.norm();
+    real_t u_factor = u_.cwiseAbs().sum() / n;
+
+    // GMRES only applies the operator to its Krylov vectors, which have unit
+    // norm
+    LinearOperator jv = [this, u_factor](const VectorX &v) -> VectorX {
+        real_t eps = fd_perturbation * (u_factor + 1.0);
+        return v - (this->outer_iteration(u_ + eps * v) - g_) / eps;
+    };
+    GMRESResult result = gmres(jv, -f, m, m, krylov_tol_ * f_norm);
+    n_krylov_          = result.n_krylov;
+    VectorX u_new      = u_ + result.x;
+
+    LogFile << "Newton step: " << n_krylov_ << " Krylov iterations, "
+            << "Krylov residual " << result.resid / f_norm << std::endl;
+
+    // Take the Newton step if it reduces the residual. Otherwise, fall back
+    // to a power iteration.
+    if (u_new.allFinite() && (u_new[n - 1] > 0.0)) {
+        VectorX g_new = this->outer_iteration(u_new);
+        if ((u_new - g_new).norm() < f_norm) {
+            u_ = u_new;
+            g_ = g_new;
+            return;
+        }
+    }
+
+    LogFile << "Newton step did not reduce the residual. Falling back to "
+               "power iteration."
+            << std::endl;
+    u_ = g_;
+    g_ = this->outer_iteration(u_);
+
+    return;
+}
+
+VectorX JFNKEigenSolver::outer_iteration(const VectorX &u)
+{
+    TransportSweeper *sweeper = fss_.sweeper();
+    ArrayB2 &flux             = sweeper->flux();
+    int n_reg                 = sweeper->n_reg();
+    int n_group               = sweeper->n_group();
+
+    // Load the state into the sweeper
+    for (int ig = 0; ig < n_group; ig++) {
+        for (int i = 0; i < n_reg; i++) {
+            flux(i, ig) = u[ig * n_reg + i];
+        }
+    }
+    sweeper->set_boundary_values(u.data() + n_flux_);
+    real_t k = u[n_flux_ + n_boundary_];
+
+    // Sweep, and update k
+    sweeper->calc_fission_source(k, fission_source_);
+    fission_source_prev_ = fission_source_;
+    fss_.step();
+    n_sweep_++;
+
+    real_t k_new =
+        k * sweeper->total_fission(false) / sweeper->total_fission(true);
+
+    // The CMFD solve starts from scratch every time, so that G is a function
+    // of u alone, rather than of the history of the CMFD solver
+    if (cmfd_ && cmfd_->is_enabled()) {
+        cmfd_->reset();
+        cmfd_->coarse_data().flux =
+            sweeper->get_pin_flux(MeshTreatment::PIN_PLANE);
+        cmfd_->solve(k_new);
+        sweeper->set_pin_flux(cmfd_->flux(), MeshTreatment::PIN_PLANE);
+    }
+
+    // Change in k and the fission source distribution
+    error_k_ = std::abs(k_new - k);
+
+    sweeper->calc_fission_source(k_new, fission_source_);
+    Normalize(fission_source_.begin(), fission_source_.end());
+    Normalize(fission_source_prev_.begin(), fission_source_prev_.end());
+    real_t efis = 0.0;
+    for (int i = 0; i < (int)fission_source_.size(); i++) {
+        real_t e = fission_source_(i) - fission_source_prev_(i);
+        efis += e * e;
+    }
+    error_psi_ = std::sqrt(efis / n_fissile_regions_);
+
+    // Pull the new state back out, preserving the total fission
+    real_t scale = total_fission_ / sweeper->total_fission(false);
+
+    VectorX g(u.size());
+    for (int ig = 0; ig < n_group; ig++) {
+        for (int i = 0; i < n_reg; i++) {
+            g[ig * n_reg + i] = scale * flux(i, ig);
+        }
+    }
+    sweeper->get_boundary_values(g.data() + n_flux_);
+    g.segment(n_flux_, n_boundary_) *= scale;
+    g[n_flux_ + n_boundary_] = k_new;
+
+    return g;
+}
+
+void JFNKEigenSolver::print(int iter, ConvergenceCriteria conv)
+{
+    LogScreen << std::setw(out_w) << std::fixed << std::setprecision(5)
+              << RootTimer.time() << std::setw(out_w) << iter << conv
+              << std::setw(out_w) << n_sweep_ << std::endl;
+    return;
+}
+
+void JFNKEigenSolver::output(H5Node &file) const
+{
+    VecF k;
+    VecF error_k;
+    VecF error_psi;
+
+    for (auto &c : convergence_) {
+        k.push_back(c.k);
+        error_k.push_back(c.error_k);
+        error_psi.push_back(c.error_psi);
+    }
+
+    VecI dims(1, convergence_.size());
+
+    {
+        auto g = file.create_group("convergence");
+
+        g.write("k", k, dims);
+        g.write("error_k", error_k, dims);
+        g.write("error_psi", error_psi, dims);
+        g.write("iteration_time", iteration_times_);
+        g.write("abscissae", iteration_times_);
+        g.write("n_sweep", sweep_history_, dims);
+    }
+
+    fss_.output(file);
+    if (cmfd_) {
+        cmfd_->output(file);
+    }
+    return;
+}
+}
@@ -0,0 +1,173 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include "util/h5file.hpp"
+#include "util/pugifwd.hpp"
+#include "core/cmfd.hpp"
+#include "core/core_mesh.hpp"
+#include "core/eigen_interface.hpp"
+#include "core/transport_sweeper.hpp"
+#include "eigen_solver.hpp"
+#include "fixed_source_solver.hpp"
+#include "solver.hpp"
+
+namespace mocc {
+/**
+ * \brief Jacobian-free Newton-Krylov (JFNK) solver for the k-eigenvalue
+ * problem.
+ *
+ * An outer iteration of the \ref EigenSolver maps the state of the problem,
+ * \f$ u = (\phi, \psi_b, k) \f$, to a new one, \f$ G(u) \f$, where \f$ \phi
+ * \f$ is the multigroup scalar flux, \f$ \psi_b \f$ is the incoming boundary
+ * angular flux and \f$ k \f$ is the eigenvalue. \f$ G \f$ is a \ref
+ * FixedSourceSolver::step() with the fission source formed from \f$ \phi \f$
+ * and \f$ k \f$, an update of \f$ k \f$ from the ratio of the total fission
+ * before and after the sweep, and, if enabled, a CMFD solve. The new flux is
+ * scaled to preserve the total fission of the initial guess, which pins
+ * down the magnitude of the eigenvector.
+ *
+ * Power iteration is the fixed-point iteration \f$ u_{n+1} = G(u_n) \f$.
+ * Here, Newton's method is applied to \f$ F(u) = u - G(u) = 0 \f$ instead.
+ * Each Newton step is solved approximately with GMRES, and the products of
+ * the Jacobian with the Krylov vectors are approximated by finite
+ * differences of \f$ F \f$, so each GMRES iteration costs one sweep. With
+ * CMFD enabled, the CMFD solve acts as a nonlinear preconditioner: the
+ * Jacobian of the accelerated \f$ G \f$ has far less of the slowly
+ * converging, high dominance ratio error modes left in it, so few Krylov
+ * iterations are needed for each Newton step.
+ *
+ * A few plain power iterations are performed up front to get into the
+ * neighborhood of the solution. If a Newton step fails to reduce the norm
+ * of \f$ F \f$, it is discarded in favor of a power iteration.
+ *
+ * Since the finite differences are taken through a full sweep, the sweeper
+ * inner iterations should be converged tightly enough that \f$ G \f$ is a
+ * smooth function of its input. Adaptive inner iterations are left at their
+ * initial tolerance. The CMFD solve is reset before every evaluation of \f$
+ * G \f$, so that nothing carries over from one evaluation to the next, and
+ * is converged well below the finite difference perturbation, regardless of
+ * the tolerances on the \<cmfd\> input.
+ */
+class JFNKEigenSolver : public Solver {
+public:
+    JFNKEigenSolver(const pugi::xml_node &input, const CoreMesh &mesh);
+
+    void solve();
+
+    /**
+     * \brief Perform a single Newton step.
+     *
+     * \pre The current iterate and its image under the outer iteration are
+     * already available.
+     */
+    void step();
+
+    const TransportSweeper *sweeper() const
+    {
+        return fss_.sweeper();
+    }
+
+    /**
+     * \brief Return the convergence history, one entry per iteration.
+     */
+    const std::vector<ConvergenceCriteria> &convergence() const
+    {
+        return convergence_;
+    }
+
+    // Implement the output interface
+    void output(H5Node &file) const;
+
+private:
+    // Data
+    FixedSourceSolver fss_;
+
+    // Fission source, and the fission source of the previous iterate
+    ArrayB1 fission_source_;
+    ArrayB1 fission_source_prev_;
+
+    // Convergence criterion for the system eigenvalue
+    real_t tolerance_k_;
+
+    // Convergence criterion for the fission source distribution (L-2 norm)
+    real_t tolerance_psi_;
+
+    // Change in k and fission source over the most recent outer iteration
+    real_t error_k_;
+    real_t error_psi_;
+
+    // Maximum number of iterations, including the initial power iterations
+    unsigned int max_iterations_;
+
+    // Number of power iterations to perform before starting Newton
+    int n_power_;
+
+    // Maximum number of GMRES iterations for each Newton step, and the
+    // relative reduction in the Newton residual at which to stop them
+    int krylov_max_;
+    real_t krylov_tol_;
+
+    // Number of fissile regions in the problem. We will use this to scale
+    // the volumetric convergence criteria
+    int n_fissile_regions_;
+
+    // Sizes of the scalar flux and boundary flux portions of the state
+    int n_flux_;
+    int n_boundary_;
+
+    // Total fission of the initial guess, which is preserved by the outer
+    // iteration
+    real_t total_fission_;
+
+    // The current iterate, u, and G(u)
+    VectorX u_;
+    VectorX g_;
+
+    // Total number of sweeps (evaluations of G) so far
+    int n_sweep_;
+
+    // Number of GMRES iterations used by the most recent Newton step
+    int n_krylov_;
+
+    // Convergence history, along with the time and total number of sweeps
+    // at the end of each iteration
+    std::vector<ConvergenceCriteria> convergence_;
+    VecF iteration_times_;
+    VecI sweep_history_;
+
+    // CMFD accelerator
+    UP_CMFD_t cmfd_;
+
+    // Methods
+    // Print the current state of the eigenvalue solver
+    void print(int iter, ConvergenceCriteria conv);
+
+    /**
+     * \brief Evaluate the outer iteration, \f$ G(u) \f$.
+     *
+     * This loads the passed state into the sweeper, performs a sweep and
+     * returns the resulting state. It also updates \c error_k_ and \c
+     * error_psi_ to reflect the change from \p u to \f$ G(u) \f$.
+     *
+     * The state vector is ordered as the multigroup scalar flux, group-major,
+     * (group, region), followed by the boundary values (see \ref
+     * TransportSweeper::get_boundary_values()), followed by the eigenvalue.
+     */
+    VectorX outer_iteration(const VectorX &u);
+};
+}
@@ -0,0 +1,152 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <string>
+
+/*
+A small 2-D problem for exercising the solvers: a 3x3 lattice of UO2 pins with
+a water hole in the middle, reflected on the south and west faces and vacuum
+on the north and east faces. The pins are coarsely meshed, so that a full
+eigenvalue solve only takes a few seconds.
+ */
+const std::string small_core_geometry_xml =
+"<mesh id=\"1\" type=\"rect\" pitch=\"1.26\">"
+"    <sub_x>2</sub_x>"
+"    <sub_y>2</sub_y>"
+"</mesh>"
+"<pin id=\"1\" mesh=\"1\">"
+"    1 1 1 1"
+"</pin>"
+"<pin id=\"2\" mesh=\"1\">"
+"    2 2 2 2"
+"</pin>"
+"<lattice id=\"1\" nx=\"3\" ny=\"3\">"
+"    1 1 1"
+"    1 2 1"
+"    1 1 1"
+"</lattice>"
+"<assembly id=\"1\" np=\"1\" hz=\"1.0\">"
+"    <lattices>1</lattices>"
+"</assembly>"
+"<core nx=\"1\" ny=\"1\""
+"    north=\"vacuum\""
+"    south=\"reflect\""
+"    east=\"vacuum\""
+"    west=\"reflect\""
+"    top=\"reflect\""
+"    bottom=\"reflect\" >"
+"    1"
+"</core>"
+"<material_lib path=\"c5g7.xsl\">"
+"    <material id=\"1\" name=\"UO2-3.3\" />"
+"    <material id=\"2\" name=\"Moderator\" />"
+"</material_lib>";
+
+/**
+ * \brief Return a complete input for the small problem, with an MoC sweeper.
+ *
+ * \param solver_attributes attributes to put on the \<solver\> tag, which
+ * should at least include the type and its convergence criteria
+ * \param sweeper_attributes extra attributes to put on the \<sweeper\> tag
+ */
+inline std::string small_core_input(const std::string &solver_attributes,
+                                    const std::string &sweeper_attributes = "")
+{
+    return "<solver " + solver_attributes + " >"
+           "    <source scattering=\"P0\" />"
+           "    <sweeper type=\"moc\" n_inner=\"10\" " +
+           sweeper_attributes + " >"
+           "        <ang_quad type=\"ls\" order=\"4\" />"
+           "        <rays spacing=\"0.05\" />"
+           "    </sweeper>"
+           "</solver>" +
+           small_core_geometry_xml;
+}
+
+/*
+A 3-D version of the small problem: the same lattice, two planes of fuel under
+a plane of water, with vacuum on top.
+ */
+const std::string small_core_3d_geometry_xml =
+"<mesh id=\"1\" type=\"rect\" pitch=\"1.26\">"
+"    <sub_x>2</sub_x>"
+"    <sub_y>2</sub_y>"
+"</mesh>"
+"<pin id=\"1\" mesh=\"1\">"
+"    1 1 1 1"
+"</pin>"
+"<pin id=\"2\" mesh=\"1\">"
+"    2 2 2 2"
+"</pin>"
+"<lattice id=\"1\" nx=\"3\" ny=\"3\">"
+"    1 1 1"
+"    1 2 1"
+"    1 1 1"
+"</lattice>"
+"<lattice id=\"2\" nx=\"3\" ny=\"3\">"
+"    2 2 2"
+"    2 2 2"
+"    2 2 2"
+"</lattice>"
+"<assembly id=\"1\" np=\"3\" hz=\"2.0\">"
+"    <lattices>1 1 2</lattices>"
+"</assembly>"
+"<core nx=\"1\" ny=\"1\""
+"    north=\"vacuum\""
+"    south=\"reflect\""
+"    east=\"vacuum\""
+"    west=\"reflect\""
+"    top=\"vacuum\""
+"    bottom=\"reflect\" >"
+"    1"
+"</core>"
+"<material_lib path=\"c5g7.xsl\">"
+"    <material id=\"1\" name=\"UO2-3.3\" />"
+"    <material id=\"2\" name=\"Moderator\" />"
+"</material_lib>";
+
+/**
+ * \brief Return a complete input for the 3-D small problem, with a 2D3D
+ * sweeper.
+ *
+ * \param solver_attributes attributes to put on the \<solver\> tag, which
+ * should at least include the type and its convergence criteria. The 2D3D
+ * sweeper needs CMFD.
+ * \param sweeper_attributes extra attributes to put on the \<sweeper\> tag
+ * \param moc_attributes extra attributes for the \<moc_sweeper\> tag
+ * \param sn_attributes extra attributes for the \<sn_sweeper\> tag
+ */
+inline std::string small_core_2d3d_input(
+    const std::string &solver_attributes,
+    const std::string &sweeper_attributes = "",
+    const std::string &moc_attributes = "",
+    const std::string &sn_attributes = "")
+{
+    return "<solver " + solver_attributes + " >"
+           "    <source scattering=\"P0\" />"
+           "    <sweeper type=\"2d3d\" " + sweeper_attributes + " >"
+           "        <ang_quad type=\"ls\" order=\"4\" />"
+           "        <moc_sweeper n_inner=\"10\" " + moc_attributes + " >"
+           "            <rays spacing=\"0.05\" />"
+           "        </moc_sweeper>"
+           "        <sn_sweeper equation=\"cdd\" axial=\"dd\" n_inner=\"10\" " +
+           sn_attributes + " />"
+           "    </sweeper>"
+           "</solver>" +
+           small_core_3d_geometry_xml;
+}
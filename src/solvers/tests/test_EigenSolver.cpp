@@ -0,0 +1,67 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "UnitTest++/UnitTest++.h"
+
+#include <iostream>
+#include <string>
+#include "pugixml.hpp"
+#include "core/core_mesh.hpp"
+#include "core/tests/pugi_utils.hpp"
+#include "solvers/eigen_solver.hpp"
+#include "solvers/tests/inputs.hpp"
+
+using namespace mocc;
+
+// Anderson acceleration should land on the same eigenvalue as plain power
+// iteration, in fewer outer iterations. Leave CMFD off, so that there is
+// something left for Anderson to accelerate.
+TEST(anderson)
+{
+    std::string solver_attributes = "type=\"eigenvalue\" cmfd=\"f\" "
+                                    "k_tol=\"1e-8\" psi_tol=\"1e-7\" "
+                                    "max_iter=\"1000\" ";
+    auto power_xml =
+        inline_xml(small_core_input(solver_attributes).c_str());
+    auto anderson_xml = inline_xml(
+        small_core_input(solver_attributes + "anderson_depth=\"5\"").c_str());
+
+    CoreMesh mesh(*power_xml);
+
+    EigenSolver power(power_xml->child("solver"), mesh);
+    power.solve();
+
+    EigenSolver anderson(anderson_xml->child("solver"), mesh);
+    anderson.solve();
+
+    real_t k_power    = power.convergence().back().k;
+    real_t k_anderson = anderson.convergence().back().k;
+    int n_power       = power.convergence().size();
+    int n_anderson    = anderson.convergence().size();
+    std::cout << "power iteration k: " << k_power << " in " << n_power
+              << " iterations. Anderson k: " << k_anderson << " in "
+              << n_anderson << " iterations." << std::endl;
+
+    CHECK(power.convergence().back().error_k < 1.0e-8);
+    CHECK(anderson.convergence().back().error_k < 1.0e-8);
+    CHECK_CLOSE(k_power, k_anderson, 1.0e-6);
+    CHECK(n_anderson < n_power);
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
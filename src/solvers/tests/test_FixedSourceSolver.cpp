@@ -0,0 +1,77 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "UnitTest++/UnitTest++.h"
+
+#include <iostream>
+#include <string>
+#include "pugixml.hpp"
+#include "util/blitz_typedefs.hpp"
+#include "core/core_mesh.hpp"
+#include "core/tests/pugi_utils.hpp"
+#include "solvers/fixed_source_solver.hpp"
+#include "solvers/tests/inputs.hpp"
+
+using namespace mocc;
+
+// Solve the small problem, with vacuum on all sides, driven by a flat
+// fission source. Return the resulting scalar flux.
+ArrayB2 solve_fixed_source(const std::string &solver_attributes)
+{
+    std::string input = small_core_input("type=\"fixed_source\" "
+                                         "max_iter=\"1000\" "
+                                         "flux_tol=\"1e-10\" " +
+                                         solver_attributes);
+    std::string::size_type pos;
+    while ((pos = input.find("reflect")) != std::string::npos) {
+        input.replace(pos, 7, "vacuum");
+    }
+    auto xml = inline_xml(input.c_str());
+
+    CoreMesh mesh(*xml);
+    FixedSourceSolver solver(xml->child("solver"), mesh);
+
+    ArrayB1 fission_source(solver.sweeper()->n_reg_fission());
+    fission_source = 1.0;
+    solver.set_fission_source(&fission_source);
+
+    solver.solve();
+
+    ArrayB2 flux(solver.sweeper()->flux().shape());
+    flux = solver.sweeper()->flux();
+    return flux;
+}
+
+// GMRES and source iteration solve the same problem, so they should land on
+// the same flux
+TEST(gmres_vs_source_iteration)
+{
+    ArrayB2 si_flux    = solve_fixed_source("iteration=\"source\"");
+    ArrayB2 gmres_flux = solve_fixed_source("iteration=\"gmres\"");
+
+    CHECK_EQUAL(si_flux.size(), gmres_flux.size());
+    for (int ig = 0; ig < (int)si_flux.extent(1); ig++) {
+        for (int i = 0; i < (int)si_flux.extent(0); i++) {
+            CHECK_CLOSE(si_flux(i, ig), gmres_flux(i, ig),
+                        1.0e-6 * si_flux(i, ig));
+        }
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
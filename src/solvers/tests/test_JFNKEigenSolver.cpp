@@ -0,0 +1,64 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "UnitTest++/UnitTest++.h"
+
+#include <iostream>
+#include <string>
+#include "pugixml.hpp"
+#include "core/core_mesh.hpp"
+#include "core/tests/pugi_utils.hpp"
+#include "solvers/eigen_solver.hpp"
+#include "solvers/jfnk_eigen_solver.hpp"
+#include "solvers/tests/inputs.hpp"
+
+using namespace mocc;
+
+// JFNK and power iteration solve the same problem, so they should land on the
+// same eigenvalue. Run both with CMFD, since that is where G is most likely
+// to misbehave.
+TEST(jfnk_vs_power_iteration)
+{
+    auto power_xml = inline_xml(
+        small_core_input("type=\"eigenvalue\" cmfd=\"t\" k_tol=\"1e-8\" "
+                         "psi_tol=\"1e-7\" max_iter=\"200\"")
+            .c_str());
+    auto jfnk_xml = inline_xml(
+        small_core_input("type=\"eigenvalue_jfnk\" cmfd=\"t\" "
+                         "k_tol=\"1e-8\" psi_tol=\"1e-7\" max_iter=\"50\"")
+            .c_str());
+
+    CoreMesh mesh(*power_xml);
+
+    EigenSolver power(power_xml->child("solver"), mesh);
+    power.solve();
+
+    JFNKEigenSolver jfnk(jfnk_xml->child("solver"), mesh);
+    jfnk.solve();
+
+    real_t k_power = power.convergence().back().k;
+    real_t k_jfnk  = jfnk.convergence().back().k;
+    std::cout << "power iteration k: " << k_power << " JFNK k: " << k_jfnk
+              << std::endl;
+
+    CHECK(jfnk.convergence().back().error_k < 1.0e-8);
+    CHECK_CLOSE(k_power, k_jfnk, 1.0e-6);
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -0,0 +1,106 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "UnitTest++/UnitTest++.h"
+
+#include <iostream>
+#include <string>
+#include "pugixml.hpp"
+#include "core/core_mesh.hpp"
+#include "core/tests/pugi_utils.hpp"
+#include "solvers/eigen_solver.hpp"
+#include "solvers/tests/inputs.hpp"
+
+using namespace mocc;
+
+namespace {
+const std::string solver_attributes =
+    "type=\"eigenvalue\" cmfd=\"t\" k_tol=\"1e-8\" psi_tol=\"1e-7\" "
+    "max_iter=\"200\"";
+
+// Solve the 3-D small problem with the 2D3D sweeper, returning k
+real_t solve_2d3d(const std::string &sweeper_attributes,
+                  const std::string &moc_attributes = "")
+{
+    auto xml = inline_xml(small_core_2d3d_input(solver_attributes,
+                                                sweeper_attributes,
+                                                moc_attributes)
+                              .c_str());
+    CoreMesh mesh(*xml);
+    EigenSolver solver(xml->child("solver"), mesh);
+    solver.solve();
+
+    CHECK(solver.convergence().back().error_k < 1.0e-8);
+    return solver.convergence().back().k;
+}
+}
+
+// Pipelining lags the correction factors by an outer iteration, which changes
+// the path to convergence, but not where it ends up
+TEST(pipeline)
+{
+    real_t k_serial   = solve_2d3d("pipeline=\"f\"");
+    real_t k_pipeline = solve_2d3d("pipeline=\"t\" sn_threads=\"1\"");
+    std::cout << "serial k: " << k_serial << " pipelined k: " << k_pipeline
+              << std::endl;
+
+    CHECK_CLOSE(k_serial, k_pipeline, 1.0e-6);
+}
+
+// The eigenvalue solver has to reach both of the sweepers in the 2D3D
+// sweeper to tighten their inner iterations. Make each of them adaptive in
+// turn, since the 2D3D sweeper reports the controller of whichever one is.
+TEST(adaptive_inner)
+{
+    real_t k_fixed = solve_2d3d("");
+
+    const std::string adaptive = "inner_tol=\"1e-9\"";
+    for (int i = 0; i < 2; i++) {
+        auto xml = inline_xml(
+            small_core_2d3d_input(solver_attributes, "",
+                                  i == 0 ? adaptive : "",
+                                  i == 1 ? adaptive : "")
+                .c_str());
+        CoreMesh mesh(*xml);
+        EigenSolver solver(xml->child("solver"), mesh);
+        solver.solve();
+
+        const auto &control = solver.sweeper()->inner_control();
+        CHECK(control.adaptive());
+        // Started from the loose end, and tightened along with the fission
+        // source
+        CHECK(control.tolerance() < 1.0e-6);
+        CHECK(solver.convergence().back().error_k < 1.0e-8);
+        CHECK_CLOSE(k_fixed, solver.convergence().back().k, 1.0e-6);
+    }
+}
+
+// Sweeping the macroplanes concurrently, correction factors included, only
+// changes the order of the tallies
+TEST(plane_parallel)
+{
+    real_t k_serial = solve_2d3d("");
+    real_t k_plane  = solve_2d3d("", "parallel=\"plane\"");
+    std::cout << "serial k: " << k_serial << " plane-parallel k: " << k_plane
+              << std::endl;
+
+    CHECK_CLOSE(k_serial, k_plane, 1.0e-7);
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -16,12 +16,115 @@
 
 #include "correction_data.hpp"
 
+#include <algorithm>
 #include <iomanip>
 #include "pugixml.hpp"
+#include "util/error.hpp"
 #include "util/files.hpp"
 #include "util/string_utils.hpp"
 
+namespace {
+using namespace mocc;
+
+// Parse the correction factor storage options. The precision is fixed at
+// build time, so all we can do is make sure that it is the one requested.
+void check_precision(const pugi::xml_node &input)
+{
+    if (input.attribute("correction_precision").empty()) {
+        return;
+    }
+    std::string precision = input.attribute("correction_precision").value();
+    sanitize(precision);
+    if ((precision != "double") && (precision != "single")) {
+        throw EXCEPT("Unrecognized correction factor precision.");
+    }
+    bool single = sizeof(correction_t) == sizeof(float);
+    if ((precision == "single") != single) {
+        throw EXCEPT("Requested correction factor precision differs from "
+                     "the build. Rebuild with SINGLE_CORRECTIONS set "
+                     "accordingly.");
+    }
+    return;
+}
+
+real_t sparse_tolerance(const pugi::xml_node &input)
+{
+    if (input.attribute("correction_sparse").empty()) {
+        return -1.0;
+    }
+    real_t tol = input.attribute("correction_sparse").as_double(-1.0);
+    if (tol < 0.0) {
+        throw EXCEPT("Invalid sparse correction factor tolerance.");
+    }
+    return tol;
+}
+}
+
 namespace mocc {
+CorrectionData::CorrectionData(const CoreMesh &mesh, size_t nang,
+                               size_t ngroup, const pugi::xml_node &input)
+    : CorrectionData(mesh, nang, ngroup, sparse_tolerance(input))
+{
+    check_precision(input);
+    return;
+}
+
+CorrectionData::CorrectionData(const CoreMesh &mesh, size_t nang,
+                               size_t ngroup, real_t sparse_tol)
+    : CorrectionData(mesh, nang, ngroup, sparse_tol, false)
+{
+    LogFile << "Correction factor storage: "
+            << (sizeof(correction_t) == sizeof(float) ? "single" : "double")
+            << " precision, " << (data_.sparse() ? "sparse" : "full")
+            << std::endl;
+    return;
+}
+
+CorrectionData::CorrectionData(const CoreMesh &mesh, size_t nang,
+                               size_t ngroup, real_t sparse_tol,
+                               bool fold_groups)
+    : mesh_(&mesh),
+      nx_(mesh.nx()),
+      ny_(mesh.ny()),
+      nz_(mesh.macroplanes().size()),
+      nreg_(nx_ * ny_ * nz_),
+      nang_(nang),
+      ngroup_(ngroup),
+      data_(nreg_, nang_, ngroup_, sparse_tol, fold_groups)
+{
+    assert(nreg_ > 0);
+    assert(nang_ > 0);
+    assert(ngroup_ > 0);
+    return;
+}
+
+std::shared_ptr<CorrectionData> CorrectionData::group_buffer() const
+{
+    assert(mesh_);
+    return std::shared_ptr<CorrectionData>(new CorrectionData(
+        *mesh_, nang_, ngroup_, data_.sparse_tolerance(), true));
+}
+
+void CorrectionData::copy_group(const CorrectionData &other, int group)
+{
+    assert(other.nreg_ == nreg_);
+    assert(other.nang_ == nang_);
+    assert(other.ngroup_ == ngroup_);
+    assert(group < ngroup_);
+
+    for (int ireg = 0; ireg < nreg_; ireg++) {
+        for (int iang = 0; iang < nang_; iang++) {
+            this->set_alpha(ireg, iang, group, Normal::X_NORM,
+                            other.alpha(ireg, iang, group, Normal::X_NORM));
+            this->set_alpha(ireg, iang, group, Normal::Y_NORM,
+                            other.alpha(ireg, iang, group, Normal::Y_NORM));
+            this->set_beta(ireg, iang, group,
+                           other.beta(ireg, iang, group));
+        }
+    }
+    return;
+}
+
 void CorrectionData::from_data(const pugi::xml_node &input)
 {
     if (input.child("data").empty()) {
@@ -103,9 +206,10 @@ void CorrectionData::read_data_single(const pugi::xml_node &data,
                 }
                 for (int ip = bottom_plane; ip <= top_plane; ip++) {
                     int stt = mesh_->plane_cell_begin(ip);
-                    int stp = mesh_->plane_cell_end(ip) - 1;
-                    alpha_(ig, iang, blitz::Range(stt, stp),
-                           (int)Normal::X_NORM) = inbuf;
+                    for (int i = 0; i < (int)inbuf.size(); i++) {
+                        this->set_alpha(stt + i, iang, ig, Normal::X_NORM,
+                                        inbuf(i));
+                    }
                 }
             }
             // alpha y
@@ -120,9 +224,10 @@ void CorrectionData::read_data_single(const pugi::xml_node &data,
                 }
                 for (int ip = bottom_plane; ip <= top_plane; ip++) {
                     int stt = mesh_->plane_cell_begin(ip);
-                    int stp = mesh_->plane_cell_end(ip) - 1;
-                    alpha_(ig, iang, blitz::Range(stt, stp),
-                           (int)Normal::Y_NORM) = inbuf;
+                    for (int i = 0; i < (int)inbuf.size(); i++) {
+                        this->set_alpha(stt + i, iang, ig, Normal::Y_NORM,
+                                        inbuf(i));
+                    }
                 }
             }
             // beta
@@ -137,8 +242,9 @@ void CorrectionData::read_data_single(const pugi::xml_node &data,
                 }
                 for (int ip = bottom_plane; ip <= top_plane; ip++) {
                     int stt = mesh_->plane_cell_begin(ip);
-                    int stp = mesh_->plane_cell_end(ip) - 1;
-                    beta_(ig, iang, blitz::Range(stt, stp)) = inbuf;
+                    for (int i = 0; i < (int)inbuf.size(); i++) {
+                        this->set_beta(stt + i, iang, ig, inbuf(i));
+                    }
                 }
             }
         }
@@ -239,21 +345,27 @@ void CorrectionData::output(H5Node &file) const
 
         for (int a = 0; a < nang_; a++) {
             {
-                slice = beta_(g, a, blitz::Range::all());
+                for (int i = 0; i < n; i++) {
+                    slice(i) = this->beta(i, a, g);
+                }
                 std::stringstream setname;
                 setname << std::setfill('0') << std::setw(3) << a;
                 beta_g.write(setname.str(), slice, dims);
             }
 
             {
-                slice = alpha_(g, a, blitz::Range::all(), (int)Normal::X_NORM);
+                for (int i = 0; i < n; i++) {
+                    slice(i) = this->alpha(i, a, g, Normal::X_NORM);
+                }
                 std::stringstream setname;
                 setname << std::setfill('0') << std::setw(3) << a;
                 ax_g.write(setname.str(), slice, dims);
             }
 
             {
-                slice = alpha_(g, a, blitz::Range::all(), (int)Normal::Y_NORM);
+                for (int i = 0; i < n; i++) {
+                    slice(i) = this->alpha(i, a, g, Normal::Y_NORM);
+                }
                 std::stringstream setname;
                 setname << std::setfill('0') << std::setw(3) << a;
                 ay_g.write(setname.str(), slice, dims);
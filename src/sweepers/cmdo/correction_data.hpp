@@ -16,8 +16,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <memory>
+#include <vector>
 #include "util/blitz_typedefs.hpp"
 #include "util/global_config.hpp"
 #include "util/pugifwd.hpp"
@@ -26,6 +29,217 @@
 #include "core/output_interface.hpp"
 
 namespace mocc {
+#ifdef SINGLE_CORRECTIONS
+/**
+ * \brief Storage type for the CDD correction factors.
+ *
+ * With \c SINGLE_CORRECTIONS, the correction factors are stored in single
+ * precision, halving the size of the \ref CorrectionData.
+ */
+typedef float correction_t;
+#else
+typedef real_t correction_t;
+#endif
+
+/**
+ * \brief Storage for the correction factors of a set of cells, in precision
+ * \p T.
+ *
+ * Each cell that has storage gets a slot, which holds the (alpha x, alpha y,
+ * beta) factors for all of its groups and angles contiguously. Slots are
+ * allocated in fixed-size blocks, so adding a slot never moves the existing
+ * factors. The last block is trimmed to the number of cells, so a storage
+ * with every cell populated is exactly the size of a dense one.
+ *
+ * When constructed with a non-negative sparse tolerance, cells start without
+ * a slot, and only get one when they are given a factor that differs from its
+ * default by more than the tolerance. Otherwise, every cell gets a slot up
+ * front.
+ *
+ * With \p fold_groups, only one group is stored, and all group indices refer
+ * to it.
+ *
+ * Different threads may set the factors of different cells concurrently, even
+ * if that gives them slots.
+ */
+template <typename T> class CorrectionStorage {
+public:
+    /**
+     * \brief Number of slots per storage block, as a power of two
+     */
+    static constexpr int BLOCK_SHIFT = 6;
+    static constexpr int BLOCK_SIZE  = 1 << BLOCK_SHIFT;
+
+    CorrectionStorage()
+        : n_cell_(0),
+          n_ang_(0),
+          n_group_(0),
+          stride_(0),
+          group_stride_(0),
+          sparse_tol_(-1.0),
+          n_slot_(0)
+    {
+        return;
+    }
+
+    CorrectionStorage(int n_cell, int n_ang, int n_group, real_t sparse_tol,
+                      bool fold_groups = false)
+        : n_cell_(n_cell),
+          n_ang_(n_ang),
+          n_group_(n_group),
+          stride_((size_t)(fold_groups ? 1 : n_group) * n_ang * 3),
+          group_stride_(fold_groups ? 0 : n_ang * 3),
+          sparse_tol_(sparse_tol),
+          slot_(n_cell, -1),
+          n_slot_(0)
+    {
+        // Never move the blocks once they are allocated, so that adding a
+        // slot doesn't disturb other threads using the existing ones
+        blocks_.reserve((n_cell_ + BLOCK_SIZE - 1) / BLOCK_SIZE);
+        if (!this->sparse()) {
+            for (int i = 0; i < n_cell_; i++) {
+                this->add_slot(i);
+            }
+        }
+        return;
+    }
+
+    bool sparse() const
+    {
+        return sparse_tol_ >= 0.0;
+    }
+
+    real_t sparse_tolerance() const
+    {
+        return sparse_tol_;
+    }
+
+    /**
+     * \brief Return the number of cells that have a slot
+     */
+    int n_slot() const
+    {
+        return n_slot_;
+    }
+
+    /**
+     * \brief Return the slot of a cell, or -1 if it doesn't have one
+     */
+    int slot(int cell) const
+    {
+        return slot_[cell];
+    }
+
+    /**
+     * \brief Return the number of factors that are actually allocated
+     */
+    size_t size() const
+    {
+        size_t size = 0;
+        for (const auto &block : blocks_) {
+            size += block.size();
+        }
+        return size;
+    }
+
+    /**
+     * \brief Return a factor, or \p default_value if the cell has no slot
+     */
+    inline real_t get(int cell, int ang, int group, int factor,
+                      real_t default_value) const
+    {
+        int slot = slot_[cell];
+        if (slot < 0) {
+            return default_value;
+        }
+        return blocks_[slot >> BLOCK_SHIFT][this->index(slot, ang, group) +
+                                            factor];
+    }
+
+    /**
+     * \brief Set a factor, giving the cell a slot if needed
+     *
+     * If the cell doesn't have a slot and \p value is within the sparse
+     * tolerance of \p default_value, nothing needs to be stored.
+     */
+    inline void set(int cell, int ang, int group, int factor, real_t value,
+                    real_t default_value)
+    {
+        int slot = slot_[cell];
+        if (slot < 0) {
+            if (std::abs(value - default_value) <= sparse_tol_) {
+                return;
+            }
+#pragma omp critical(correction_storage_add_slot)
+            slot = this->add_slot(cell);
+        }
+        blocks_[slot >> BLOCK_SHIFT][this->index(slot, ang, group) + factor] =
+            value;
+        return;
+    }
+
+private:
+    /**
+     * \brief Return the offset of the (alpha x, alpha y, beta) triplet for a
+     * slot, angle and group within the slot's block
+     */
+    inline size_t index(int slot, int ang, int group) const
+    {
+        assert(slot < n_slot_);
+        assert(ang < n_ang_);
+        assert(group < n_group_);
+        return (slot & (BLOCK_SIZE - 1)) * stride_ + group * group_stride_ +
+               ang * 3;
+    }
+
+    /**
+     * \brief Give a cell the next slot, with all of its factors set to their
+     * defaults, and return the slot
+     */
+    int add_slot(int cell)
+    {
+        assert(slot_[cell] < 0);
+        int slot = n_slot_;
+        if ((slot & (BLOCK_SIZE - 1)) == 0) {
+            // The current block is full; start a new one, no bigger than
+            // needed to hold the remaining cells
+            int n = std::min(BLOCK_SIZE, n_cell_ - slot);
+            blocks_.emplace_back(stride_ * n);
+            auto &block = blocks_.back();
+            for (size_t i = 0; i < block.size(); i += 3) {
+                block[i + 0] = 0.5;
+                block[i + 1] = 0.5;
+                block[i + 2] = 1.0;
+            }
+        }
+        slot_[cell] = slot;
+        n_slot_++;
+        return slot;
+    }
+
+    int n_cell_;
+    int n_ang_;
+    int n_group_;
+
+    // Number of factors in each slot, and between groups within a slot
+    size_t stride_;
+    int group_stride_;
+
+    // Tolerance beyond which a factor is considered to differ from its
+    // default. Negative for full storage.
+    real_t sparse_tol_;
+
+    // Slot of each cell, or -1 if all of its factors are defaults
+    VecI slot_;
+    int n_slot_;
+
+    // Blocks of BLOCK_SIZE slots each, except possibly the last
+    std::vector<std::vector<T>> blocks_;
+};
+
+template <typename T> constexpr int CorrectionStorage<T>::BLOCK_SHIFT;
+template <typename T> constexpr int CorrectionStorage<T>::BLOCK_SIZE;
+
 /**
  * This class provides a storage scheme for the correction factors needed to
  * perform corrected diamond difference. The CDD Sn and MoC sweepers must be
@@ -33,7 +247,7 @@ namespace mocc {
  * correction factors, respectively. Due to the relatively high
  * dimensionality of the data (space, angle, energy and cardinal direction
  * [X|Y]), instead of using a multidimensional array, we will instead use
- * accessor functions to get the data out of a dense linear representation.
+ * accessor functions to get the data out of a \ref CorrectionStorage.
  */
 class CorrectionData : public HasOutput {
 public:
@@ -42,36 +256,53 @@ public:
         return;
     }
 
+    /**
+     * \brief Construct a \ref CorrectionData with full storage, with all
+     * factors set to their defaults
+     */
     CorrectionData(const CoreMesh &mesh, size_t nang, size_t ngroup)
-        : mesh_(&mesh),
-          nx_(mesh.nx()),
-          ny_(mesh.ny()),
-          nz_(mesh.macroplanes().size()),
-          nreg_(nx_ * ny_ * nz_),
-          nang_(nang),
-          ngroup_(ngroup),
-          alpha_(ngroup_, nang_, nreg_, 2),
-          beta_(ngroup_, nang_, nreg_)
-    {
-        assert(alpha_.size() > 0);
-        assert(beta_.size() > 0);
-        assert(nx_ * ny_ * nz_ == nreg_);
-        auto slice = alpha_(0, 0, blitz::Range::all(), blitz::Range::all());
-        assert(slice.isStorageContiguous());
-
-        alpha_ = 0.5;
-        beta_  = 1.0;
-
+        : CorrectionData(mesh, nang, ngroup, -1.0)
+    {
         return;
     }
 
+    /**
+     * \brief Construct a \ref CorrectionData, configuring the storage from
+     * XML
+     *
+     * The storage is controlled by two optional attributes of \p input:
+     *  - \c correction_precision, either \c "double" or \c "single". The
+     *  precision is chosen at build time with \c SINGLE_CORRECTIONS, so this
+     *  is only checked against it.
+     *  - \c correction_sparse, a tolerance. If present, only cells with a
+     *  factor that differs from the default (alpha 0.5, beta 1.0) by more
+     *  than the tolerance have any storage allocated.
+     */
+    CorrectionData(const CoreMesh &mesh, size_t nang, size_t ngroup,
+                   const pugi::xml_node &input);
+
+    /**
+     * \brief Construct a \ref CorrectionData, with all factors set to their
+     * defaults
+     *
+     * \param mesh the \ref CoreMesh
+     * \param nang the number of 2-D angles
+     * \param ngroup the number of energy groups
+     * \param sparse_tol the tolerance beyond which a factor is considered to
+     * differ from its default. Storage is only allocated for cells with
+     * factors that differ from the default. Pass a negative value to
+     * allocate storage for all cells.
+     */
+    CorrectionData(const CoreMesh &mesh, size_t nang, size_t ngroup,
+                   real_t sparse_tol);
+
     ~CorrectionData()
     {
     }
 
     size_t size() const
     {
-        return alpha_.size();
+        return ngroup_ * nang_ * nreg_ * 2;
     }
 
     int n_cell() const
@@ -79,26 +310,61 @@ public:
         return nreg_;
     }
 
-    inline real_t &alpha(int reg, int ang, int group, Normal norm)
+    /**
+     * \brief Return the number of cells that have storage allocated for
+     * their correction factors
+     */
+    int n_cell_stored() const
     {
-        return alpha_(group, ang, reg, (int)norm);
+        return data_.n_slot();
     }
 
     inline const real_t alpha(int reg, int ang, int group, Normal norm) const
     {
-        return alpha_(group, ang, reg, (int)norm);
+        assert(norm != Normal::Z_NORM);
+        return data_.get(reg, ang, group, (int)norm, 0.5);
     }
 
-    inline real_t &beta(int reg, int ang, int group)
+    inline const real_t beta(int reg, int ang, int group) const
     {
-        return beta_(group, ang, reg);
+        return data_.get(reg, ang, group, 2, 1.0);
     }
 
-    inline const real_t beta(int reg, int ang, int group) const
+    /**
+     * \brief Set an alpha correction factor
+     */
+    inline void set_alpha(int reg, int ang, int group, Normal norm,
+                          real_t value)
     {
-        return beta_(group, ang, reg);
+        assert(norm != Normal::Z_NORM);
+        data_.set(reg, ang, group, (int)norm, value, 0.5);
+        return;
     }
 
+    /**
+     * \brief Set a beta correction factor
+     */
+    inline void set_beta(int reg, int ang, int group, real_t value)
+    {
+        data_.set(reg, ang, group, 2, value, 1.0);
+        return;
+    }
+
+    /**
+     * \brief Copy all of the correction factors for a single group from
+     * another \ref CorrectionData of the same shape
+     */
+    void copy_group(const CorrectionData &other, int group);
+
+    /**
+     * \brief Return a new buffer for the factors of one group at a time
+     *
+     * The buffer has the same shape and sparse tolerance as this \ref
+     * CorrectionData, but only stores a single group, which all group indices
+     * refer to. Factors are moved out of it with \ref copy_group().
+     */
+    std::shared_ptr<CorrectionData> group_buffer() const;
+
     /**
      * \brief Read correction factors from one or more HDF5 files, as
      * specified by \<data /\> tags
@@ -108,6 +374,9 @@ public:
     void output(H5Node &file) const;
 
 private:
+    CorrectionData(const CoreMesh &mesh, size_t nang, size_t ngroup,
+                   real_t sparse_tol, bool fold_groups);
+
     // Private methods to facilitate reading data from HDF5 files
     /**
      * \brief Read a single data file
@@ -147,6 +416,7 @@ private:
      * read_data_single(const pugi::xml_node&, int, int)
      */
     void read_data_multi(const pugi::xml_node &input);
+
     const CoreMesh *mesh_;
     int nx_;
     int ny_;
@@ -155,8 +425,7 @@ private:
     int nang_;
     int ngroup_;
 
-    ArrayB4 alpha_;
-    ArrayB3 beta_;
+    CorrectionStorage<correction_t> data_;
 };
 
 typedef std::unique_ptr<CorrectionData> UP_CorrectionData_t;
@@ -42,6 +42,10 @@ void CurrentCorrections::calculate_corrections(size_t ang, size_t group)
     int iang2    = ang_quad_.reverse(ang);
     real_t ox    = ang_quad_[ang].ox;
 
+    // Other copies of the worker may be sweeping other macroplanes, so the
+    // residual is only accumulated into the shared one at the end
+    std::array<real_t, 3> residual = {{0.0, 0.0, 0.0}};
+
     Surface surfs[2][4];
     // We know that all of our moc angles are positive in the y
     // direction
@@ -62,9 +66,6 @@ void CurrentCorrections::calculate_corrections(size_t ang, size_t group)
         surfs[BW][XR] = Surface::EAST;
     }
 
-    // Make sure we have the right cross sections
-    xstr_sn_.expand(group);
-
     // See the Surface Normalization page
     // Note that the sin and cos are flipped from what we have in \ref
     // RayData::RayData(). This is because "x spacing" applies to the y-normal
@@ -106,16 +107,16 @@ void CurrentCorrections::calculate_corrections(size_t ang, size_t group)
             assert(b == b);
 
             real_t e =
-                ax - corrections_->alpha(icc, iang1, group, Normal::X_NORM);
-            residual_[0] += e * e;
-            e = ay - corrections_->alpha(icc, iang1, group, Normal::Y_NORM);
-            residual_[1] += e * e;
-            e = b - corrections_->beta(icc, iang1, group);
-            residual_[2] += e * e;
-
-            corrections_->alpha(icc, iang1, group, Normal::X_NORM) = ax;
-            corrections_->alpha(icc, iang1, group, Normal::Y_NORM) = ay;
-            corrections_->beta(icc, iang1, group) = b;
+                ax - previous_->alpha(icc, iang1, group, Normal::X_NORM);
+            residual[0] += e * e;
+            e = ay - previous_->alpha(icc, iang1, group, Normal::Y_NORM);
+            residual[1] += e * e;
+            e = b - previous_->beta(icc, iang1, group);
+            residual[2] += e * e;
+
+            corrections_->set_alpha(icc, iang1, group, Normal::X_NORM, ax);
+            corrections_->set_alpha(icc, iang1, group, Normal::Y_NORM, ay);
+            corrections_->set_beta(icc, iang1, group, b);
         }
 
         // BW direction
@@ -140,20 +141,25 @@ void CurrentCorrections::calculate_corrections(size_t ang, size_t group)
             assert(b == b);
 
             real_t e =
-                ax - corrections_->alpha(icc, iang2, group, Normal::X_NORM);
-            residual_[0] += e * e;
-            e = ay - corrections_->alpha(icc, iang2, group, Normal::Y_NORM);
-            residual_[1] += e * e;
-            e = b - corrections_->beta(icc, iang2, group);
-            residual_[2] += e * e;
+                ax - previous_->alpha(icc, iang2, group, Normal::X_NORM);
+            residual[0] += e * e;
+            e = ay - previous_->alpha(icc, iang2, group, Normal::Y_NORM);
+            residual[1] += e * e;
+            e = b - previous_->beta(icc, iang2, group);
+            residual[2] += e * e;
 
-            corrections_->alpha(icc, iang2, group, Normal::X_NORM) = ax;
-            corrections_->alpha(icc, iang2, group, Normal::Y_NORM) = ay;
+            corrections_->set_alpha(icc, iang2, group, Normal::X_NORM, ax);
+            corrections_->set_alpha(icc, iang2, group, Normal::Y_NORM, ay);
 
-            corrections_->beta(icc, iang2, group) = b;
+            corrections_->set_beta(icc, iang2, group, b);
         }
     }
 
+    for (int i = 0; i < 3; i++) {
+#pragma omp atomic
+        (*residual_)[i] += residual[i];
+    }
+
     return;
 }
 }
@@ -16,8 +16,11 @@
 
 #pragma once
 
+#include <array>
+#include <memory>
 #include "util/files.hpp"
 #include "util/global_config.hpp"
+#include "util/omp_guard.h"
 #include "core/angular_quadrature.hpp"
 #include "core/coarse_data.hpp"
 #include "core/mesh.hpp"
@@ -32,16 +35,22 @@ namespace cmdo {
 /**
  * See documentation for \ref moc::NoCurrent for canonical documentation
  * for each of the methods.
+ *
+ * Copies of a \ref CurrentCorrections get their own tally buffers, so that
+ * they can sweep different macroplanes concurrently. They all accumulate into
+ * the same residual.
  */
 class CurrentCorrections : public moc::Current {
 public:
     CurrentCorrections(CoarseData *coarse_data, const Mesh *mesh,
-                       CorrectionData *corrections, const VectorX &qbar,
+                       CorrectionData *corrections,
+                       const CorrectionData *previous, const VectorX &qbar,
                        ExpandedXS &xstr_true, ExpandedXS &xstr_split,
                        ExpandedXS &xstr_sn, const AngularQuadrature &ang_quad,
                        const moc::RayData &rays)
         : moc::Current(coarse_data, mesh),
           corrections_(corrections),
+          previous_(previous),
           qbar_(qbar),
           xstr_true_(xstr_true),
           xstr_split_(xstr_split),
@@ -52,8 +61,24 @@ public:
           vol_norm_(mesh_->n_cell_plane()),
           sigt_sum_(mesh_->n_cell_plane() * 2),
           surf_norm_(mesh_->n_surf_plane() * 2),
-          rays_(rays)
+          t_current_(omp_get_max_threads(), mesh_->n_surf_plane()),
+          t_surface_flux_(omp_get_max_threads(), mesh_->n_surf_plane()),
+          t_surf_sum_(omp_get_max_threads(), mesh_->n_surf_plane() * 2),
+          t_vol_sum_(omp_get_max_threads(), mesh_->n_cell_plane() * 2),
+          t_vol_norm_(omp_get_max_threads(), mesh_->n_cell_plane()),
+          t_sigt_sum_(omp_get_max_threads(), mesh_->n_cell_plane() * 2),
+          t_surf_norm_(omp_get_max_threads(), mesh_->n_surf_plane() * 2),
+          rays_(rays),
+          residual_(std::make_shared<std::array<real_t, 3>>())
     {
+        t_current_      = 0.0;
+        t_surface_flux_ = 0.0;
+        t_surf_sum_     = 0.0;
+        t_vol_sum_      = 0.0;
+        t_vol_norm_     = 0.0;
+        t_sigt_sum_     = 0.0;
+        t_surf_norm_    = 0.0;
+
         assert(xstr_true_.size() == (int)mesh->n_reg(MeshTreatment::PLANE));
         assert(xstr_split_.size() == (int)mesh->n_reg(MeshTreatment::PLANE));
         assert(xstr_sn.size() == (int)mesh->n_reg(MeshTreatment::PIN));
@@ -77,15 +102,45 @@ public:
         return;
     }
 
+    CurrentCorrections(const CurrentCorrections &other)
+        : moc::Current(other),
+          corrections_(other.corrections_),
+          previous_(other.previous_),
+          qbar_(other.qbar_),
+          xstr_true_(other.xstr_true_),
+          xstr_split_(other.xstr_split_),
+          xstr_sn_(other.xstr_sn_),
+          cell_offset_xs_(other.cell_offset_xs_),
+          ang_quad_(other.ang_quad_),
+          surf_sum_(other.surf_sum_.copy()),
+          vol_sum_(other.vol_sum_.copy()),
+          vol_norm_(other.vol_norm_.copy()),
+          sigt_sum_(other.sigt_sum_.copy()),
+          surf_norm_(other.surf_norm_.copy()),
+          t_current_(other.t_current_.copy()),
+          t_surface_flux_(other.t_surface_flux_.copy()),
+          t_surf_sum_(other.t_surf_sum_.copy()),
+          t_vol_sum_(other.t_vol_sum_.copy()),
+          t_vol_norm_(other.t_vol_norm_.copy()),
+          t_sigt_sum_(other.t_sigt_sum_.copy()),
+          t_surf_norm_(other.t_surf_norm_.copy()),
+          ang_(other.ang_),
+          rays_(other.rays_),
+          residual_(other.residual_),
+          mplane_offset_(other.mplane_offset_)
+    {
+        return;
+    }
+
     inline void set_group(int group)
     {
-        group_    = group;
-        residual_ = {{0.0, 0.0, 0.0}};
+        group_     = group;
+        *residual_ = {{0.0, 0.0, 0.0}};
     }
 
     std::array<real_t, 3> residual() const
     {
-        auto resid = residual_;
+        auto resid = *residual_;
         resid[0]   = std::sqrt(resid[0]);
         resid[1]   = std::sqrt(resid[1]);
         resid[2]   = std::sqrt(resid[2]);
@@ -106,100 +161,103 @@ public:
         return;
     }
 
+    /**
+     * \brief Tally the currents, surface fluxes and flux and cross-section
+     * sums for a single ray.
+     *
+     * Everything is stored into thread-private buffers, so no
+     * synchronization is needed here. The buffers are reduced in \ref
+     * post_angle().
+     */
     inline void post_ray(const FluxStore &psi1, const FluxStore &psi2,
                          const ArrayB1 &e_tau, const moc::Ray &ray,
                          int first_reg)
     {
-#pragma omp critical
-        {
-            auto all          = blitz::Range::all();
-            auto current      = coarse_data_->current(all, group_);
-            auto surface_flux = coarse_data_->surface_flux(all, group_);
-
-            int cell_fw = ray.cm_cell_fw();
-            int cell_bw = ray.cm_cell_bw();
-            int surf_fw = ray.cm_surf_fw();
-            int surf_bw = ray.cm_surf_bw();
-            int iseg_fw = 0;
-            int iseg_bw = ray.nseg();
-
-            // Use an offset for the current contributions, but NOT for the
-            // correction factors, which use plane-by-plane indexing
-            int norm_fw = (int)mesh_->surface_normal(surf_fw);
-            int norm_bw = (int)mesh_->surface_normal(surf_bw);
-            current(surf_fw + surf_offset_) +=
-                psi1[iseg_fw] * current_weights_[norm_fw];
-            current(surf_bw + surf_offset_) -=
-                psi2[iseg_bw] * current_weights_[norm_bw];
-            surface_flux(surf_fw + surf_offset_) +=
-                psi1[iseg_fw] * flux_weights_[norm_fw];
-            surface_flux(surf_bw + surf_offset_) -=
-                psi2[iseg_bw] * flux_weights_[norm_bw];
-
-            surf_sum_(surf_fw * 2 + 0) += psi1[iseg_fw];
-            surf_sum_(surf_bw * 2 + 1) += psi2[iseg_bw];
-            surf_norm_(surf_fw * 2 + 0) += 1.0;
-            surf_norm_(surf_bw * 2 + 1) += 1.0;
-
-            auto begin = ray.cm_data().cbegin();
-            auto end   = ray.cm_data().cend();
-            for (auto crd = begin; crd != end; ++crd) {
-                // Hopefully branch prediction saves me here.
-                if (crd->fw != Surface::INVALID) {
-                    // Store forward volumetric stuff
-                    for (unsigned i = 0; i < crd->nseg_fw; i++) {
-                        int ireg         = ray.seg_index(iseg_fw) + first_reg;
-                        real_t xstr      = xstr_split_[ireg];
-                        real_t xstr_true = xstr_true_[ireg];
-                        real_t t = ang_.rsintheta * ray.seg_len(iseg_fw);
-                        real_t fluxvol =
-                            t * qbar_(ireg) +
-                            (psi1[iseg_fw] - psi1[iseg_fw + 1]) / xstr;
-                        vol_sum_(cell_fw * 2 + 0) += fluxvol;
-                        vol_norm_(cell_fw) += t;
-                        sigt_sum_(cell_fw * 2 + 0) += xstr_true * fluxvol;
-                        iseg_fw++;
-                    }
-                    // Store FW surface stuff
-                    norm_fw = (int)surface_to_normal(crd->fw);
-                    surf_fw = mesh_->coarse_surf(cell_fw, crd->fw);
-                    current(surf_fw + surf_offset_) +=
-                        psi1[iseg_fw] * current_weights_[norm_fw];
-                    surface_flux(surf_fw + surf_offset_) +=
-                        psi1[iseg_fw] * flux_weights_[norm_fw];
-                    surf_sum_(surf_fw * 2 + 0) += psi1[iseg_fw];
-                    surf_norm_(surf_fw * 2 + 0) += 1.0;
+        int ithread = omp_get_thread_num();
+        assert(ithread < t_current_.extent(0));
+
+        real_t *current      = &t_current_(ithread, 0);
+        real_t *surface_flux = &t_surface_flux_(ithread, 0);
+        real_t *surf_sum     = &t_surf_sum_(ithread, 0);
+        real_t *surf_norm    = &t_surf_norm_(ithread, 0);
+        real_t *vol_sum      = &t_vol_sum_(ithread, 0);
+        real_t *vol_norm     = &t_vol_norm_(ithread, 0);
+        real_t *sigt_sum     = &t_sigt_sum_(ithread, 0);
+
+        int cell_fw = ray.cm_cell_fw();
+        int cell_bw = ray.cm_cell_bw();
+        int surf_fw = ray.cm_surf_fw();
+        int surf_bw = ray.cm_surf_bw();
+        int iseg_fw = 0;
+        int iseg_bw = ray.nseg();
+
+        // The buffers all use plane-by-plane indexing. The offset for the
+        // current contributions is applied in the reduction.
+        int norm_fw = (int)mesh_->surface_normal(surf_fw);
+        int norm_bw = (int)mesh_->surface_normal(surf_bw);
+        current[surf_fw] += psi1[iseg_fw] * current_weights_[norm_fw];
+        current[surf_bw] -= psi2[iseg_bw] * current_weights_[norm_bw];
+        surface_flux[surf_fw] += psi1[iseg_fw] * flux_weights_[norm_fw];
+        surface_flux[surf_bw] -= psi2[iseg_bw] * flux_weights_[norm_bw];
+
+        surf_sum[surf_fw * 2 + 0] += psi1[iseg_fw];
+        surf_sum[surf_bw * 2 + 1] += psi2[iseg_bw];
+        surf_norm[surf_fw * 2 + 0] += 1.0;
+        surf_norm[surf_bw * 2 + 1] += 1.0;
+
+        auto begin = ray.cm_data().cbegin();
+        auto end   = ray.cm_data().cend();
+        for (auto crd = begin; crd != end; ++crd) {
+            // Hopefully branch prediction saves me here.
+            if (crd->fw != Surface::INVALID) {
+                // Store forward volumetric stuff
+                for (unsigned i = 0; i < crd->nseg_fw; i++) {
+                    int ireg         = ray.seg_index(iseg_fw) + first_reg;
+                    real_t xstr      = xstr_split_[ireg];
+                    real_t xstr_true = xstr_true_[ireg];
+                    real_t t         = ang_.rsintheta * ray.seg_len(iseg_fw);
+                    real_t fluxvol   = t * qbar_(ireg) +
+                                     (psi1[iseg_fw] - psi1[iseg_fw + 1]) / xstr;
+                    vol_sum[cell_fw * 2 + 0] += fluxvol;
+                    vol_norm[cell_fw] += t;
+                    sigt_sum[cell_fw * 2 + 0] += xstr_true * fluxvol;
+                    iseg_fw++;
                 }
+                // Store FW surface stuff
+                norm_fw = (int)surface_to_normal(crd->fw);
+                surf_fw = mesh_->coarse_surf(cell_fw, crd->fw);
+                current[surf_fw] += psi1[iseg_fw] * current_weights_[norm_fw];
+                surface_flux[surf_fw] += psi1[iseg_fw] * flux_weights_[norm_fw];
+                surf_sum[surf_fw * 2 + 0] += psi1[iseg_fw];
+                surf_norm[surf_fw * 2 + 0] += 1.0;
+            }
 
-                if (crd->bw != Surface::INVALID) {
-                    // Store backward volumetric stuff
-                    for (unsigned i = 0; i < crd->nseg_bw; i++) {
-                        iseg_bw--;
-                        int ireg         = ray.seg_index(iseg_bw) + first_reg;
-                        real_t xstr      = xstr_split_[ireg];
-                        real_t xstr_true = xstr_true_[ireg];
-                        real_t t       = ang_.rsintheta * ray.seg_len(iseg_bw);
-                        real_t fluxvol = t * qbar_(ireg) +
-                                         e_tau(iseg_bw) *
-                                             (psi2[iseg_bw + 1] - qbar_(ireg)) /
-                                             xstr;
-                        vol_sum_(cell_bw * 2 + 1) += fluxvol;
-                        sigt_sum_(cell_bw * 2 + 1) += xstr_true * fluxvol;
-                    }
-                    // Store BW surface stuff
-                    norm_bw = (int)surface_to_normal(crd->bw);
-                    surf_bw = mesh_->coarse_surf(cell_bw, crd->bw);
-                    current(surf_bw + surf_offset_) -=
-                        psi2[iseg_bw] * current_weights_[norm_bw];
-                    surface_flux(surf_bw + surf_offset_) -=
-                        psi2[iseg_bw] * flux_weights_[norm_bw];
-                    surf_sum_(surf_bw * 2 + 1) += psi2[iseg_bw];
-                    surf_norm_(surf_bw * 2 + 1) += 1.0;
+            if (crd->bw != Surface::INVALID) {
+                // Store backward volumetric stuff
+                for (unsigned i = 0; i < crd->nseg_bw; i++) {
+                    iseg_bw--;
+                    int ireg         = ray.seg_index(iseg_bw) + first_reg;
+                    real_t xstr      = xstr_split_[ireg];
+                    real_t xstr_true = xstr_true_[ireg];
+                    real_t t         = ang_.rsintheta * ray.seg_len(iseg_bw);
+                    real_t fluxvol =
+                        t * qbar_(ireg) +
+                        e_tau(iseg_bw) * (psi2[iseg_bw + 1] - qbar_(ireg)) /
+                            xstr;
+                    vol_sum[cell_bw * 2 + 1] += fluxvol;
+                    sigt_sum[cell_bw * 2 + 1] += xstr_true * fluxvol;
                 }
-
-                cell_fw = mesh_->coarse_neighbor(cell_fw, (crd)->fw);
-                cell_bw = mesh_->coarse_neighbor(cell_bw, (crd)->bw);
+                // Store BW surface stuff
+                norm_bw = (int)surface_to_normal(crd->bw);
+                surf_bw = mesh_->coarse_surf(cell_bw, crd->bw);
+                current[surf_bw] -= psi2[iseg_bw] * current_weights_[norm_bw];
+                surface_flux[surf_bw] -= psi2[iseg_bw] * flux_weights_[norm_bw];
+                surf_sum[surf_bw * 2 + 1] += psi2[iseg_bw];
+                surf_norm[surf_bw * 2 + 1] += 1.0;
             }
+
+            cell_fw = mesh_->coarse_neighbor(cell_fw, (crd)->fw);
+            cell_bw = mesh_->coarse_neighbor(cell_bw, (crd)->bw);
         }
         return;
     }
@@ -209,19 +267,75 @@ public:
         moc::Current::set_angle(ang, spacing);
         ang_ = ang;
 
-        // Zero out all of the flux sum arrays
-        surf_sum_  = 0.0;
-        surf_norm_ = 0.0;
-        vol_sum_   = 0.0;
-        vol_norm_  = 0.0;
-        sigt_sum_  = 0.0;
-
 #pragma omp barrier
         return;
     }
 
+    /**
+     * \brief Reduce the thread-private tallies for the angle and compute the
+     * correction factors.
+     *
+     * This must be called by all threads in the team. The reduction is
+     * split between them, and the thread-private buffers are zeroed along
+     * the way, ready for the next angle.
+     */
     void post_angle(int iang)
     {
+        int n_thread = t_current_.extent(0);
+        int n_surf   = mesh_->n_surf_plane();
+        int n_cell   = mesh_->n_cell_plane();
+
+#pragma omp for
+        for (int i = 0; i < n_surf; i++) {
+            real_t current      = 0.0;
+            real_t surface_flux = 0.0;
+            for (int it = 0; it < n_thread; it++) {
+                current += t_current_(it, i);
+                surface_flux += t_surface_flux_(it, i);
+                t_current_(it, i)      = 0.0;
+                t_surface_flux_(it, i) = 0.0;
+            }
+            coarse_data_->current(i + surf_offset_, group_) += current;
+            coarse_data_->surface_flux(i + surf_offset_, group_) +=
+                surface_flux;
+
+            for (int j = 2 * i; j < 2 * i + 2; j++) {
+                real_t surf_sum  = 0.0;
+                real_t surf_norm = 0.0;
+                for (int it = 0; it < n_thread; it++) {
+                    surf_sum += t_surf_sum_(it, j);
+                    surf_norm += t_surf_norm_(it, j);
+                    t_surf_sum_(it, j)  = 0.0;
+                    t_surf_norm_(it, j) = 0.0;
+                }
+                surf_sum_(j)  = surf_sum;
+                surf_norm_(j) = surf_norm;
+            }
+        }
+
+#pragma omp for
+        for (int i = 0; i < n_cell; i++) {
+            real_t vol_norm = 0.0;
+            for (int it = 0; it < n_thread; it++) {
+                vol_norm += t_vol_norm_(it, i);
+                t_vol_norm_(it, i) = 0.0;
+            }
+            vol_norm_(i) = vol_norm;
+
+            for (int j = 2 * i; j < 2 * i + 2; j++) {
+                real_t vol_sum  = 0.0;
+                real_t sigt_sum = 0.0;
+                for (int it = 0; it < n_thread; it++) {
+                    vol_sum += t_vol_sum_(it, j);
+                    sigt_sum += t_sigt_sum_(it, j);
+                    t_vol_sum_(it, j)  = 0.0;
+                    t_sigt_sum_(it, j) = 0.0;
+                }
+                vol_sum_(j)  = vol_sum;
+                sigt_sum_(j) = sigt_sum;
+            }
+        }
+
 #pragma omp single
         {
             // Do the stock area normailzation
@@ -247,6 +361,9 @@ public:
 
 private:
     CorrectionData *corrections_;
+    // The correction factors from the last sweep, for computing residuals.
+    // Usually the same as corrections_.
+    const CorrectionData *previous_;
     // References to the source and cross sections as defined on the fine mesh.
     // We need these to get actual angular flux for a ray segment
     const VectorX &qbar_;
@@ -274,11 +391,24 @@ private:
     ArrayB1 sigt_sum_;
     ArrayB1 surf_norm_;
 
+    // Thread-private versions of the above, along with the plane's currents
+    // and surface fluxes, indexed by (thread, index). These are tallied by
+    // post_ray() and reduced into the shared arrays by post_angle().
+    ArrayB2 t_current_;
+    ArrayB2 t_surface_flux_;
+    ArrayB2 t_surf_sum_;
+    ArrayB2 t_vol_sum_;
+    ArrayB2 t_vol_norm_;
+    ArrayB2 t_sigt_sum_;
+    ArrayB2 t_surf_norm_;
+
     Angle ang_;
 
     const moc::RayData &rays_;
 
-    std::array<real_t, 3> residual_;
+    // Sum of the squared changes in the correction factors, shared by all
+    // copies
+    std::shared_ptr<std::array<real_t, 3>> residual_;
 
     // Index offset to get the first coarse mesh region in a given macroplane
     std::vector<int> mplane_offset_;
@@ -30,6 +30,7 @@ MoCSweeper_2D3D::MoCSweeper_2D3D(const pugi::xml_node &input,
                                  const CoreMesh &mesh)
     : MoCSweeper(input, mesh),
       corrections_(nullptr),
+      staging_(nullptr),
       xstr_true_(),
       sn_xs_mesh_(nullptr),
       internal_coupling_(false),
@@ -42,6 +43,12 @@ MoCSweeper_2D3D::MoCSweeper_2D3D(const pugi::xml_node &input,
     }
     LogFile << "Constructing a 2D3D MoC sweeper" << std::endl;
 
+    // The correction worker needs the segment data on each Ray
+    if (rays_.modular()) {
+        throw EXCEPT("Modular ray storage is not supported by the 2D3D MoC "
+                     "sweeper.");
+    }
+
     return;
 };
 
@@ -65,9 +72,11 @@ void MoCSweeper_2D3D::sweep(int group)
     }
 
     // Instantiate the workers for current/no current
-    CurrentCorrections ccw(coarse_data_, &mesh_, corrections_.get(),
-                           source_->get_transport(0), xstr_true_, xstr_,
-                           xstr_sn_, ang_quad_, rays_);
+    CorrectionData *new_corrections =
+        staging_ ? staging_.get() : corrections_.get();
+    CurrentCorrections ccw(coarse_data_, &mesh_, new_corrections,
+                           corrections_.get(), source_->get_transport(0),
+                           xstr_true_, xstr_, xstr_sn_, ang_quad_, rays_);
     moc::NoCurrent ncw(coarse_data_, &mesh_);
 
     auto all = blitz::Range::all();
@@ -75,22 +84,37 @@ void MoCSweeper_2D3D::sweep(int group)
     flux_1g_.reference(flux_(all, group));
 
     // Perform inner iterations
-    for (unsigned int inner = 0; inner < n_inner_; inner++) {
+    unsigned int n_inner = inner_control_.n_inner(group);
+    inner_control_.begin(group, flux_1g_);
+    for (unsigned int inner = 0; inner < n_inner; inner++) {
         n_sweep_inner_++;
         // update the self-scattering source
         source_->self_scatter(group, xstr_.xs());
 
         // Perform the stock sweep unless we are on the last outer and have
         // a CoarseData object.
-        if (inner == n_inner_ - 1 && coarse_data_) {
+        if (inner == n_inner - 1 && coarse_data_) {
             coarse_data_->zero_data_radial(group);
-            sn_xs_mesh_->update();
-            this->sweep1g(group, ccw);
+            // While the homogenized cross sections are held, whoever holds
+            // them has already expanded them for this group, and the Sn
+            // sweeper may be reading the expansion concurrently
+            if (!sn_xs_mesh_->held()) {
+                sn_xs_mesh_->update();
+                xstr_sn_.expand(group);
+            }
+            if (plane_parallel_) {
+                this->sweep1g_plane_parallel(group, ccw);
+            } else {
+                this->sweep1g(group, ccw);
+            }
             coarse_data_->set_has_radial_data(true);
             correction_residuals_[group].push_back(ccw.residual());
+        } else if (plane_parallel_) {
+            this->sweep1g_plane_parallel(group, ncw);
         } else {
             this->sweep1g(group, ncw);
         }
+        inner_control_.observe(group, flux_1g_);
     }
 
     timer_.toc();
@@ -28,6 +28,17 @@ public:
 
     void sweep(int group);
 
+    /**
+     * \brief Sweep all groups one at a time.
+     *
+     * The group-batched kernel in \ref moc::MoCSweeper does not produce
+     * correction factors, so fall back to the per-group \ref sweep().
+     */
+    void sweep_multigroup(const ArrayB2 &source) override
+    {
+        TransportSweeper::sweep_multigroup(source);
+    }
+
     /**
      * \brief Assign correction and cross-section coupling.
      *
@@ -47,6 +58,19 @@ public:
         xstr_sn_     = xstr;
     }
 
+    /**
+     * \brief Write new correction factors to a separate buffer, rather than
+     * to the coupled \ref CorrectionData.
+     *
+     * This is for when the coupled factors are still in use while sweeping.
+     * The buffer may be a \ref CorrectionData::group_buffer(), since it only
+     * needs to hold the group being swept.
+     */
+    void set_staging(std::shared_ptr<CorrectionData> buffer)
+    {
+        staging_ = buffer;
+    }
+
     /**
      * \brief Allocate space internally to store coupling coefficients and
      * cross sections. Mainly useful for one-way coupling.
@@ -72,6 +96,7 @@ private:
     void sweep1g_final(int group);
 
     std::shared_ptr<CorrectionData> corrections_;
+    std::shared_ptr<CorrectionData> staging_;
 
     /**
      * The transport cross sections for the current group, unaltered due to
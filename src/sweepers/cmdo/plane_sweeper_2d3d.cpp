@@ -16,11 +16,14 @@
 
 #include "plane_sweeper_2d3d.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <exception>
 #include <iomanip>
 #include <iostream>
 #include <numeric>
 #include "util/error.hpp"
+#include "util/omp_guard.h"
 #include "util/range.hpp"
 #include "util/validate_input.hpp"
 #include "sn_sweeper_factory_cdd.hpp"
@@ -39,7 +42,9 @@ const std::vector<std::string> recognized_attributes = {
     "discrepant_flux_update",
     "dump_corrections",
     "update_incoming",
-    "cycle"};
+    "cycle",
+    "pipeline",
+    "sn_threads"};
 }
 
 namespace mocc {
@@ -87,6 +92,10 @@ PlaneSweeper_2D3D::PlaneSweeper_2D3D(const pugi::xml_node &input,
     assert(corrections_);
     moc_sweeper_.set_coupling(corrections_, sn_xs_mesh,
                               sn_sweeper_->expanded_xs());
+    if (pipeline_) {
+        moc_corrections_ = corrections_->group_buffer();
+        moc_sweeper_.set_staging(moc_corrections_);
+    }
 
     if (!keep_sn_quad_) {
         sn_sweeper_->set_ang_quad(ang_quad_);
@@ -113,8 +122,15 @@ void PlaneSweeper_2D3D::sweep(int group)
         i_outer_++;
     }
 
+    bool do_moc =
+        ((i_outer_ + 1) > n_inactive_moc_) && ((i_outer_ % moc_modulo_) == 0);
+
+    if (pipeline_) {
+        this->sweep_pipeline(group, do_moc);
+    }
+
     // Calculate transverse leakage source
-    if (do_tl_) {
+    if (do_tl_ && !pipeline_) {
         this->add_tl(group);
     }
 
@@ -142,29 +158,11 @@ void PlaneSweeper_2D3D::sweep(int group)
     }
 
     // MoC Sweeper
-    bool do_moc =
-        ((i_outer_ + 1) > n_inactive_moc_) && ((i_outer_ % moc_modulo_) == 0);
-    if (do_moc) {
+    if (do_moc && !pipeline_) {
         moc_sweeper_.sweep(group);
-
-        int n_negative  = 0;
-        int n_NaN       = 0;
-        const auto flux = moc_sweeper_.flux()(blitz::Range::all(), group);
-        for (const auto &v : flux) {
-            if (v < 0.0) {
-                n_negative++;
-            }
-            if (v != v) {
-                n_NaN++;
-            }
-        }
-        if (n_negative > 0) {
-            LogScreen << n_negative << " negative MoC fluxes in group " << group
-                      << "\n";
-        }
-        if (n_NaN > 0) {
-            LogScreen << n_NaN << " NaN MoC fluxes in group " << group << "\n";
-        }
+    }
+    if (do_moc) {
+        this->check_moc_flux(group);
     }
 
     ArrayB1 prev_moc_flux = prev_moc_flux_(group, blitz::Range::all());
@@ -176,7 +174,9 @@ void PlaneSweeper_2D3D::sweep(int group)
     }
 
     // Sn sweeper
-    sn_sweeper_->sweep(group);
+    if (!pipeline_) {
+        sn_sweeper_->sweep(group);
+    }
 
     ArrayB1 sn_flux(mesh_.n_reg(MeshTreatment::PIN_PLANE));
     sn_sweeper_->get_pin_flux_1g(group, sn_flux, MeshTreatment::PIN_PLANE);
@@ -216,6 +216,123 @@ void PlaneSweeper_2D3D::sweep(int group)
     sn_resid_norm_[group].push_back(residual);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/**
+ * The Sn sweep for a group needs the correction factors, transverse leakage
+ * and homogenized cross sections that come out of the MoC sweep for that
+ * group, so they can't overlap as-is. Here the Sn sweep uses the correction
+ * factors from the previous outer iteration instead, which are held in \ref
+ * corrections_ while the MoC sweeper writes new ones for the group to the
+ * one-group buffer \ref moc_corrections_. The two sweeps are then run as
+ * concurrent tasks, with the dependencies between them stated explicitly:
+ *  - the transverse leakage is computed from the axial currents left by the
+ *  last Sn sweep of this group, so it has to finish before the MoC sweep uses
+ *  \ref tl_, and before the Sn sweep overwrites the currents,
+ *  - the new MoC corrections are only copied into \ref corrections_ once the
+ *  Sn sweep is done reading the old ones.
+ *
+ * The homogenized cross sections are updated and expanded up front and held,
+ * since they are otherwise recomputed from the MoC flux while it is being
+ * swept. The MoC sweeper leaves the held expansion alone, so that only the Sn
+ * task touches it.
+ */
+void PlaneSweeper_2D3D::sweep_pipeline(int group, bool do_moc)
+{
+    auto sn_xs_mesh = sn_sweeper_->get_homogenized_xsmesh();
+    sn_xs_mesh->update();
+    sn_sweeper_->expanded_xs().expand(group);
+    sn_xs_mesh->set_hold(true);
+
+    int n_thread     = omp_get_max_threads();
+    int n_sn_thread  = std::min(n_sn_thread_, std::max(1, n_thread - 1));
+    int n_moc_thread = std::max(1, n_thread - n_sn_thread);
+
+    // Local handles on everything that the tasks depend on
+    ArrayB2 &tl                  = tl_;
+    CoarseData &coarse_data      = *coarse_data_;
+    CorrectionData &sn_corr      = *corrections_;
+    CorrectionData &moc_corr     = *moc_corrections_;
+    std::exception_ptr exception = nullptr;
+
+    {
+        // The MoC and Sn sweepers each use their own team of threads,
+        // inside of the team running the two of them
+        ScopedActiveLevels levels(3);
+#pragma omp parallel num_threads(2)
+#pragma omp single
+        {
+#pragma omp task depend(in : coarse_data) depend(out : tl)
+            {
+                if (do_tl_) {
+                    this->add_tl(group);
+                }
+            }
+
+#pragma omp task depend(in : tl) depend(in : sn_corr) depend(out : moc_corr)
+            {
+                if (do_moc) {
+                    try {
+                        omp_set_num_threads(n_moc_thread);
+                        moc_sweeper_.sweep(group);
+                    } catch (...) {
+#pragma omp critical
+                        exception = std::current_exception();
+                    }
+                }
+            }
+
+#pragma omp task depend(inout : coarse_data) depend(in : sn_corr)
+            {
+                try {
+                    omp_set_num_threads(n_sn_thread);
+                    sn_sweeper_->sweep(group);
+                } catch (...) {
+#pragma omp critical
+                    exception = std::current_exception();
+                }
+            }
+
+#pragma omp task depend(in : moc_corr) depend(inout : sn_corr)
+            {
+                if (do_moc) {
+                    sn_corr.copy_group(moc_corr, group);
+                }
+            }
+        }
+    }
+
+    sn_xs_mesh->set_hold(false);
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+
+    return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PlaneSweeper_2D3D::check_moc_flux(int group) const
+{
+    int n_negative  = 0;
+    int n_NaN       = 0;
+    const auto flux = moc_sweeper_.flux()(blitz::Range::all(), group);
+    for (const auto &v : flux) {
+        if (v < 0.0) {
+            n_negative++;
+        }
+        if (v != v) {
+            n_NaN++;
+        }
+    }
+    if (n_negative > 0) {
+        LogScreen << n_negative << " negative MoC fluxes in group " << group
+                  << "\n";
+    }
+    if (n_NaN > 0) {
+        LogScreen << n_NaN << " NaN MoC fluxes in group " << group << "\n";
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void PlaneSweeper_2D3D::initialize()
 {
@@ -372,6 +489,8 @@ void PlaneSweeper_2D3D::parse_options(const pugi::xml_node &input)
     discrepant_flux_update_ = false;
     dump_corrections_       = false;
     v_cycle_                = false;
+    pipeline_               = false;
+    n_sn_thread_            = std::max(1, omp_get_max_threads() / 4);
 
     // Override with entries in the input node
     if (!input.attribute("expose_sn").empty()) {
@@ -415,6 +534,25 @@ void PlaneSweeper_2D3D::parse_options(const pugi::xml_node &input)
         }
     }
 
+    pipeline_ = input.attribute("pipeline").as_bool(false);
+    if (!input.attribute("sn_threads").empty()) {
+        n_sn_thread_ = input.attribute("sn_threads").as_int();
+        if (n_sn_thread_ < 1) {
+            throw EXCEPT("sn_threads must be positive");
+        }
+    }
+    if (pipeline_) {
+        // Both of these need the MoC flux for a group before its Sn sweep
+        if (v_cycle_) {
+            throw EXCEPT("Pipelined sweeps are not compatible with the V "
+                         "cycle");
+        }
+        if (do_mocproject_) {
+            throw EXCEPT("Pipelined sweeps are not compatible with MoC "
+                         "projection");
+        }
+    }
+
     // Make sure that sn project is on if we are exposing sn
     if (expose_sn_ && !do_snproject_) {
         Warn(
@@ -441,6 +579,10 @@ void PlaneSweeper_2D3D::parse_options(const pugi::xml_node &input)
     LogFile << "    MoC sweep modulo: " << moc_modulo_ << "\n";
     LogFile << "    Apply Sn-MoC flux residual to CMFD updates: "
             << discrepant_flux_update_ << "\n";
+    LogFile << "    Pipelined Sn/MoC sweeps: " << pipeline_ << "\n";
+    if (pipeline_) {
+        LogFile << "    Sn threads: " << n_sn_thread_ << "\n";
+    }
     LogFile << "    Sweep cycle: ";
     if (v_cycle_) {
         LogFile << "V"
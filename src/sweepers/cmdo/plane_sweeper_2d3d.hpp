@@ -41,6 +41,16 @@ public:
 
     void sweep(int group) override final;
 
+    /**
+     * \brief Jacobi group iteration is not supported, since the Sn and MoC
+     * sweepers carry separate sources.
+     */
+    void sweep_multigroup(const ArrayB2 &source) override final
+    {
+        throw EXCEPT("Jacobi group iteration is not supported by the 2D3D "
+                     "sweeper.");
+    }
+
     void initialize() override final;
 
     /**
@@ -58,6 +68,26 @@ public:
         return;
     }
 
+    /**
+     * \brief The state of the 2D3D sweeper is spread between the Sn and MoC
+     * sweepers, their coupling and the outer iteration count, so it is not
+     * exposed.
+     */
+    int n_boundary_values() const override final
+    {
+        throw EXCEPT("Boundary values are not exposed by the 2D3D sweeper.");
+    }
+
+    void get_boundary_values(real_t *out) const override final
+    {
+        throw EXCEPT("Boundary values are not exposed by the 2D3D sweeper.");
+    }
+
+    void set_boundary_values(const real_t *in) override final
+    {
+        throw EXCEPT("Boundary values are not exposed by the 2D3D sweeper.");
+    }
+
     /**
      * \brief \copybrief TransportSweeper::get_pin_flux_1g()
      */
@@ -212,6 +242,33 @@ public:
         return;
     }
 
+    /**
+     * \brief \copybrief TransportSweeper::set_inner_tolerance()
+     *
+     * Defer to the MoC and Sn sweepers.
+     */
+    void set_inner_tolerance(real_t tol) override final
+    {
+        moc_sweeper_.set_inner_tolerance(tol);
+        sn_sweeper_->set_inner_tolerance(tol);
+        return;
+    }
+
+    /**
+     * \brief \copybrief TransportSweeper::inner_control()
+     *
+     * This is the controller of the MoC sweeper if it is adaptive, since that
+     * is where most of the inner iterations go, otherwise that of the Sn
+     * sweeper.
+     */
+    const InnerIterationControl &inner_control() const override final
+    {
+        if (moc_sweeper_.inner_control().adaptive()) {
+            return moc_sweeper_.inner_control();
+        }
+        return sn_sweeper_->inner_control();
+    }
+
     /**
      * \brief \copybrief TransportSweeper::set_coarse_data()
      *
@@ -220,8 +277,19 @@ public:
     void set_coarse_data(CoarseData *cd) override final
     {
         coarse_data_ = cd;
-        moc_sweeper_.set_coarse_data(cd);
         sn_sweeper_->set_coarse_data(cd);
+
+        // When pipelining, the MoC sweeper would otherwise be tallying
+        // currents into the same group as the concurrent Sn sweep. Those
+        // tallies are overwritten by the Sn sweeper anyways, so give the MoC
+        // sweeper somewhere else to put them.
+        if (pipeline_) {
+            moc_coarse_data_ =
+                std::unique_ptr<CoarseData>(new CoarseData(mesh_, n_group_));
+            moc_sweeper_.set_coarse_data(moc_coarse_data_.get());
+        } else {
+            moc_sweeper_.set_coarse_data(cd);
+        }
     }
 
 private:
@@ -235,6 +303,12 @@ private:
     // Calculate transverse leakage based on the state of the coarse_data_
     // and apply to the MoC sweeper's source.
     void add_tl(int group);
+    // Perform the MoC and Sn sweeps for a group concurrently, with the Sn
+    // sweeper using the correction factors from the previous outer
+    // iteration.
+    void sweep_pipeline(int group, bool do_moc);
+    // Report negative and NaN MoC fluxes in a group
+    void check_moc_flux(int group) const;
 
     const CoreMesh &mesh_;
 
@@ -243,6 +317,12 @@ private:
 
     UP_SnSweeper_t sn_sweeper_;
     std::shared_ptr<CorrectionData> corrections_;
+    // One-group buffer for the correction factors produced by the MoC
+    // sweeper when pipelining. They are copied to corrections_ once the Sn
+    // sweeper is done with the old ones. Unused otherwise.
+    std::shared_ptr<CorrectionData> moc_corrections_;
+    // Private coarse data for the MoC sweeper when pipelining
+    std::unique_ptr<CoarseData> moc_coarse_data_;
     MoCSweeper_2D3D moc_sweeper_;
     AngularQuadrature ang_quad_;
     // Pin-level transverse leakage. This is in coarse mesh ordering (at the
@@ -290,6 +370,12 @@ private:
     bool dump_corrections_;
     // Whether to use a sawtooth or V cycle in the sweep
     bool v_cycle_;
+    // Whether to overlap the Sn sweep with the MoC sweep, using lagged
+    // correction factors
+    bool pipeline_;
+    // Number of threads to give to the Sn sweeper when pipelining. The rest
+    // go to MoC.
+    int n_sn_thread_;
 };
 }
 } // Namespace mocc::cmdo
@@ -0,0 +1,145 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "UnitTest++/UnitTest++.h"
+
+#include "util/global_config.hpp"
+#include "cmdo/correction_data.hpp"
+
+using namespace mocc;
+
+// Cells get slots in the order that they are first given a non-default factor,
+// and factors within the tolerance of the default don't allocate anything
+TEST(slot_assignment)
+{
+    CorrectionStorage<double> data(200, 4, 2, 1.0e-3);
+    CHECK(data.sparse());
+    CHECK_EQUAL(0, data.n_slot());
+    CHECK_EQUAL(0u, data.size());
+
+    data.set(17, 1, 1, 2, 1.0005, 1.0);
+    CHECK_EQUAL(0, data.n_slot());
+    CHECK_EQUAL(-1, data.slot(17));
+    CHECK_CLOSE(1.0, data.get(17, 1, 1, 2, 1.0), 1.0e-15);
+
+    data.set(17, 1, 1, 2, 0.8, 1.0);
+    data.set(3, 0, 0, 0, 0.6, 0.5);
+    data.set(17, 3, 0, 1, 0.4, 0.5);
+    CHECK_EQUAL(2, data.n_slot());
+    CHECK_EQUAL(0, data.slot(17));
+    CHECK_EQUAL(1, data.slot(3));
+
+    CHECK_CLOSE(0.8, data.get(17, 1, 1, 2, 1.0), 1.0e-15);
+    CHECK_CLOSE(0.4, data.get(17, 3, 0, 1, 0.5), 1.0e-15);
+    CHECK_CLOSE(0.6, data.get(3, 0, 0, 0, 0.5), 1.0e-15);
+
+    // Factors that were never set in a cell with a slot take their defaults
+    CHECK_CLOSE(0.5, data.get(17, 1, 1, 0, 0.5), 1.0e-15);
+    CHECK_CLOSE(1.0, data.get(3, 2, 1, 2, 1.0), 1.0e-15);
+}
+
+// Growing the storage past a block boundary must not disturb the factors
+// already stored, and a fully-populated sparse storage must be no larger than
+// a full one
+TEST(growth)
+{
+    const int n_cell  = 3 * CorrectionStorage<double>::BLOCK_SIZE + 5;
+    const int n_ang   = 3;
+    const int n_group = 2;
+    CorrectionStorage<double> full(n_cell, n_ang, n_group, -1.0);
+    CorrectionStorage<double> sparse(n_cell, n_ang, n_group, 0.0);
+    CHECK(!full.sparse());
+    CHECK_EQUAL(n_cell, full.n_slot());
+    CHECK_EQUAL((size_t)n_cell * n_ang * n_group * 3, full.size());
+
+    // Populate the cells in reverse, so that slots and cells differ
+    for (int i = n_cell - 1; i >= 0; i--) {
+        for (int g = 0; g < n_group; g++) {
+            for (int a = 0; a < n_ang; a++) {
+                real_t v = 0.01 * i + 0.1 * g + 0.001 * a;
+                sparse.set(i, a, g, 2, 2.0 + v, 1.0);
+                full.set(i, a, g, 2, 2.0 + v, 1.0);
+            }
+        }
+        CHECK_EQUAL(n_cell - i, sparse.n_slot());
+        CHECK(sparse.size() <= full.size());
+
+        // Everything stored so far is still intact
+        int j = std::min(n_cell - 1, i + CorrectionStorage<double>::BLOCK_SIZE);
+        CHECK_CLOSE(2.0 + 0.01 * j + 0.1 + 0.002, sparse.get(j, 2, 1, 2, 1.0),
+                    1.0e-14);
+    }
+
+    CHECK_EQUAL(full.size(), sparse.size());
+    CHECK_EQUAL(0, sparse.slot(n_cell - 1));
+    CHECK_EQUAL(n_cell - 1, sparse.slot(0));
+    for (int i = 0; i < n_cell; i++) {
+        for (int g = 0; g < n_group; g++) {
+            for (int a = 0; a < n_ang; a++) {
+                CHECK_EQUAL(full.get(i, a, g, 2, 1.0),
+                            sparse.get(i, a, g, 2, 1.0));
+                CHECK_EQUAL(0.5, sparse.get(i, a, g, 0, 0.5));
+                CHECK_EQUAL(0.5, sparse.get(i, a, g, 1, 0.5));
+            }
+        }
+    }
+}
+
+// Single-precision storage should give back the factors to single precision,
+// and representable ones exactly
+TEST(single_precision)
+{
+    CorrectionStorage<float> data(10, 2, 2, -1.0);
+    CorrectionStorage<float> sparse(10, 2, 2, 0.0);
+
+    real_t v = 0.123456789012345;
+    data.set(4, 1, 1, 0, v, 0.5);
+    sparse.set(4, 1, 1, 0, v, 0.5);
+    CHECK_CLOSE(v, data.get(4, 1, 1, 0, 0.5), 1.0e-7);
+    CHECK_EQUAL((float)v, data.get(4, 1, 1, 0, 0.5));
+    CHECK_EQUAL((float)v, sparse.get(4, 1, 1, 0, 0.5));
+
+    data.set(9, 0, 1, 2, 0.75, 1.0);
+    CHECK_EQUAL(0.75, data.get(9, 0, 1, 2, 1.0));
+    CHECK_EQUAL(0.5, data.get(9, 0, 1, 0, 0.5));
+    CHECK_EQUAL(1.0, data.get(9, 1, 0, 2, 1.0));
+}
+
+// With folded groups, only one group is stored, and all groups share it
+TEST(fold_groups)
+{
+    CorrectionStorage<double> data(10, 3, 4, -1.0, true);
+    CorrectionStorage<double> sparse(10, 3, 4, 0.0, true);
+    CHECK_EQUAL((size_t)10 * 3 * 3, data.size());
+
+    data.set(5, 2, 1, 1, 0.7, 0.5);
+    CHECK_CLOSE(0.7, data.get(5, 2, 1, 1, 0.5), 1.0e-15);
+    CHECK_CLOSE(0.7, data.get(5, 2, 3, 1, 0.5), 1.0e-15);
+
+    data.set(5, 2, 3, 1, 0.2, 0.5);
+    CHECK_CLOSE(0.2, data.get(5, 2, 1, 1, 0.5), 1.0e-15);
+    CHECK_CLOSE(0.5, data.get(5, 1, 1, 1, 0.5), 1.0e-15);
+
+    sparse.set(8, 0, 2, 2, 3.0, 1.0);
+    CHECK_EQUAL(1, sparse.n_slot());
+    CHECK(sparse.size() <= data.size());
+    CHECK_CLOSE(3.0, sparse.get(8, 0, 0, 2, 1.0), 1.0e-15);
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -16,9 +16,13 @@
 
 #pragma once
 
+#include <array>
 #include <cmath>
+#include "util/blitz_typedefs.hpp"
 #include "util/force_inline.hpp"
 #include "util/global_config.hpp"
+#include "util/omp_guard.h"
+#include "core/coarse_data.hpp"
 #include "core/constants.hpp"
 #include "core/geometry/angle.hpp"
 #include "ray.hpp"
@@ -328,5 +332,188 @@ protected:
     int cell_offset_;
     int surf_offset_;
 };
+
+/**
+ * \brief Tally the currents for a block of groups that are swept together by
+ * \ref MoCSweeper::sweep_group_block().
+ *
+ * This does the same work as \ref moc::Current, but for all of the groups in
+ * the block at once, and into thread-private buffers rather than in a
+ * critical section. Different blocks touch different groups of the \ref
+ * CoarseData, so blocks that are swept concurrently can each have their own
+ * worker.
+ *
+ * The angular flux along a ray is passed in group-innermost, for each of the
+ * segment boundaries of the ray.
+ */
+class GroupBlockCurrent {
+public:
+    GroupBlockCurrent(CoarseData *data, const Mesh *mesh, int first_group,
+                      int n_group, int n_thread)
+        : coarse_data_(data),
+          mesh_(mesh),
+          first_group_(first_group),
+          n_group_(n_group),
+          t_current_(n_thread, mesh->n_surf_plane() * n_group),
+          t_surface_flux_(n_thread, mesh->n_surf_plane() * n_group),
+          plane_(0),
+          surf_offset_(0)
+    {
+        t_current_      = 0.0;
+        t_surface_flux_ = 0.0;
+        return;
+    }
+
+    MOCC_FORCE_INLINE void set_plane(int plane)
+    {
+        plane_       = plane;
+        surf_offset_ = mesh_->coarse_surf_offset(plane);
+    }
+
+    /**
+     * \brief Set up the weights for an angle. This must be called by all
+     * threads in the team.
+     */
+    MOCC_FORCE_INLINE void set_angle(Angle ang, real_t spacing)
+    {
+#pragma omp single
+        {
+            real_t w  = ang.weight * PI;
+            real_t dz = mesh_->dz(plane_);
+
+            current_weights_[0] =
+                w * ang.ox * spacing / std::abs(std::cos(ang.alpha)) * dz;
+            current_weights_[1] =
+                w * ang.oy * spacing / std::abs(std::sin(ang.alpha)) * dz;
+            flux_weights_[0] = w * spacing / std::abs(std::cos(ang.alpha)) * dz;
+            flux_weights_[1] = w * spacing / std::abs(std::sin(ang.alpha)) * dz;
+        }
+    }
+
+    /**
+     * \brief Tally the currents and surface fluxes for a single ray into
+     * the calling thread's buffers, using plane-local surface indices
+     */
+    void post_ray(const real_t *psi1, const real_t *psi2, const Ray &ray)
+    {
+        int ithread          = omp_get_thread_num();
+        real_t *current      = &t_current_(ithread, 0);
+        real_t *surface_flux = &t_surface_flux_(ithread, 0);
+
+        int cell_fw = ray.cm_cell_fw();
+        int cell_bw = ray.cm_cell_bw();
+        int surf_fw = ray.cm_surf_fw();
+        int surf_bw = ray.cm_surf_bw();
+        int iseg_fw = 0;
+        int iseg_bw = ray.nseg();
+
+        int norm_fw = (int)mesh_->surface_normal(surf_fw);
+        int norm_bw = (int)mesh_->surface_normal(surf_bw);
+        this->tally(current, surface_flux, surf_fw, norm_fw,
+                    &psi1[iseg_fw * n_group_], 1.0);
+        this->tally(current, surface_flux, surf_bw, norm_bw,
+                    &psi2[iseg_bw * n_group_], -1.0);
+
+        auto begin = ray.cm_data().cbegin();
+        auto end   = ray.cm_data().cend();
+        for (auto crd = begin; crd != end; ++crd) {
+            if (crd->fw != Surface::INVALID) {
+                iseg_fw += crd->nseg_fw;
+                norm_fw = (int)surface_to_normal(crd->fw);
+                surf_fw = mesh_->coarse_surf(cell_fw, crd->fw);
+                this->tally(current, surface_flux, surf_fw, norm_fw,
+                            &psi1[iseg_fw * n_group_], 1.0);
+            }
+
+            if (crd->bw != Surface::INVALID) {
+                iseg_bw -= crd->nseg_bw;
+                norm_bw = (int)surface_to_normal(crd->bw);
+                surf_bw = mesh_->coarse_surf(cell_bw, crd->bw);
+                this->tally(current, surface_flux, surf_bw, norm_bw,
+                            &psi2[iseg_bw * n_group_], -1.0);
+            }
+
+            cell_fw = mesh_->coarse_neighbor(cell_fw, (crd)->fw);
+            cell_bw = mesh_->coarse_neighbor(cell_bw, (crd)->bw);
+        }
+        return;
+    }
+
+    /**
+     * \brief Reduce the thread-private tallies for the plane into the \ref
+     * CoarseData, zeroing them along the way. This must be called by all
+     * threads in the team.
+     */
+    void post_plane()
+    {
+        int n_thread = t_current_.extent(0);
+        int n        = mesh_->n_surf_plane() * n_group_;
+#pragma omp for
+        for (int i = 0; i < n; i++) {
+            real_t current      = 0.0;
+            real_t surface_flux = 0.0;
+            for (int it = 0; it < n_thread; it++) {
+                current += t_current_(it, i);
+                surface_flux += t_surface_flux_(it, i);
+                t_current_(it, i)      = 0.0;
+                t_surface_flux_(it, i) = 0.0;
+            }
+            int surf  = i / n_group_ + surf_offset_;
+            int group = i % n_group_ + first_group_;
+            coarse_data_->current(surf, group) += current;
+            coarse_data_->surface_flux(surf, group) += surface_flux;
+        }
+        return;
+    }
+
+    /**
+     * \brief Expand and normalize the currents for each group. See \ref
+     * moc::Current::post_sweep().
+     *
+     * This slices the \ref CoarseData arrays, which is not thread safe, so
+     * it should only be called once the concurrent sweeps have finished.
+     */
+    void post_sweep()
+    {
+        for (int group = first_group_; group < first_group_ + n_group_;
+             group++) {
+            Current cw(coarse_data_, mesh_);
+            cw.set_group(group);
+            cw.post_sweep();
+        }
+        return;
+    }
+
+private:
+    // Tally the current and surface flux of all groups crossing a surface.
+    // The sign is negative for the backward direction.
+    MOCC_FORCE_INLINE void tally(real_t *current, real_t *surface_flux,
+                                 int surf, int norm, const real_t *psi,
+                                 real_t sign)
+    {
+        real_t *c = &current[surf * n_group_];
+        real_t *f = &surface_flux[surf * n_group_];
+        for (int ig = 0; ig < n_group_; ig++) {
+            c[ig] += sign * psi[ig] * current_weights_[norm];
+            f[ig] += psi[ig] * flux_weights_[norm];
+        }
+    }
+
+    CoarseData *coarse_data_;
+    const Mesh *mesh_;
+    int first_group_;
+    int n_group_;
+
+    // Thread-private currents and surface fluxes, indexed by (thread,
+    // surface * n_group + group)
+    ArrayB2 t_current_;
+    ArrayB2 t_surface_flux_;
+
+    std::array<real_t, 2> current_weights_;
+    std::array<real_t, 2> flux_weights_;
+
+    int plane_;
+    int surf_offset_;
+};
 }
 }
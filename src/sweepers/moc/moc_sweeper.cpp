@@ -17,8 +17,10 @@
 #include "moc_sweeper.hpp"
 
 #include <algorithm>
+#include <exception>
 #include <fstream>
 #include <iomanip>
+#include <memory>
 #include "pugixml.hpp"
 #include "util/error.hpp"
 #include "util/files.hpp"
@@ -54,7 +56,8 @@ std::vector<mocc::BC_Size_t> bc_size_helper(const mocc::moc::RayData &rays)
 const std::vector<std::string> recognized_attributes = {
     "type",         "update_incoming", "n_inner",
     "dump_rays",    "boundary_update", "tl_splitting",
-    "dump_fsr_flux"};
+    "dump_fsr_flux", "group_block",     "exponential",
+    "parallel",     "inner_tol"};
 }
 
 namespace mocc {
@@ -75,11 +78,15 @@ MoCSweeper::MoCSweeper(const pugi::xml_node &input, const CoreMesh &mesh)
       flux_1g_(),
       subplane_(mesh.subplane()),
       subplane_bounds_(),
+      group_block_(1),
       bc_type_(mesh_.boundary()),
       dump_rays_(false),
       dump_fsr_flux_(false),
       gauss_seidel_boundary_(true),
-      allow_splitting_(false)
+      allow_splitting_(false),
+      angle_parallel_(false),
+      group_parallel_(false),
+      plane_parallel_(false)
 {
     LogFile << "Constructing a base MoC sweeper" << std::endl;
 
@@ -98,6 +105,40 @@ MoCSweeper::MoCSweeper(const pugi::xml_node &input, const CoreMesh &mesh)
     }
     n_inner_ = int_in;
 
+    // Adaptive inner iterations. When enabled, n_inner is the maximum
+    real_t inner_tol = 0.0;
+    if (!input.attribute("inner_tol").empty()) {
+        inner_tol = input.attribute("inner_tol").as_float(-1.0);
+        if (inner_tol <= 0.0) {
+            throw EXCEPT("Invalid inner iteration tolerance (inner_tol).");
+        }
+    }
+    inner_control_.configure(n_group_, n_inner_, inner_tol);
+
+    // Parse the number of groups to sweep together for Jacobi-style group
+    // iteration
+    int_in = input.attribute("group_block").as_int(8);
+    if (int_in < 1) {
+        throw EXCEPT("Invalid group block size specified (group_block).");
+    }
+    group_block_ = std::min(int_in, n_group_);
+
+    // Determine how to evaluate exponentials
+    if (!input.attribute("exponential").empty()) {
+        std::string in_string = input.attribute("exponential").value();
+        sanitize(in_string);
+        if (in_string == "poly") {
+            exp_ = ExponentialBatch(ExponentialBatch::Method::POLY);
+        } else if (in_string == "table") {
+            exp_ = ExponentialBatch(ExponentialBatch::Method::TABLE);
+        } else if (in_string == "libm") {
+            exp_ = ExponentialBatch(ExponentialBatch::Method::LIBM);
+        } else {
+            throw EXCEPT("Unrecognized exponential option.");
+        }
+        LogFile << "Exponential evaluation: " << in_string << std::endl;
+    }
+
     // Parse the output options
     dump_rays_     = input.attribute("dump_rays").as_bool(false);
     dump_fsr_flux_ = input.attribute("dump_fsr_flux").as_bool(false);
@@ -115,6 +156,31 @@ MoCSweeper::MoCSweeper(const pugi::xml_node &input, const CoreMesh &mesh)
         }
     }
 
+    // Determine the parallel decomposition
+    if (!input.attribute("parallel").empty()) {
+        std::string in_string = input.attribute("parallel").value();
+        sanitize(in_string);
+        if (in_string == "angle") {
+            angle_parallel_ = true;
+            LogFile << "Using angle-parallel MoC sweeps with Jacobi boundary "
+                       "updates"
+                    << std::endl;
+        } else if (in_string == "group") {
+            // Concurrent group blocks each get their own team of threads
+            group_parallel_ = true;
+            LogFile << "Sweeping group blocks concurrently for Jacobi group "
+                       "iteration"
+                    << std::endl;
+        } else if (in_string == "plane") {
+            // Concurrent macroplanes each get their own team of threads
+            plane_parallel_ = true;
+            LogFile << "Sweeping macroplanes concurrently" << std::endl;
+        } else if (in_string == "ray") {
+        } else {
+            throw EXCEPT("Unrecognized parallel decomposition option.");
+        }
+    }
+
     // Parse TL source splitting setting
     allow_splitting_ = input.attribute("tl_splitting").as_bool(false);
     if (allow_splitting_) {
@@ -177,6 +243,9 @@ MoCSweeper::MoCSweeper(const pugi::xml_node &input, const CoreMesh &mesh)
         rayfile << rays_ << std::endl;
     }
 
+    // Partition the rays so that each thread gets a similar amount of work
+    rays_.balance(omp_get_max_threads());
+
     // Replace the angular quadrature with the modularized version
     ang_quad_ = rays_.ang_quad();
 
@@ -199,24 +268,36 @@ void MoCSweeper::sweep(int group)
     flux_1g_.reference(flux_(blitz::Range::all(), group));
 
     // Perform inner iterations
-    for (unsigned int inner = 0; inner < n_inner_; inner++) {
+    unsigned int n_inner = inner_control_.n_inner(group);
+    inner_control_.begin(group, flux_1g_);
+    for (unsigned int inner = 0; inner < n_inner; inner++) {
         // update the self-scattering source
         source_->self_scatter(group, xstr_.xs());
 
         // Perform the stock sweep unless we are on the last outer and have
         // a CoarseData object.
-        if (inner == n_inner_ - 1 && coarse_data_) {
+        if (inner == n_inner - 1 && coarse_data_) {
             // Wipe out the existing currents (only on X- and Y-normal
             // faces)
             coarse_data_->zero_data_radial(group);
 
             moc::Current cw(coarse_data_, &mesh_);
-            this->sweep1g(group, cw);
+            if (plane_parallel_) {
+                this->sweep1g_plane_parallel(group, cw);
+            } else {
+                this->sweep1g(group, cw);
+            }
             coarse_data_->set_has_radial_data(true);
+        } else if (angle_parallel_) {
+            this->sweep1g_angle(group);
+        } else if (plane_parallel_) {
+            moc::NoCurrent cw(coarse_data_, &mesh_);
+            this->sweep1g_plane_parallel(group, cw);
         } else {
             moc::NoCurrent cw(coarse_data_, &mesh_);
             this->sweep1g(group, cw);
         }
+        inner_control_.observe(group, flux_1g_);
     }
 
     timer_.toc();
@@ -224,6 +305,485 @@ void MoCSweeper::sweep(int group)
     return;
 } // sweep( group )
 
+void MoCSweeper::sweep1g_angle(int group)
+{
+    // The rays of different angles cross the same regions, so each thread
+    // tallies into its own copy of the scalar flux for the current plane.
+    // These are reduced after each plane, with each thread summing a
+    // disjoint range of the plane's regions.
+    int max_reg_plane =
+        *std::max_element(nreg_plane_.begin(), nreg_plane_.end());
+    ArrayB2 t_flux_all(omp_get_max_threads(), max_reg_plane);
+    t_flux_all = 0.0;
+
+#pragma omp parallel default(shared)
+    {
+        ArrayB1 e_tau(rays_.max_segments());
+        SegmentBuffer segments(rays_.max_segments());
+        real_t *t_flux = &t_flux_all(omp_get_thread_num(), 0);
+        int n_thread   = omp_get_num_threads();
+
+        int iplane = 0;
+        for (const auto plane_ray_id : macroplane_unique_ids_) {
+            int first_reg      = first_reg_macroplane_[iplane];
+            auto &boundary_in  = boundary_[iplane];
+            auto &boundary_out = boundary_out_[iplane];
+            int n_ang          = rays_[plane_ray_id].size();
+
+// Each thread sweeps whole angles. Angles write to disjoint parts of
+// boundary_out, so there is no need to synchronize until the plane is done.
+#pragma omp for schedule(dynamic, 1)
+            for (int iang = 0; iang < n_ang; iang++) {
+                const auto &packed = rays_.packed(plane_ray_id, iang);
+                const auto &qbar   = source_->get_transport(iang);
+
+                int iang1 = iang;
+                int iang2 = ang_quad_.reverse(iang);
+                Angle ang = ang_quad_[iang];
+
+                const real_t *bc_in_1 =
+                    boundary_in.get_boundary(group, iang1).second;
+                real_t *bc_out_1 = boundary_out.get_boundary(0, iang1).second;
+                const real_t *bc_in_2 =
+                    boundary_in.get_boundary(group, iang2).second;
+                real_t *bc_out_2 = boundary_out.get_boundary(0, iang2).second;
+
+                real_t stheta  = std::sin(ang.theta);
+                real_t rstheta = ang.rsintheta;
+                real_t wt_v_st = ang.weight * rays_.spacing(iang) *
+                                 mesh_.macroplanes()[iplane].height * stheta *
+                                 PI;
+
+                for (int iray = 0; iray < packed.n_rays(); iray++) {
+                    segments.load(packed, iray);
+                    const int nseg               = packed.nseg(iray);
+                    const ray_len_t *seg_len     = segments.len();
+                    const ray_index_t *seg_index = segments.index();
+
+                    int bc1 = packed.bc(iray, 0);
+                    int bc2 = packed.bc(iray, 1);
+
+                    for (int iseg = 0; iseg < nseg; iseg++) {
+                        int ireg    = seg_index[iseg] + first_reg;
+                        e_tau(iseg) = xstr_[ireg] * seg_len[iseg] * rstheta;
+                    }
+                    exp_.one_minus_exp(e_tau.data(), nseg);
+
+                    // Forward direction
+                    real_t psi = bc_in_1[bc1];
+                    for (int iseg = 0; iseg < nseg; iseg++) {
+                        int ireg        = seg_index[iseg] + first_reg;
+                        real_t psi_diff = (psi - qbar[ireg]) * e_tau(iseg);
+                        psi -= psi_diff;
+                        t_flux[seg_index[iseg]] += psi_diff * wt_v_st;
+                    }
+                    bc_out_1[bc2] = psi;
+
+                    // Backward direction
+                    psi = bc_in_2[bc2];
+                    for (int iseg = nseg - 1; iseg >= 0; iseg--) {
+                        int ireg        = seg_index[iseg] + first_reg;
+                        real_t psi_diff = (psi - qbar[ireg]) * e_tau(iseg);
+                        psi -= psi_diff;
+                        t_flux[seg_index[iseg]] += psi_diff * wt_v_st;
+                    }
+                    bc_out_2[bc1] = psi;
+                } // Rays
+            }     // angles
+
+// Reduce the thread-local tallies for this plane
+#pragma omp for
+            for (int i = 0; i < nreg_plane_[iplane]; i++) {
+                real_t sum = 0.0;
+                for (int it = 0; it < n_thread; it++) {
+                    sum += t_flux_all(it, i);
+                    t_flux_all(it, i) = 0.0;
+                }
+                flux_1g_(first_reg + i) = sum;
+            }
+
+            iplane++;
+        } // planes
+
+        // Update the incoming boundary conditions for all planes and angles
+        // at once. Each outgoing angle updates a distinct set of incoming
+        // faces, so these may proceed in parallel.
+        int n_plane = macroplane_unique_ids_.size();
+        int n_ang   = rays_[macroplane_unique_ids_[0]].size();
+#pragma omp for
+        for (int i = 0; i < n_plane * n_ang; i++) {
+            int ip   = i / n_ang;
+            int iang = i % n_ang;
+            boundary_[ip].update(group, iang, boundary_out_[ip]);
+            boundary_[ip].update(group, ang_quad_.reverse(iang),
+                                 boundary_out_[ip]);
+        }
+
+// Scale the scalar flux by the volume and add back the source
+#pragma omp single
+        {
+            auto &qbar = source_->get_transport(0);
+            for (int i = 0; i < (int)n_reg_; i++) {
+                flux_1g_(i) =
+                    flux_1g_(i) / (xstr_[i] * vol_[i]) + qbar[i] * FPI;
+            }
+        } // OMP single
+    }     // OMP Parallel
+
+    return;
+} // sweep1g_angle( group )
+
+void MoCSweeper::sweep_multigroup(const ArrayB2 &source)
+{
+    assert(source_);
+    assert((int)source.extent(0) == n_reg_);
+    assert((int)source.extent(1) == n_group_);
+
+    // Source splitting alters the cross sections one group at a time, which
+    // the batched kernel does not support
+    if (allow_splitting_) {
+        TransportSweeper::sweep_multigroup(source);
+        return;
+    }
+
+    timer_.tic();
+    timer_sweep_.tic();
+
+    // Decide how many blocks to sweep at once, and how many threads each
+    // gets. Without group parallelism, one block gets all of the threads.
+    int n_block      = (n_group_ + group_block_ - 1) / group_block_;
+    int n_concurrent = 1;
+    int n_thread     = omp_get_max_threads();
+    if (group_parallel_) {
+        n_concurrent = std::min(n_block, n_thread);
+        n_thread     = std::max(1, n_thread / n_concurrent);
+    }
+
+    // Each concurrent block needs its own workspace
+    if ((int)boundary_out_mg_.size() < n_concurrent * mesh_.nz()) {
+        boundary_out_mg_.clear();
+        boundary_out_mg_.reserve(n_concurrent * mesh_.nz());
+        for (int i = 0; i < n_concurrent * mesh_.nz(); i++) {
+            boundary_out_mg_.emplace_back(group_block_, ang_quad_,
+                                          mesh_.boundary(),
+                                          bc_size_helper(rays_));
+        }
+        xstr_mg_.resize(n_concurrent * n_reg_ * group_block_);
+        qbar_mg_.resize(n_concurrent * n_reg_ * group_block_);
+    }
+
+    // Concurrent blocks are swept by nested teams of threads
+    ScopedActiveLevels levels(group_parallel_ ? 2 : 1);
+
+    for (int first_block = 0; first_block < n_block;
+         first_block += n_concurrent) {
+        int n_slot = std::min(n_concurrent, n_block - first_block);
+        std::vector<int> first_group(n_slot);
+        std::vector<int> ngb(n_slot);
+
+        // The groups in a block are swept together, so the block gets as
+        // many inner iterations as its most demanding group
+        std::vector<unsigned int> n_inner(n_slot, 0);
+        unsigned int max_inner = 0;
+        for (int slot = 0; slot < n_slot; slot++) {
+            first_group[slot] = (first_block + slot) * group_block_;
+            ngb[slot] = std::min(group_block_, n_group_ - first_group[slot]);
+            for (int group = first_group[slot];
+                 group < first_group[slot] + ngb[slot]; group++) {
+                n_inner[slot] =
+                    std::max(n_inner[slot], inner_control_.n_inner(group));
+                inner_control_.begin(group, flux_(blitz::Range::all(), group));
+            }
+            max_inner = std::max(max_inner, n_inner[slot]);
+        }
+
+        for (unsigned int inner = 0; inner < max_inner; inner++) {
+            // Gather the cross sections and sources for the blocks that are
+            // still iterating. The last inner iteration of each block needs
+            // currents for CMFD, so those blocks get their own current worker.
+            std::vector<int> active;
+            std::vector<std::unique_ptr<moc::GroupBlockCurrent>> cw(n_slot);
+            for (int slot = 0; slot < n_slot; slot++) {
+                if (inner >= n_inner[slot]) {
+                    continue;
+                }
+                active.push_back(slot);
+
+                if (inner == n_inner[slot] - 1 && coarse_data_) {
+                    for (int group = first_group[slot];
+                         group < first_group[slot] + ngb[slot]; group++) {
+                        coarse_data_->zero_data_radial(group);
+                    }
+                    cw[slot].reset(new moc::GroupBlockCurrent(
+                        coarse_data_, &mesh_, first_group[slot], ngb[slot],
+                        n_thread));
+                }
+
+                int off = slot * n_reg_ * group_block_;
+                for (int ig = 0; ig < ngb[slot]; ig++) {
+                    int group = first_group[slot] + ig;
+                    for (int i = 0; i < n_reg_; i++) {
+                        (*source_)[i] = source(i, group);
+                    }
+                    xstr_.expand(group);
+                    source_->self_scatter(group, xstr_.xs());
+                    const auto &qbar = source_->get_transport(0);
+                    for (int i = 0; i < n_reg_; i++) {
+                        xstr_mg_[off + i * ngb[slot] + ig] = xstr_[i];
+                        qbar_mg_[off + i * ngb[slot] + ig] = qbar[i];
+                    }
+                }
+            }
+
+            // Sweep the gathered blocks. These touch disjoint groups of
+            // flux_, boundary_ and the coarse data, and their own workspaces,
+            // so they may proceed concurrently. Exceptions may not leave the
+            // parallel region, so the first one is stashed and re-thrown
+            // afterwards.
+            int n_active                   = active.size();
+            std::exception_ptr sweep_error = nullptr;
+#pragma omp parallel for num_threads(std::max(n_active, 1)) \
+    schedule(static, 1) if (n_active > 1)
+            for (int i = 0; i < n_active; i++) {
+                int slot = active[i];
+                try {
+                    if (cw[slot]) {
+                        this->sweep_group_block<true>(first_group[slot],
+                                                      ngb[slot], slot,
+                                                      n_thread, cw[slot].get());
+                    } else {
+                        this->sweep_group_block<false>(first_group[slot],
+                                                       ngb[slot], slot,
+                                                       n_thread, nullptr);
+                    }
+                } catch (...) {
+#pragma omp critical
+                    if (!sweep_error) {
+                        sweep_error = std::current_exception();
+                    }
+                }
+            }
+            if (sweep_error) {
+                std::rethrow_exception(sweep_error);
+            }
+
+            for (int slot : active) {
+                for (int group = first_group[slot];
+                     group < first_group[slot] + ngb[slot]; group++) {
+                    inner_control_.observe(group,
+                                           flux_(blitz::Range::all(), group));
+                }
+                if (cw[slot]) {
+                    cw[slot]->post_sweep();
+                    coarse_data_->set_has_radial_data(true);
+                }
+            }
+        }
+    }
+
+    timer_.toc();
+    timer_sweep_.toc();
+    return;
+} // sweep_multigroup( source )
+
+template <bool Currents>
+void MoCSweeper::sweep_group_block(int first_group, int ngb, int slot,
+                                   int n_thread, moc::GroupBlockCurrent *cw)
+{
+#pragma omp parallel default(shared) num_threads(n_thread)
+    {
+        // Exponentials for each segment/group in the block, group-innermost.
+        // The angular flux is only kept along the whole ray if we need it
+        // for the currents.
+        int n_psi = Currents ? rays_.max_segments() + 1 : 1;
+        VecF e_tau(rays_.max_segments() * ngb);
+        SegmentBuffer segments(rays_.max_segments());
+        VecF psi1(n_psi * ngb);
+        VecF psi2(n_psi * ngb);
+        int n_team = omp_get_num_threads();
+
+        std::vector<const real_t *> bc_in_1(ngb);
+        std::vector<const real_t *> bc_in_2(ngb);
+        std::vector<real_t *> bc_out_1(ngb);
+        std::vector<real_t *> bc_out_2(ngb);
+
+        const real_t *xstr = xstr_mg_.data() + slot * n_reg_ * group_block_;
+        const real_t *qbar = qbar_mg_.data() + slot * n_reg_ * group_block_;
+
+        int iplane = 0;
+        for (const auto plane_ray_id : macroplane_unique_ids_) {
+            int first_reg      = first_reg_macroplane_[iplane];
+            auto &boundary_in  = boundary_[iplane];
+            auto &boundary_out =
+                boundary_out_mg_[slot * mesh_.nz() + iplane];
+            const auto &plane_rays = rays_[plane_ray_id];
+            int n_ang              = plane_rays.size();
+            if (Currents) {
+                cw->set_plane(iplane);
+            }
+
+#pragma omp for
+            for (int i = 0; i < nreg_plane_[iplane]; i++) {
+                for (int ig = 0; ig < ngb; ig++) {
+                    flux_(first_reg + i, first_group + ig) = 0.0;
+                }
+            }
+            for (int iang = 0; iang < n_ang; iang++) {
+                const auto &packed = rays_.packed(plane_ray_id, iang);
+
+                int iang1 = iang;
+                int iang2 = ang_quad_.reverse(iang);
+                Angle ang = ang_quad_[iang];
+
+                for (int ig = 0; ig < ngb; ig++) {
+                    int group = first_group + ig;
+                    bc_in_1[ig] =
+                        boundary_in.get_boundary(group, iang1).second;
+                    bc_in_2[ig] =
+                        boundary_in.get_boundary(group, iang2).second;
+                    bc_out_1[ig] = boundary_out.get_boundary(ig, iang1).second;
+                    bc_out_2[ig] = boundary_out.get_boundary(ig, iang2).second;
+                }
+
+                if (Currents) {
+                    cw->set_angle(ang, rays_.spacing(iang));
+                }
+
+                real_t stheta  = std::sin(ang.theta);
+                real_t rstheta = ang.rsintheta;
+                real_t wt_v_st = ang.weight * rays_.spacing(iang) *
+                                 mesh_.macroplanes()[iplane].height * stheta *
+                                 PI;
+
+                // Each thread sweeps whole bins of rays, a color at a time.
+                // See sweep_macroplanes()
+                for (int icolor = 0; icolor < packed.n_colors(); icolor++) {
+                    for (int ibin = packed.color_begin(icolor) +
+                                    omp_get_thread_num();
+                         ibin < packed.color_end(icolor); ibin += n_team) {
+                        for (int ir = packed.bin_begin(ibin);
+                             ir < packed.bin_end(ibin); ir++) {
+                            int iray = packed.ray_order(ir);
+
+                            segments.load(packed, iray);
+                            const int nseg               = packed.nseg(iray);
+                            const ray_len_t *seg_len     = segments.len();
+                            const ray_index_t *seg_index = segments.index();
+
+                            int bc1 = packed.bc(iray, 0);
+                            int bc2 = packed.bc(iray, 1);
+
+                            // Compute exponentials
+                            for (int iseg = 0; iseg < nseg; iseg++) {
+                                int ireg         = seg_index[iseg] + first_reg;
+                                real_t len       = seg_len[iseg] * rstheta;
+                                const real_t *xs = &xstr[ireg * ngb];
+                                real_t *et       = &e_tau[iseg * ngb];
+                                for (int ig = 0; ig < ngb; ig++) {
+                                    et[ig] = xs[ig] * len;
+                                }
+                            }
+                            exp_.one_minus_exp(e_tau.data(), nseg * ngb);
+
+                            // Forward direction. Without currents, psi_in and
+                            // psi_out are the same storage.
+                            real_t *psi = psi1.data();
+                            for (int ig = 0; ig < ngb; ig++) {
+                                psi[ig] = bc_in_1[ig][bc1];
+                            }
+                            for (int iseg = 0; iseg < nseg; iseg++) {
+                                int ireg         = seg_index[iseg] + first_reg;
+                                const real_t *q  = &qbar[ireg * ngb];
+                                const real_t *et = &e_tau[iseg * ngb];
+                                real_t *flux     = &flux_(ireg, first_group);
+                                real_t *psi_out  = Currents ? psi + ngb : psi;
+                                for (int ig = 0; ig < ngb; ig++) {
+                                    real_t psi_diff =
+                                        (psi[ig] - q[ig]) * et[ig];
+                                    psi_out[ig] = psi[ig] - psi_diff;
+                                    flux[ig] += psi_diff * wt_v_st;
+                                }
+                                psi = psi_out;
+                            }
+                            for (int ig = 0; ig < ngb; ig++) {
+                                bc_out_1[ig][bc2] = psi[ig];
+                            }
+
+                            // Backward direction
+                            psi = Currents ? &psi2[nseg * ngb] : psi2.data();
+                            for (int ig = 0; ig < ngb; ig++) {
+                                psi[ig] = bc_in_2[ig][bc2];
+                            }
+                            for (int iseg = nseg - 1; iseg >= 0; iseg--) {
+                                int ireg         = seg_index[iseg] + first_reg;
+                                const real_t *q  = &qbar[ireg * ngb];
+                                const real_t *et = &e_tau[iseg * ngb];
+                                real_t *flux     = &flux_(ireg, first_group);
+                                real_t *psi_out  = Currents ? psi - ngb : psi;
+                                for (int ig = 0; ig < ngb; ig++) {
+                                    real_t psi_diff =
+                                        (psi[ig] - q[ig]) * et[ig];
+                                    psi_out[ig] = psi[ig] - psi_diff;
+                                    flux[ig] += psi_diff * wt_v_st;
+                                }
+                                psi = psi_out;
+                            }
+                            for (int ig = 0; ig < ngb; ig++) {
+                                bc_out_2[ig][bc1] = psi[ig];
+                            }
+
+                            if (Currents) {
+                                cw->post_ray(psi1.data(), psi2.data(),
+                                             plane_rays[iang][iray]);
+                            }
+                        } // Rays
+                    } // Bins
+#pragma omp barrier
+                } // Colors
+
+                if (gauss_seidel_boundary_)
+#pragma omp single
+                {
+                    for (int ig = 0; ig < ngb; ig++) {
+                        boundary_in.update(first_group + ig, iang1,
+                                           boundary_out, ig);
+                        boundary_in.update(first_group + ig, iang2,
+                                           boundary_out, ig);
+                    }
+                }
+            } // angles
+            if (!gauss_seidel_boundary_)
+#pragma omp single
+            {
+                for (int ig = 0; ig < ngb; ig++) {
+                    boundary_in.update(first_group + ig, boundary_out, ig);
+                }
+            }
+
+            if (Currents) {
+                cw->post_plane();
+            }
+
+            iplane++;
+        } // planes
+
+// Scale the scalar flux by the volume and add back the source
+#pragma omp single
+        {
+            for (int i = 0; i < (int)n_reg_; i++) {
+                for (int ig = 0; ig < ngb; ig++) {
+                    int j = i * ngb + ig;
+                    flux_(i, first_group + ig) =
+                        flux_(i, first_group + ig) / (xstr[j] * vol_[i]) +
+                        qbar[j] * FPI;
+                }
+            }
+        } // OMP single
+    }     // OMP Parallel
+
+    return;
+} // sweep_group_block( first_group, ngb )
+
 /**
  * For now, this doesn't do anything remotely intelligent about the initial
  * guess for the scalar and angular flux values and just sets them to unity
@@ -252,6 +812,33 @@ void MoCSweeper::initialize()
     return;
 } // initialize()
 
+int MoCSweeper::n_boundary_values() const
+{
+    int n = 0;
+    for (const auto &boundary : boundary_) {
+        n += boundary.size();
+    }
+    return n;
+}
+
+void MoCSweeper::get_boundary_values(real_t *out) const
+{
+    for (const auto &boundary : boundary_) {
+        boundary.copy_all(out);
+        out += boundary.size();
+    }
+    return;
+}
+
+void MoCSweeper::set_boundary_values(const real_t *in)
+{
+    for (auto &boundary : boundary_) {
+        boundary.set_all(in);
+        in += boundary.size();
+    }
+    return;
+}
+
 void MoCSweeper::update_incoming_flux()
 {
     assert(coarse_data_);
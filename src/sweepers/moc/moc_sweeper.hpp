@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <exception>
 #include "util/omp_guard.h"
 #include "util/pugifwd.hpp"
 #include "util/timers.hpp"
@@ -33,6 +35,8 @@
 
 namespace mocc {
 namespace moc {
+class GroupBlockCurrent;
+
 class MoCSweeper : public TransportSweeper {
 public:
     MoCSweeper(const pugi::xml_node &input, const CoreMesh &mesh);
@@ -43,6 +47,22 @@ public:
 
     virtual void sweep(int group) override;
 
+    /**
+     * \copybrief TransportSweeper::sweep_multigroup()
+     *
+     * Groups are swept together in blocks of \c group_block, so that each
+     * ray is traversed once for all groups in a block. Segment data are then
+     * loaded once per block rather than once per group, and the innermost
+     * loops run over contiguous groups. When currents are needed for CMFD,
+     * the last inner iteration of each block tallies them with its own \ref
+     * moc::GroupBlockCurrent.
+     *
+     * With \c parallel="group", several blocks are swept at once, each by
+     * its own nested team of threads. This exposes more parallelism than
+     * the rays alone provide for small problems.
+     */
+    virtual void sweep_multigroup(const ArrayB2 &source) override;
+
     void initialize() override final;
 
     /**
@@ -80,6 +100,23 @@ public:
      */
     void update_incoming_flux() override final;
 
+    /**
+     * \brief \copybrief TransportSweeper::n_boundary_values()
+     */
+    int n_boundary_values() const override final;
+
+    /**
+     * \brief \copybrief TransportSweeper::get_boundary_values()
+     *
+     * The values for each plane are stored one after another.
+     */
+    void get_boundary_values(real_t *out) const override final;
+
+    /**
+     * \brief \copybrief TransportSweeper::set_boundary_values()
+     */
+    void set_boundary_values(const real_t *in) override final;
+
     /**
      * \copybrief TransportSweeper::create_source()
      *
@@ -134,6 +171,10 @@ protected:
     std::vector<BoundaryCondition> boundary_;
     // One-group, outgoing boundary flux
     std::vector<BoundaryCondition> boundary_out_;
+    // Outgoing boundary flux for a block of groups, used by the group-batched
+    // sweep. One for each plane of each concurrently-swept block, indexed by
+    // (block slot * nz + plane). Only allocated if needed
+    std::vector<BoundaryCondition> boundary_out_mg_;
 
     // Array of one group transport cross sections, including transverse
     // leakage splitting, if necessary
@@ -170,18 +211,37 @@ protected:
     // Number of inner iterations per group sweep
     unsigned int n_inner_;
 
+    // Number of groups to sweep together in sweep_multigroup()
+    int group_block_;
+
+    // Transport cross sections and transport sources for each concurrently
+    // swept block of groups, stored group-innermost, (slot, region, group in
+    // block)
+    VecF xstr_mg_;
+    VecF qbar_mg_;
+
     // Boundary condition enumeration
     std::array<Boundary, 6> bc_type_;
 
-    // Exponential table
-    Exponential_Linear<10000> exp_;
-    //Exponential exp_;
+    // Exponential evaluator. Defaults to the vectorizable polynomial
+    ExponentialBatch exp_;
 
     bool dump_rays_;
     bool dump_fsr_flux_;
     bool gauss_seidel_boundary_;
     bool allow_splitting_;
 
+    // Whether to parallelize sweeps over angles rather than rays. This
+    // implies Jacobi boundary updates
+    bool angle_parallel_;
+
+    // Whether to sweep several group blocks at once in sweep_multigroup()
+    bool group_parallel_;
+
+    // Whether to sweep macroplanes concurrently, each with its own team of
+    // threads. See sweep1g_plane_parallel()
+    bool plane_parallel_;
+
     // Methods
     /**
      * \brief Return the MoC plane corresponding to the passed axial index
@@ -195,6 +255,39 @@ protected:
 
 #include "moc_sweeper_kernel.inc.hpp"
 
+    /**
+     * \brief Perform an MoC sweep, with threads owning whole angles
+     *
+     * This is an alternative to \ref sweep1g() for when no currents are
+     * needed. Rather than splitting the rays for each angle among threads,
+     * each thread sweeps entire angles for a plane, writing to its own part
+     * of \ref boundary_out_. The incoming boundary conditions are updated
+     * once, in parallel, at the end of the sweep, so the only
+     * synchronization is at the end of each plane. This trades the
+     * Gauss-Seidel boundary update for much less synchronization, which
+     * pays off for small problems on many threads.
+     */
+    void sweep1g_angle(int group);
+
+    /**
+     * \brief Perform an MoC sweep over a block of groups at once
+     *
+     * \param first_group the first group in the block
+     * \param n_group_block the number of groups in the block
+     * \param slot the block's slot in the workspaces
+     * \param n_thread the number of threads to sweep the block with
+     * \param cw the current worker for the block. Only used if \p
+     * Currents is true.
+     *
+     * This expects that \ref xstr_mg_ and \ref qbar_mg_ have been filled
+     * for the block's slot. When \p Currents is true, the angular flux is
+     * kept along the length of each ray and passed to \p cw, which tallies
+     * the currents for all groups in the block.
+     */
+    template <bool Currents>
+    void sweep_group_block(int first_group, int n_group_block, int slot,
+                           int n_thread, moc::GroupBlockCurrent *cw);
+
     template <class Function> void update_incoming_generic(Function f)
     {
         // There are probably more efficient ways to do this, but for now, just
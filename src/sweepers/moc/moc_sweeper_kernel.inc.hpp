@@ -35,28 +35,112 @@
  */
 template <typename CurrentWorker> void sweep1g(int group, CurrentWorker &cw)
 {
-    flux_1g_ = 0.0;
+    cw.set_group(group);
+
+    this->sweep_macroplanes(group, cw, 0, macroplane_unique_ids_.size(),
+                            omp_get_max_threads());
 
+    this->finish_sweep1g(cw);
+
+    return;
+} // sweep1g
+
+/**
+ * \brief Perform an MoC sweep, sweeping macroplanes concurrently
+ *
+ * This does the same thing as \ref sweep1g(), but rather than having all
+ * threads share the rays of each macroplane in turn, the macroplanes are
+ * distributed among teams of threads, and each team shares the rays of its
+ * macroplane. The macroplanes have their own boundary conditions and
+ * disjoint ranges of flat source regions, so the only synchronization
+ * between teams is at the end of the sweep. This needs nested parallelism.
+ *
+ * Each macroplane is swept with its own copy of \p cw, so this may only be
+ * used with workers whose copies can do their work concurrently, such as
+ * \ref moc::NoCurrent, \ref moc::Current and \ref
+ * cmdo::CurrentCorrections.
+ */
+template <typename CurrentWorker>
+void sweep1g_plane_parallel(int group, CurrentWorker &cw)
+{
     cw.set_group(group);
 
-#pragma omp parallel default(shared)
+    int n_plane  = macroplane_unique_ids_.size();
+    int n_team   = std::min(n_plane, omp_get_max_threads());
+    int n_thread = std::max(1, omp_get_max_threads() / n_team);
+
+    // Each team sweeps its macroplane with a nested parallel region
+    ScopedActiveLevels levels(2);
+
+    // Exceptions may not leave the parallel region, so the first one is
+    // stashed and re-thrown afterwards.
+    std::exception_ptr sweep_error = nullptr;
+#pragma omp parallel for num_threads(n_team) schedule(dynamic, 1) \
+    if (n_team > 1)
+    for (int iplane = 0; iplane < n_plane; iplane++) {
+        try {
+            CurrentWorker plane_cw(cw);
+            this->sweep_macroplanes(group, plane_cw, iplane, iplane + 1,
+                                    n_thread);
+        } catch (...) {
+#pragma omp critical
+            if (!sweep_error) {
+                sweep_error = std::current_exception();
+            }
+        }
+    }
+    if (sweep_error) {
+        std::rethrow_exception(sweep_error);
+    }
+
+    this->finish_sweep1g(cw);
+
+    return;
+} // sweep1g_plane_parallel
+
+/**
+ * \brief Sweep a range of macroplanes for a single group with a team of
+ * threads
+ *
+ * \param group the group to sweep
+ * \param cw the current worker
+ * \param first_plane the first macroplane to sweep
+ * \param last_plane one past the last macroplane to sweep
+ * \param n_thread the number of threads to sweep with
+ *
+ * The flux is tallied into \ref flux_1g_ without being scaled. See \ref
+ * finish_sweep1g().
+ */
+template <typename CurrentWorker>
+void sweep_macroplanes(int group, CurrentWorker &cw, int first_plane,
+                       int last_plane, int n_thread)
+{
+#pragma omp parallel default(shared) num_threads(n_thread)
     {
         ArrayB1 e_tau(rays_.max_segments());
+        SegmentBuffer segments(rays_.max_segments());
         typename CurrentWorker::FluxStore psi1(rays_.max_segments() + 1);
         typename CurrentWorker::FluxStore psi2(rays_.max_segments() + 1);
-        ArrayB1 t_flux(n_reg_);
-        t_flux = 0.0;
+        int n_team = omp_get_num_threads();
 
-        int iplane = 0;
-        for (const auto plane_ray_id : macroplane_unique_ids_) {
+        for (int iplane = first_plane; iplane < last_plane; iplane++) {
+            const auto plane_ray_id = macroplane_unique_ids_[iplane];
             int first_reg      = first_reg_macroplane_[iplane];
             auto &boundary_in  = boundary_[iplane];
             auto &boundary_out = boundary_out_[iplane];
             cw.set_plane(iplane);
+
+#pragma omp for
+            for (int i = 0; i < nreg_plane_[iplane]; i++) {
+                flux_1g_(first_reg + i) = 0.0;
+            }
             const auto &plane_rays = rays_[plane_ray_id];
             int iang               = 0;
             // Angles
             for (const auto &ang_rays : plane_rays) {
+                // Packed segment data for this angle
+                const auto &packed = rays_.packed(plane_ray_id, iang);
+
                 // Get the source for this angle
                 auto &qbar = source_->get_transport(iang);
 
@@ -81,56 +165,78 @@ template <typename CurrentWorker> void sweep1g(int group, CurrentWorker &cw)
                                  mesh_.macroplanes()[iplane].height * stheta *
                                  PI;
 
-#pragma omp for schedule(static, 1)
-                for (int iray = 0; iray < (int)ang_rays.size(); iray++) {
-                    const auto &ray = ang_rays[iray];
-
-                    int bc1 = ray.bc(0);
-                    int bc2 = ray.bc(1);
-                    assert(bc1 < boundary_in.get_boundary(group, iang1).first);
-                    assert(bc2 < boundary_in.get_boundary(group, iang1).first);
-
-                    // Compute exponentials
-                    for (int iseg = 0; iseg < ray.nseg(); iseg++) {
-                        int ireg    = ray.seg_index(iseg) + first_reg;
-                        e_tau(iseg) = 1.0 -
-                                      exp_.exp(-xstr_[ireg] *
-                                               ray.seg_len(iseg) * rstheta);
-                    }
-
-                    // Forward direction
-                    // Initialize from bc
-                    psi1[0] = bc_in_1[bc1];
-
-                    // Propagate through core geometry
-                    for (int iseg = 0; iseg < ray.nseg(); iseg++) {
-                        int ireg = ray.seg_index(iseg) + first_reg;
-                        real_t psi_diff =
-                            (psi1[iseg] - qbar[ireg]) * e_tau(iseg);
-                        psi1[iseg + 1] = psi1[iseg] - psi_diff;
-                        t_flux(ireg) += psi_diff * wt_v_st;
-                    }
-                    // Store boundary condition
-                    bc_out_1[bc2] = psi1[ray.nseg()];
-
-                    // Backward direction
-                    // Initialize from bc
-                    psi2[ray.nseg()] = bc_in_2[bc2];
-
-                    // Propagate through core geometry
-                    for (int iseg = ray.nseg() - 1; iseg >= 0; iseg--) {
-                        int ireg = ray.seg_index(iseg) + first_reg;
-                        real_t psi_diff =
-                            (psi2[iseg + 1] - qbar[ireg]) * e_tau(iseg);
-                        psi2[iseg] = psi2[iseg + 1] - psi_diff;
-                        t_flux(ireg) += psi_diff * wt_v_st;
-                    }
-                    // Store boundary condition
-                    bc_out_2[bc1] = psi2[0];
-
-                    // Stash currents
-                    cw.post_ray(psi1, psi2, e_tau, ray, first_reg);
-                } // Rays
+                // Each thread sweeps whole bins of rays. The bins are
+                // balanced ahead of time by RayData::balance(), and the bins
+                // of a color never cross the same region, so each thread may
+                // tally straight into flux_1g_.
+                for (int icolor = 0; icolor < packed.n_colors(); icolor++) {
+                    for (int ibin = packed.color_begin(icolor) +
+                                    omp_get_thread_num();
+                         ibin < packed.color_end(icolor); ibin += n_team) {
+                        for (int ir = packed.bin_begin(ibin);
+                             ir < packed.bin_end(ibin); ir++) {
+                            int iray = packed.ray_order(ir);
+
+                            const auto &ray = ang_rays[iray];
+
+                            segments.load(packed, iray);
+                            const int nseg               = packed.nseg(iray);
+                            const ray_len_t *seg_len     = segments.len();
+                            const ray_index_t *seg_index = segments.index();
+
+                            int bc1 = packed.bc(iray, 0);
+                            int bc2 = packed.bc(iray, 1);
+                            assert(bc1 < boundary_in.get_boundary(group, iang1)
+                                             .first);
+                            assert(bc2 < boundary_in.get_boundary(group, iang1)
+                                             .first);
+
+                            // Compute exponentials. Store the optical
+                            // thicknesses first, so that the exponentials are
+                            // evaluated for the whole ray at once
+                            for (int iseg = 0; iseg < nseg; iseg++) {
+                                int ireg = seg_index[iseg] + first_reg;
+                                e_tau(iseg) =
+                                    xstr_[ireg] * seg_len[iseg] * rstheta;
+                            }
+                            exp_.one_minus_exp(e_tau.data(), nseg);
+
+                            // Forward direction
+                            // Initialize from bc
+                            psi1[0] = bc_in_1[bc1];
+
+                            // Propagate through core geometry
+                            for (int iseg = 0; iseg < nseg; iseg++) {
+                                int ireg = seg_index[iseg] + first_reg;
+                                real_t psi_diff =
+                                    (psi1[iseg] - qbar[ireg]) * e_tau(iseg);
+                                psi1[iseg + 1] = psi1[iseg] - psi_diff;
+                                flux_1g_(ireg) += psi_diff * wt_v_st;
+                            }
+                            // Store boundary condition
+                            bc_out_1[bc2] = psi1[nseg];
+
+                            // Backward direction
+                            // Initialize from bc
+                            psi2[nseg] = bc_in_2[bc2];
+
+                            // Propagate through core geometry
+                            for (int iseg = nseg - 1; iseg >= 0; iseg--) {
+                                int ireg = seg_index[iseg] + first_reg;
+                                real_t psi_diff =
+                                    (psi2[iseg + 1] - qbar[ireg]) * e_tau(iseg);
+                                psi2[iseg] = psi2[iseg + 1] - psi_diff;
+                                flux_1g_(ireg) += psi_diff * wt_v_st;
+                            }
+                            // Store boundary condition
+                            bc_out_2[bc1] = psi2[0];
+
+                            // Stash currents
+                            cw.post_ray(psi1, psi2, e_tau, ray, first_reg);
+                        } // Rays
+                    } // Bins
+#pragma omp barrier
+                } // Colors
                 cw.post_angle(iang);
 
                 // Try tasks?
@@ -148,33 +254,25 @@ template <typename CurrentWorker> void sweep1g(int group, CurrentWorker &cw)
             {
                 boundary_in.update(group, boundary_out);
             }
-
-            iplane++;
         } // planes
+    } // OMP Parallel
 
-#pragma omp barrier
-#pragma omp critical
-        {
-            /// \todo make an array operation after refactoring out valarray
-            for (int i = 0; i < (int)n_reg_; i++) {
-                flux_1g_(i) += t_flux(i);
-            }
-        }
-#pragma omp barrier
-// Scale the scalar flux by the volume and add back the source
-#pragma omp single
-        {
-            // \todo this is not correct for angle-dependent sources!
-            auto &qbar = source_->get_transport(0);
-            for (int i = 0; i < (int)n_reg_; i++) {
-                flux_1g_(i) =
-                    flux_1g_(i) / (xstr_[i] * vol_[i]) + qbar[i] * FPI;
-            }
-        } // OMP single
+    return;
+} // sweep_macroplanes
 
-        cw.post_sweep();
+/**
+ * \brief Scale the flux tallied by \ref sweep_macroplanes() by the volume,
+ * add back the source, and let the current worker finish up
+ */
+template <typename CurrentWorker> void finish_sweep1g(CurrentWorker &cw)
+{
+    // \todo this is not correct for angle-dependent sources!
+    auto &qbar = source_->get_transport(0);
+    for (int i = 0; i < (int)n_reg_; i++) {
+        flux_1g_(i) = flux_1g_(i) / (xstr_[i] * vol_[i]) + qbar[i] * FPI;
+    }
 
-    } // OMP Parallel
+    cw.post_sweep();
 
     return;
-} // sweep1g
+} // finish_sweep1g
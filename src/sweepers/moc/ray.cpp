@@ -16,7 +16,10 @@
 
 #include "ray.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <iostream>
+#include "util/binary_io.hpp"
 
 // Assuming that p1 is the "origin" return the quadrant of the angle formed by
 // p1. Since we assume that p1 is below p2 in y, only octants 1 or 2 can be
@@ -64,6 +67,8 @@ Ray::Ray(Point2 p1, Point2 p2, std::array<int, 2> bc, int iplane,
     // Trace the fine ray. We need to keep track of the number of segments
     // in each pin crossing for the coarse ray data.
     VecI cm_nseg;
+    VecF seg_len;
+    VecI seg_index;
     auto p_prev = cps.front();
     for (auto pi = ps.begin() + 1; pi != ps.end(); ++pi) {
         // Use the midpoint of the pin entry and exit points to locate the
@@ -75,12 +80,13 @@ Ray::Ray(Point2 p1, Point2 p2, std::array<int, 2> bc, int iplane,
         const PinMeshTuple pmt = mesh.get_pinmesh(pin_p, iplane, first_reg);
 
         int nseg = pmt.pm->trace(p_prev - pin_p, *pi - pin_p, first_reg,
-                                 seg_len_, seg_index_);
+                                 seg_len, seg_index);
 
         cm_nseg.push_back(nseg);
 
         p_prev = *pi;
     }
+    pin_nseg_ = cm_nseg;
 
     // Figure out the coarse mesh data for the ray. Start with the starting
     // cells and surfaces.
@@ -170,7 +176,160 @@ Ray::Ray(Point2 p1, Point2 p2, std::array<int, 2> bc, int iplane,
         cm_data_.push_back(rcd);
     }
 
-    nseg_ = seg_len_.size();
+    // Store the segments, possibly narrowing them to the compact types
+    seg_len_own_.assign(seg_len.begin(), seg_len.end());
+    seg_index_own_.assign(seg_index.begin(), seg_index.end());
+
+    nseg_      = seg_len_own_.size();
+    seg_len_   = seg_len_own_.data();
+    seg_index_ = seg_index_own_.data();
+
+    return;
+}
+
+Ray::Ray(std::istream &is, uint64_t max_bytes)
+    : cm_surf_fw_(0),
+      cm_surf_bw_(0),
+      cm_cell_fw_(0),
+      cm_cell_bw_(0),
+      seg_len_(nullptr),
+      seg_index_(nullptr),
+      nseg_(0),
+      bc_({{0, 0}})
+{
+    // Stop at the first failed read. The caller must check the stream
+    // before using the Ray; on failure it is left empty, but in a state that
+    // is safe to destroy.
+    cm_surf_fw_ = read_binary<uint64_t>(is);
+    cm_surf_bw_ = read_binary<uint64_t>(is);
+    cm_cell_fw_ = read_binary<uint64_t>(is);
+    cm_cell_bw_ = read_binary<uint64_t>(is);
+    bc_[0]      = read_binary<int32_t>(is);
+    bc_[1]      = read_binary<int32_t>(is);
+    p1_.x       = read_binary<real_t>(is);
+    p1_.y       = read_binary<real_t>(is);
+    p1_.ok      = true;
+    p2_.x       = read_binary<real_t>(is);
+    p2_.y       = read_binary<real_t>(is);
+    p2_.ok      = true;
+    if (!is) {
+        return;
+    }
+
+    read_binary(is, seg_len_own_, max_bytes);
+    if (!is) {
+        return;
+    }
+    read_binary(is, seg_index_own_, max_bytes);
+    if (!is || seg_index_own_.size() != seg_len_own_.size()) {
+        is.setstate(std::ios::failbit);
+        seg_len_own_.clear();
+        seg_index_own_.clear();
+        return;
+    }
+    read_binary(is, pin_nseg_, max_bytes);
+    if (!is) {
+        return;
+    }
+
+    VecI cm_data;
+    read_binary(is, cm_data, max_bytes);
+    if (!is || (cm_data.size() % 4 != 0)) {
+        is.setstate(std::ios::failbit);
+        return;
+    }
+    cm_data_.reserve(cm_data.size() / 4);
+    for (size_t i = 0; i < cm_data.size(); i += 4) {
+        RayCoarseData rcd;
+        rcd.fw      = (Surface)cm_data[i + 0];
+        rcd.bw      = (Surface)cm_data[i + 1];
+        rcd.nseg_fw = cm_data[i + 2];
+        rcd.nseg_bw = cm_data[i + 3];
+        cm_data_.push_back(rcd);
+    }
+
+    nseg_      = seg_len_own_.size();
+    seg_len_   = seg_len_own_.data();
+    seg_index_ = seg_index_own_.data();
+
+    return;
+}
+
+void Ray::write(std::ostream &os) const
+{
+    write_binary(os, (uint64_t)cm_surf_fw_);
+    write_binary(os, (uint64_t)cm_surf_bw_);
+    write_binary(os, (uint64_t)cm_cell_fw_);
+    write_binary(os, (uint64_t)cm_cell_bw_);
+    write_binary(os, (int32_t)bc_[0]);
+    write_binary(os, (int32_t)bc_[1]);
+    write_binary(os, (real_t)p1_.x);
+    write_binary(os, (real_t)p1_.y);
+    write_binary(os, (real_t)p2_.x);
+    write_binary(os, (real_t)p2_.y);
+
+    write_binary(os, std::vector<ray_len_t>(seg_len_, seg_len_ + nseg_));
+    write_binary(os,
+                 std::vector<ray_index_t>(seg_index_, seg_index_ + nseg_));
+    write_binary(os, pin_nseg_);
+
+    VecI cm_data;
+    cm_data.reserve(cm_data_.size() * 4);
+    for (const auto &rcd : cm_data_) {
+        cm_data.push_back((int)rcd.fw);
+        cm_data.push_back((int)rcd.bw);
+        cm_data.push_back(rcd.nseg_fw);
+        cm_data.push_back(rcd.nseg_bw);
+    }
+    write_binary(os, cm_data);
+
+    return;
+}
+
+Ray::Ray(const Ray &other)
+    : cm_surf_fw_(other.cm_surf_fw_),
+      cm_surf_bw_(other.cm_surf_bw_),
+      cm_cell_fw_(other.cm_cell_fw_),
+      cm_cell_bw_(other.cm_cell_bw_),
+      cm_data_(other.cm_data_),
+      seg_len_own_(other.seg_len_own_),
+      seg_index_own_(other.seg_index_own_),
+      seg_len_(other.seg_len_),
+      seg_index_(other.seg_index_),
+      nseg_(other.nseg_),
+      pin_nseg_(other.pin_nseg_),
+      bc_(other.bc_),
+      p1_(other.p1_),
+      p2_(other.p2_)
+{
+    // If the other ray owns its segments, we need to point to our own copy of
+    // them. Otherwise, we are just another view into the same packed storage.
+    if (other.owns_segments()) {
+        seg_len_   = seg_len_own_.data();
+        seg_index_ = seg_index_own_.data();
+    }
+    return;
+}
+
+Ray &Ray::operator=(const Ray &other)
+{
+    Ray tmp(other);
+    *this = std::move(tmp);
+    return *this;
+}
+
+void Ray::pack_segments(ray_len_t *seg_len, ray_index_t *seg_index)
+{
+    assert(owns_segments());
+    std::copy(seg_len_own_.begin(), seg_len_own_.end(), seg_len);
+    std::copy(seg_index_own_.begin(), seg_index_own_.end(), seg_index);
+
+    // Release the storage for real, rather than just clearing it
+    std::vector<ray_len_t>().swap(seg_len_own_);
+    std::vector<ray_index_t>().swap(seg_index_own_);
+
+    seg_len_   = seg_len;
+    seg_index_ = seg_index;
 
     return;
 }
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <iosfwd>
 #include "util/global_config.hpp"
 #include "geometry/geom.hpp"
 #include "core_mesh.hpp"
@@ -24,6 +26,64 @@
 
 namespace mocc {
 namespace moc {
+#ifdef COMPACT_RAYS
+/**
+ * \brief Storage type for ray segment lengths.
+ *
+ * With \c COMPACT_RAYS, segment lengths are stored in single precision and
+ * region indices in 16 bits, roughly halving the size of the ray data. Since
+ * the region indices are local to a geometrically-unique plane, this limits
+ * each unique plane to 65536 flat source regions.
+ */
+typedef float ray_len_t;
+/**
+ * \brief Storage type for plane-local segment region indices.
+ */
+typedef uint16_t ray_index_t;
+#else
+typedef real_t ray_len_t;
+typedef int ray_index_t;
+#endif
+
+/**
+ * \brief Minimal, non-owning view of a contiguous range of ray segment data.
+ *
+ * This is what \ref Ray hands out for its segment lengths and indices, which
+ * may either live in the \ref Ray itself, or in the packed storage of a \ref
+ * RayData.
+ */
+template <typename T> class SegmentView {
+public:
+    SegmentView(T *data, size_t size) : data_(data), size_(size)
+    {
+        return;
+    }
+
+    T *begin() const
+    {
+        return data_;
+    }
+
+    T *end() const
+    {
+        return data_ + size_;
+    }
+
+    T &operator[](size_t i) const
+    {
+        return data_[i];
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    T *data_;
+    size_t size_;
+};
+
 /**
  * A \ref Ray stores vectors of segment length and the flat source region
  * index that each segment is crossing. The FSR indices are represented as
@@ -60,6 +120,14 @@ public:
     Ray(Point2 p1, Point2 p2, std::array<int, 2> bc, int iplane,
         const CoreMesh &mesh);
 
+    Ray(const Ray &other);
+
+    Ray(Ray &&other) = default;
+
+    Ray &operator=(const Ray &other);
+
+    Ray &operator=(Ray &&other) = default;
+
     int nseg() const
     {
         return nseg_;
@@ -115,11 +183,11 @@ public:
     }
 
     /**
-     * Return a reference to the whole vector of segment lengths
+     * Return a view of the whole range of segment lengths
      */
-    const VecF &seg_len() const
+    SegmentView<const ray_len_t> seg_len() const
     {
-        return seg_len_;
+        return SegmentView<const ray_len_t>(seg_len_, nseg_);
     }
 
     /**
@@ -132,7 +200,7 @@ public:
      * is relatively automatic, since the \ref RayData object only exposes
      * each \ref Ray as a const reference.
      */
-    real_t &seg_len(int iseg)
+    ray_len_t &seg_len(int iseg)
     {
         return seg_len_[iseg];
     }
@@ -146,11 +214,11 @@ public:
     }
 
     /**
-     * Return a reference to the whole vector of segment indices
+     * Return a view of the whole range of segment indices
      */
-    const VecI &seg_index() const
+    SegmentView<const ray_index_t> seg_index() const
     {
-        return seg_index_;
+        return SegmentView<const ray_index_t>(seg_index_, nseg_);
     }
 
     /**
@@ -162,6 +230,31 @@ public:
         return seg_index_[iseg];
     }
 
+    /**
+     * \brief Return the number of segments in each pin that the ray
+     * crosses, in order.
+     */
+    const VecI &pin_nseg() const
+    {
+        return pin_nseg_;
+    }
+
+    /**
+     * \brief Return the point that the ray starts from
+     */
+    Point2 p1() const
+    {
+        return p1_;
+    }
+
+    /**
+     * \brief Return the point that the ray ends at
+     */
+    Point2 p2() const
+    {
+        return p2_;
+    }
+
     /**
      * Return the bc index for the start/stop of the ray
      */
@@ -189,7 +282,60 @@ public:
 
     friend std::ostream &operator<<(std::ostream &os, const Ray &ray);
 
+    friend class RayData;
+
 private:
+    /**
+     * \brief Construct a \ref Ray from a binary stream, as written by \ref
+     * write().
+     *
+     * \param is the stream to read from
+     * \param max_bytes an upper bound on the size of any of the stored
+     * arrays, usually the size of the file
+     *
+     * The segment data are owned by the new \ref Ray until they are packed.
+     */
+    Ray(std::istream &is, uint64_t max_bytes);
+
+    /**
+     * \brief Write everything needed to reconstruct the \ref Ray to a binary
+     * stream.
+     */
+    void write(std::ostream &os) const;
+
+    /**
+     * \brief Move the segment data into external storage.
+     *
+     * The segment lengths and indices are copied to the passed locations,
+     * which must have room for \ref nseg() entries, the storage owned by the
+     * \ref Ray is released, and the \ref Ray becomes a view into the external
+     * storage. This is used by \ref RayData to pack the segment data for all
+     * rays contiguously.
+     */
+    void pack_segments(ray_len_t *seg_len, ray_index_t *seg_index);
+
+    /**
+     * \brief Forget about the packed segment storage.
+     *
+     * This is used by \ref RayData when the packed storage is replaced by
+     * modular storage. The \ref Ray retains its coarse data and segment
+     * count, but its segment lengths and indices may no longer be accessed.
+     */
+    void release_segments()
+    {
+        assert(!owns_segments());
+        seg_len_   = nullptr;
+        seg_index_ = nullptr;
+    }
+
+    /**
+     * Return whether the segment data is owned by the \ref Ray itself.
+     */
+    bool owns_segments() const
+    {
+        return seg_len_ == seg_len_own_.data();
+    }
+
     size_t cm_surf_fw_;
     size_t cm_surf_bw_;
     size_t cm_cell_fw_;
@@ -197,15 +343,28 @@ private:
 
     std::vector<RayCoarseData> cm_data_;
 
-    // Length of ray segments
-    VecF seg_len_;
+    // Length of ray segments, as traced. This is empty once the segments
+    // have been packed.
+    std::vector<ray_len_t> seg_len_own_;
+
+    // FSR index of each segment from plane offset, as traced. This is empty
+    // once the segments have been packed.
+    std::vector<ray_index_t> seg_index_own_;
 
-    // FSR index of each segment from plane offset
-    VecI seg_index_;
+    // Length of ray segments. Points either to seg_len_own_ or to the packed
+    // storage on the RayData
+    ray_len_t *seg_len_;
+
+    // FSR index of each segment from plane offset. Points either to
+    // seg_index_own_ or to the packed storage on the RayData
+    ray_index_t *seg_index_;
 
     // Number of segments in the ray
     size_t nseg_;
 
+    // Number of segments in each pin crossed by the ray
+    VecI pin_nseg_;
+
     // Boundary condition index for the forward and backward directions
     std::array<int, 2> bc_;
 
@@ -18,13 +18,20 @@
 
 #include <algorithm>
 #include <cmath>
+#include <exception>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include "pugixml.hpp"
+#include "util/binary_io.hpp"
 #include "util/error.hpp"
 #include "util/files.hpp"
+#include "util/omp_guard.h"
 #include "util/rational_approximation.hpp"
 #include "util/string_utils.hpp"
 #include "util/validate_input.hpp"
@@ -33,7 +40,57 @@
 
 namespace {
 const std::vector<std::string> recognized_attributes = {
-    "modularity", "spacing", "volume_correction", "modularization"};
+    "modularity", "spacing", "volume_correction", "modularization",
+    "cache", "storage"};
+
+// Bump this whenever the layout of the ray cache file changes
+const uint32_t ray_cache_version = 2;
+const char ray_cache_magic[8]    = {'M', 'O', 'C', 'C', 'R', 'A', 'Y', 'S'};
+
+/**
+ * \brief A simple FNV-1a hash, used to key the ray cache.
+ */
+class Hash {
+public:
+    Hash() : h_(14695981039346656037ull)
+    {
+    }
+
+    template <typename T> void add(const T &v)
+    {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(&v);
+        for (size_t i = 0; i < sizeof(T); i++) {
+            h_ ^= p[i];
+            h_ *= 1099511628211ull;
+        }
+    }
+
+    uint64_t value() const
+    {
+        return h_;
+    }
+
+private:
+    uint64_t h_;
+};
+
+/**
+ * \brief Hash for the chord keys used by \ref RayData::modularize().
+ */
+struct ChordHash {
+    size_t operator()(const std::vector<int64_t> &key) const
+    {
+        Hash hash;
+        for (auto v : key) {
+            hash.add(v);
+        }
+        return hash.value();
+    }
+};
+
+// Resolution, in cm, to which chord segment lengths must agree for the
+// chords to be considered the same
+const double chord_length_resolution = 1.0e-9;
 }
 
 namespace mocc {
@@ -60,8 +117,12 @@ namespace moc {
  * -# Parse input from the XML
  * -# Modularize the angular quadrature and determine ray spacing for each
  *  angle
- * -# Construct Ray objects for each geometrically-unique plane and angle
- * -# Correct the ray segment lengths to preserve FSR volumes
+ * -# If a ray cache is specified and matches the problem, read the rays
+ *  from it. Otherwise:
+ *  -# Construct Ray objects for each geometrically-unique plane and angle
+ *  -# Correct the ray segment lengths to preserve FSR volumes
+ *  -# Write the rays to the cache, if specified
+ * -# If requested, convert the segment data to modular storage
  *
 */
 RayData::RayData(const pugi::xml_node &input, const AngularQuadrature &ang_quad,
@@ -142,8 +203,39 @@ RayData::RayData(const pugi::xml_node &input, const AngularQuadrature &ang_quad,
         }
     }
 
+    // Get the segment storage layout
+    modular_ = false;
+    if (!input.attribute("storage").empty()) {
+        std::string in_str = input.attribute("storage").value();
+        sanitize(in_str);
+        if (in_str == "modular") {
+            modular_ = true;
+            if (core_modular) {
+                Warn("Modular ray storage is most effective with pin-modular "
+                     "rays.");
+            }
+        } else if (in_str == "flat") {
+            modular_ = false;
+        } else {
+            throw EXCEPT("Unrecognized ray storage option.");
+        }
+    }
+
     // Store some necessary stuff from the CoreMesh
     n_planes_ = mesh.n_unique_planes();
+    max_pin_dx_ =
+        *std::max_element(mesh.pin_dx().begin(), mesh.pin_dx().end());
+    max_pin_dy_ =
+        *std::max_element(mesh.pin_dy().begin(), mesh.pin_dy().end());
+
+    // Make sure that the plane-local region indices fit in the storage type
+    for (unsigned iplane = 0; iplane < n_planes_; iplane++) {
+        if (mesh.unique_plane(iplane).n_reg() >
+            (size_t)std::numeric_limits<ray_index_t>::max() + 1) {
+            throw EXCEPT("Too many regions in a plane for the ray segment "
+                         "index type. Rebuild without COMPACT_RAYS.");
+        }
+    }
 
     // Extract whole-core dimensions
     real_t hx = mesh.hx_core();
@@ -205,16 +297,69 @@ RayData::RayData(const pugi::xml_node &input, const AngularQuadrature &ang_quad,
     LogFile << "Modularized Angular quadrature " << std::endl;
     LogFile << ang_quad_ << std::endl;
 
-    // Trace rays
+    // Try to read the traced rays from the cache, if one is specified. If
+    // that doesn't work out, trace them and update the cache.
+    std::string cache = input.attribute("cache").value();
+    uint64_t key      = 0;
+    bool from_cache   = false;
+    if (!cache.empty()) {
+        key        = this->cache_key(mesh, core_modular);
+        from_cache = this->read_cache(cache, key);
+    }
+
+    if (from_cache) {
+        LogScreen << "Read ray data from cache: " << cache << std::endl;
+        // The cached segment lengths are already volume-corrected
+        this->pack_rays();
+    } else {
+        this->trace(mesh);
+
+        // Move the segment data into contiguous storage
+        this->pack_rays();
+
+        // Adjust ray lengths to correct FSR volume. Use an angle integral to
+        // do so.
+        this->correct_volume(mesh);
+
+        if (!cache.empty()) {
+            this->write_cache(cache, key);
+        }
+    }
+
+    if (modular_) {
+        this->modularize();
+    }
+
+    LogScreen << "Done ray tracing" << std::endl;
+
+} // RayData::RayData()
+
+void RayData::trace(const CoreMesh &mesh)
+{
+    real_t hx = mesh.hx_core();
+    real_t hy = mesh.hy_core();
+
+    // Tracing proceeds in three phases. First, the end points and boundary
+    // condition indices of every ray in every plane and angle are laid out
+    // serially; this is cheap. Second, the rays are traced through the
+    // geometry in parallel, each into its own slot. Last, the traced rays
+    // are moved into place in the same order that they were laid out, so the
+    // resulting ray data does not depend on the number of threads.
+    struct RayStub {
+        Point2 p1;
+        Point2 p2;
+        std::array<int, 2> bc;
+        int iplane;
+    };
+
     Box core_box = Box(Point2(0.0, 0.0), Point2(hx, hy));
-    max_seg_     = 0;
+    std::vector<RayStub> stubs;
+    // Offset into the stubs for each plane/angle pair
+    VecI stub_offset(1, 0);
     // loop over the planes of unique geometry
     for (unsigned iplane = 0; iplane < n_planes_; iplane++) {
         // generate rays for each angle in octants 1 and 2
         int iang = 0;
-        std::vector<std::vector<Ray>> angle_rays;
-        int nreg_plane = mesh.unique_plane(iplane).n_reg();
-        VecI nrayfsr(nreg_plane, 0);
         for (auto ang = ang_quad_.octant(1); ang != ang_quad_.octant(3);
              ++ang) {
             int Nx  = Nx_[iang];
@@ -227,7 +372,6 @@ RayData::RayData(const pugi::xml_node &input, const AngularQuadrature &ang_quad,
             LogFile << "Spacing: " << ang->alpha << " " << space << " "
                     << space_x << " " << space_y << std::endl;
 
-            std::vector<Ray> rays;
             // Handle rays entering on the x-normal faces ( along the
             // y-axis)
             for (int iray = 0; iray < Ny; iray++) {
@@ -269,9 +413,7 @@ RayData::RayData(const pugi::xml_node &input, const AngularQuadrature &ang_quad,
                 assert(bc[1] >= 0);
                 assert(bc[0] < Nx + Ny);
                 assert(bc[1] < Nx + Ny);
-                rays.emplace_back(Ray(p1, p2, bc, iplane, mesh));
-
-                max_seg_ = std::max(rays.back().nseg(), max_seg_);
+                stubs.push_back({p1, p2, bc, (int)iplane});
             }
 
             // Handle rays entering on the y-normal face
@@ -299,7 +441,50 @@ RayData::RayData(const pugi::xml_node &input, const AngularQuadrature &ang_quad,
                 assert(bc[1] >= 0);
                 assert(bc[0] < Nx + Ny);
                 assert(bc[1] < Nx + Ny);
-                rays.emplace_back(Ray(p1, p2, bc, iplane, mesh));
+                stubs.push_back({p1, p2, bc, (int)iplane});
+            }
+            stub_offset.push_back(stubs.size());
+            ++iang;
+        } // Angle loop
+    }     // Plane loop
+
+    // Trace all of the rays. Rays vary a lot in length, so use a dynamic
+    // schedule. Exceptions may not leave the parallel region, so the first
+    // one is stashed and re-thrown once all threads are done.
+    int n_stub = stubs.size();
+    std::vector<std::unique_ptr<Ray>> traced(n_stub);
+    std::exception_ptr trace_error = nullptr;
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < n_stub; i++) {
+        try {
+            const RayStub &stub = stubs[i];
+            traced[i].reset(
+                new Ray(stub.p1, stub.p2, stub.bc, stub.iplane, mesh));
+        } catch (...) {
+#pragma omp critical
+            if (!trace_error) {
+                trace_error = std::current_exception();
+            }
+        }
+    }
+    if (trace_error) {
+        std::rethrow_exception(trace_error);
+    }
+
+    // Move the traced rays into place, in their original order
+    max_seg_   = 0;
+    int iangle = 0;
+    for (unsigned iplane = 0; iplane < n_planes_; iplane++) {
+        std::vector<std::vector<Ray>> angle_rays;
+        int nreg_plane = mesh.unique_plane(iplane).n_reg();
+        VecI nrayfsr(nreg_plane, 0);
+        for (int iang = 0; iang < ang_quad_.ndir_oct() * 2; iang++) {
+            std::vector<Ray> rays;
+            rays.reserve(stub_offset[iangle + 1] - stub_offset[iangle]);
+            for (int i = stub_offset[iangle]; i < stub_offset[iangle + 1];
+                 i++) {
+                rays.push_back(std::move(*traced[i]));
+                traced[i].reset();
                 max_seg_ = std::max(rays.back().nseg(), max_seg_);
             }
 
@@ -322,28 +507,182 @@ RayData::RayData(const pugi::xml_node &input, const AngularQuadrature &ang_quad,
                 }
             }
 
-            // Sort the rays by length. This might improve threading
-            // performance
-            // std::sort(rays.begin(), rays.end());
-            // std::reverse(rays.begin(), rays.end());
             // Move the stack of rays into the vector of angular ray sets.
             angle_rays.push_back(std::move(rays));
-            ++iang;
+            ++iangle;
         } // Angle loop
         // Move the angular ray set to the vector of planar ray sets.
         rays_.push_back(std::move(angle_rays));
     } // Plane loop
 
-    // Adjust ray lengths to correct FSR volume. Use an angle integral to do
-    // so.
-    this->correct_volume(mesh);
+    return;
+}
 
-    LogScreen << "Done ray tracing" << std::endl;
 
-} // RayData::RayData()
+uint64_t RayData::cache_key(const CoreMesh &mesh, bool core_modular) const
+{
+    Hash hash;
+    hash.add(ray_cache_version);
+    hash.add(sizeof(real_t));
+    hash.add(sizeof(ray_len_t));
+    hash.add(sizeof(ray_index_t));
+    hash.add((int)correction_type_);
+    hash.add((int)modularization_method_);
+    hash.add(core_modular);
+
+    // Modularized angles and ray spacings
+    for (auto ang = ang_quad_.octant(1); ang != ang_quad_.octant(3); ++ang) {
+        hash.add(ang->alpha);
+        hash.add(ang->theta);
+    }
+    for (int iang = 0; iang < ang_quad_.ndir_oct() * 2; iang++) {
+        hash.add(Nx_[iang]);
+        hash.add(Ny_[iang]);
+        hash.add(spacing_[iang]);
+    }
+
+    // Geometry of the unique planes: the pin mesh at each pin location, and
+    // the FSR areas
+    hash.add(mesh.hx_core());
+    hash.add(mesh.hy_core());
+    hash.add(n_planes_);
+    for (size_t iplane = 0; iplane < n_planes_; iplane++) {
+        const Plane &plane = mesh.unique_plane(iplane);
+        hash.add(plane.nx_pin());
+        hash.add(plane.ny_pin());
+        hash.add(plane.n_reg());
+        for (unsigned iy = 0; iy < plane.ny_pin(); iy++) {
+            for (unsigned ix = 0; ix < plane.nx_pin(); ix++) {
+                const PinMesh *pm = plane.get_pinmesh(Position(ix, iy, 0));
+                hash.add(pm->id());
+                hash.add(pm->n_reg());
+            }
+        }
+        for (const auto a : plane.areas()) {
+            hash.add(a);
+        }
+    }
+
+    return hash.value();
+}
+
+bool RayData::read_cache(const std::string &fname, uint64_t key)
+{
+    std::ifstream in(fname, std::ios::binary | std::ios::ate);
+    if (!in.good()) {
+        LogFile << "No ray cache found at " << fname << std::endl;
+        return false;
+    }
+
+    // The cache is streamed through the file buffer. The file size bounds
+    // the size of every array in it, so it is only looked up once.
+    auto end = in.tellg();
+    in.seekg(0);
+    if (!in || end < 0) {
+        LogFile << "Failed to read ray cache " << fname << ". Re-tracing."
+                << std::endl;
+        return false;
+    }
+    uint64_t file_size = end;
+
+    char magic[8];
+    in.read(magic, 8);
+    if (!in || !std::equal(magic, magic + 8, ray_cache_magic) ||
+        read_binary<uint32_t>(in) != ray_cache_version ||
+        read_binary<uint64_t>(in) != key) {
+        LogFile << "Ray cache " << fname << " does not match the current "
+                                            "problem. Re-tracing."
+                << std::endl;
+        return false;
+    }
+
+    // Every read is checked before its result is used, and the first
+    // failure abandons the cache. Sizes that disagree with the current
+    // problem or exceed what is left of the file are treated as corruption.
+    auto truncated = [&fname]() {
+        LogFile << "Ray cache " << fname << " is truncated or corrupt. "
+                                            "Re-tracing."
+                << std::endl;
+        return false;
+    };
+
+    RaySet_t rays;
+    int max_seg = 0;
+    uint64_t n_planes = read_binary<uint64_t>(in);
+    if (!in || n_planes != n_planes_) {
+        return truncated();
+    }
+    for (size_t iplane = 0; iplane < n_planes_; iplane++) {
+        uint64_t n_ang = read_binary<uint64_t>(in);
+        if (!in || (int)n_ang != ang_quad_.ndir_oct() * 2) {
+            return truncated();
+        }
+        PlaneRays_t plane_rays;
+        for (uint64_t iang = 0; iang < n_ang; iang++) {
+            uint64_t n_rays = read_binary<uint64_t>(in);
+            if (!in || (int)n_rays != Nrays_[iang]) {
+                return truncated();
+            }
+            std::vector<Ray> ang_rays;
+            ang_rays.reserve(n_rays);
+            for (uint64_t iray = 0; iray < n_rays; iray++) {
+                Ray ray(in, file_size);
+                if (!in) {
+                    return truncated();
+                }
+                max_seg = std::max(max_seg, ray.nseg());
+                ang_rays.push_back(std::move(ray));
+            }
+            plane_rays.push_back(std::move(ang_rays));
+        }
+        rays.push_back(std::move(plane_rays));
+    }
+
+    rays_    = std::move(rays);
+    max_seg_ = max_seg;
+
+    return true;
+}
+
+void RayData::write_cache(const std::string &fname, uint64_t key) const
+{
+    std::ofstream out(fname, std::ios::binary);
+    if (!out.good()) {
+        Warn("Failed to open ray cache for writing: " + fname);
+        return;
+    }
+
+    out.write(ray_cache_magic, 8);
+    write_binary(out, ray_cache_version);
+    write_binary(out, key);
+
+    write_binary(out, (uint64_t)rays_.size());
+    for (const auto &plane_rays : rays_) {
+        write_binary(out, (uint64_t)plane_rays.size());
+        for (const auto &ang_rays : plane_rays) {
+            write_binary(out, (uint64_t)ang_rays.size());
+            for (const auto &ray : ang_rays) {
+                ray.write(out);
+            }
+        }
+    }
+
+    if (!out.good()) {
+        Warn("Failed to write ray cache: " + fname);
+        return;
+    }
+
+    LogFile << "Wrote ray cache: " << fname << std::endl;
+
+    return;
+}
 
 void RayData::correct_volume(const CoreMesh &mesh)
 {
+    // The work within a plane is split among threads such that anything
+    // reduced over angles is still summed in angle order, so the corrected
+    // lengths do not depend on the number of threads.
+    int n_ang = ang_quad_.ndir_oct() * 2;
     switch (correction_type_) {
     // Correct each angle independently, preserving volume integral of
     // region for each angle
@@ -360,43 +699,49 @@ void RayData::correct_volume(const CoreMesh &mesh)
             int max_iang         = 0;
             real_t flat_corr_rms = 0.0;
             const VecF &true_vol = mesh.unique_plane(iplane).areas();
-            int iang             = 0;
-
-            for (auto ang = ang_quad_.octant(1); ang != ang_quad_.octant(3);
-                 ++ang) {
-                VecF fsr_vol(mesh.unique_plane(iplane).n_reg(), 0.0);
-                VecF flat_cf(mesh.unique_plane(iplane).n_reg(), 0.0);
-                auto &rays   = rays_[iplane][iang];
-                real_t space = spacing_[iang];
-                for (const auto &ray : rays) {
-                    for (int iseg = 0; iseg < ray.nseg(); iseg++) {
-                        size_t ireg = ray.seg_index(iseg);
-                        fsr_vol[ireg] += ray.seg_len(iseg) * space;
-                    }
+            int n_reg            = mesh.unique_plane(iplane).n_reg();
+
+            VecF ang_corr_max(n_ang, 0.0);
+            VecI ang_max_ireg(n_ang, 0);
+            VecF ang_corr_rms(n_ang, 0.0);
+
+#pragma omp parallel for schedule(dynamic, 1)
+            for (int iang = 0; iang < n_ang; iang++) {
+                VecF fsr_vol(n_reg, 0.0);
+                VecF flat_cf(n_reg, 0.0);
+                auto &packed     = packed_[iplane][iang];
+                auto &seg_len    = packed.seg_len_;
+                const auto &segs = packed.seg_index_;
+                real_t space     = spacing_[iang];
+                for (int iseg = 0; iseg < packed.n_seg(); iseg++) {
+                    fsr_vol[segs[iseg]] += seg_len[iseg] * space;
                 }
 
-                for (size_t ireg = 0; ireg < mesh.unique_plane(iplane).n_reg();
-                     ireg++) {
+                for (int ireg = 0; ireg < n_reg; ireg++) {
                     flat_cf[ireg] = true_vol[ireg] / fsr_vol[ireg];
                     // jwg
-                    if (flat_corr_max < std::abs(flat_cf[ireg] - 1.0)) {
-                        flat_corr_max = std::abs(flat_cf[ireg] - 1.0);
-                        max_ireg      = ireg;
-                        max_iang      = iang;
+                    if (ang_corr_max[iang] < std::abs(flat_cf[ireg] - 1.0)) {
+                        ang_corr_max[iang] = std::abs(flat_cf[ireg] - 1.0);
+                        ang_max_ireg[iang] = ireg;
                     }
-                    flat_corr_rms +=
+                    ang_corr_rms[iang] +=
                         (flat_cf[ireg] - 1.0) * (flat_cf[ireg] - 1.0);
                 }
 
                 // Correction
-                for (auto &ray : rays) {
-                    for (int iseg = 0; iseg < ray.nseg(); iseg++) {
-                        int ireg          = ray.seg_index(iseg);
-                        ray.seg_len(iseg) = ray.seg_len(iseg) * flat_cf[ireg];
-                    }
+                for (int iseg = 0; iseg < packed.n_seg(); iseg++) {
+                    seg_len[iseg] = seg_len[iseg] * flat_cf[segs[iseg]];
                 }
-                iang++;
             } // angle loop
+
+            for (int iang = 0; iang < n_ang; iang++) {
+                if (flat_corr_max < ang_corr_max[iang]) {
+                    flat_corr_max = ang_corr_max[iang];
+                    max_ireg      = ang_max_ireg[iang];
+                    max_iang      = iang;
+                }
+                flat_corr_rms += ang_corr_rms[iang];
+            }
             flat_corr_rms =
                 std::sqrt(flat_corr_rms / (mesh.unique_plane(iplane).n_reg() *
                                            (ang_quad_.ndir() / 4)));
@@ -428,25 +773,48 @@ void RayData::correct_volume(const CoreMesh &mesh)
             int max_ireg         = 0;
 
             const VecF &true_vol = mesh.unique_plane(iplane).areas();
-            VecF fsr_vol(mesh.unique_plane(iplane).n_reg(), 0.0);
-            int iang = 0;
-            for (auto ang = ang_quad_.octant(1); ang != ang_quad_.octant(3);
-                 ++ang) {
-                std::vector<Ray> &rays = rays_[iplane][iang];
-                real_t space           = spacing_[iang];
-                real_t wgt             = ang->weight * 0.5;
-
-                for (auto &ray : rays) {
-                    for (int iseg = 0; iseg < ray.nseg(); iseg++) {
-                        int ireg = ray.seg_index(iseg);
-                        fsr_vol[ireg] += ray.seg_len(iseg) * space * wgt;
+            int n_reg            = mesh.unique_plane(iplane).n_reg();
+
+            // Tally the segment volumes of each angle separately, in
+            // parallel, then add the angles into fsr_vol in angle order. The
+            // angles are handled a batch at a time, so that only one partial
+            // volume per thread needs to be stored. However the angles are
+            // batched, each region sums the same per-angle partials in the
+            // same order, so the result doesn't depend on the thread count.
+            VecF fsr_vol(n_reg, 0.0);
+            int n_batch = std::min(n_ang, omp_get_max_threads());
+            std::vector<VecF> ang_vol(n_batch, VecF(n_reg));
+            for (int first_ang = 0; first_ang < n_ang; first_ang += n_batch) {
+                int n = std::min(n_batch, n_ang - first_ang);
+#pragma omp parallel
+                {
+#pragma omp for schedule(dynamic, 1)
+                    for (int i = 0; i < n; i++) {
+                        int iang           = first_ang + i;
+                        const auto &packed = packed_[iplane][iang];
+                        const auto &segs   = packed.seg_index_;
+                        real_t space       = spacing_[iang];
+                        real_t wgt         = ang_quad_[iang].weight * 0.5;
+                        VecF &vol          = ang_vol[i];
+
+                        std::fill(vol.begin(), vol.end(), 0.0);
+                        for (int iseg = 0; iseg < packed.n_seg(); iseg++) {
+                            vol[segs[iseg]] +=
+                                packed.seg_len_[iseg] * space * wgt;
+                        }
+                    }
+
+#pragma omp for
+                    for (int ireg = 0; ireg < n_reg; ireg++) {
+                        for (int i = 0; i < n; i++) {
+                            fsr_vol[ireg] += ang_vol[i][ireg];
+                        }
                     }
                 }
-                ++iang;
             }
+
             // Convert fsr_vol into a correction factor
-            for (int ireg = 0; ireg < (int)mesh.unique_plane(iplane).n_reg();
-                 ireg++) {
+            for (int ireg = 0; ireg < n_reg; ireg++) {
                 fsr_vol[ireg] = true_vol[ireg] / fsr_vol[ireg];
                 if (flat_corr_max < std::abs(fsr_vol[ireg] - 1.0)) {
                     flat_corr_max = std::abs(fsr_vol[ireg] - 1.0);
@@ -456,21 +824,17 @@ void RayData::correct_volume(const CoreMesh &mesh)
             }
 
             // Correct ray lengths to enforce proper FSR volumes
-            iang = 0;
-            for (auto ang = ang_quad_.octant(1); ang != ang_quad_.octant(3);
-                 ++ang) {
-                std::vector<Ray> &rays = rays_[iplane][iang];
-                for (auto &ray : rays) {
-                    for (int iseg = 0; iseg < ray.nseg(); iseg++) {
-                        int ireg          = ray.seg_index(iseg);
-                        ray.seg_len(iseg) = ray.seg_len(iseg) * fsr_vol[ireg];
-                    }
+#pragma omp parallel for schedule(dynamic, 1)
+            for (int iang = 0; iang < n_ang; iang++) {
+                auto &packed     = packed_[iplane][iang];
+                auto &seg_len    = packed.seg_len_;
+                const auto &segs = packed.seg_index_;
+                for (int iseg = 0; iseg < packed.n_seg(); iseg++) {
+                    seg_len[iseg] = seg_len[iseg] * fsr_vol[segs[iseg]];
                 }
-                ++iang;
             } // angle loop
 
-            flat_corr_rms =
-                sqrt(flat_corr_rms / (int)mesh.unique_plane(iplane).n_reg());
+            flat_corr_rms = sqrt(flat_corr_rms / n_reg);
 
             LogFile << "For plane " << iplane
                     << ", the maximum correction occurs with "
@@ -488,6 +852,234 @@ void RayData::correct_volume(const CoreMesh &mesh)
     }
 } // correct_volume
 
+void RayData::pack_rays()
+{
+    packed_.clear();
+    packed_.reserve(rays_.size());
+    for (auto &plane_rays : rays_) {
+        std::vector<PackedRays> plane_packed;
+        plane_packed.reserve(plane_rays.size());
+        for (auto &ang_rays : plane_rays) {
+            PackedRays packed;
+
+            // Size everything up front, so that the storage doesn't move
+            // around underneath the rays once they start pointing to it
+            size_t nseg = 0;
+            for (const auto &ray : ang_rays) {
+                nseg += ray.nseg();
+            }
+            packed.seg_len_.resize(nseg);
+            packed.seg_index_.resize(nseg);
+            packed.ray_offset_.reserve(ang_rays.size() + 1);
+            packed.bc_.reserve(ang_rays.size() * 2);
+
+            for (auto &ray : ang_rays) {
+                size_t offset = packed.ray_offset_.back();
+                packed.bc_.push_back(ray.bc(0));
+                packed.bc_.push_back(ray.bc(1));
+                ray.pack_segments(&packed.seg_len_[offset],
+                                  &packed.seg_index_[offset]);
+                packed.ray_offset_.push_back(offset + ray.nseg());
+            }
+            assert(packed.ray_offset_.back() == nseg);
+
+            // Start with all rays in a single bin
+            packed.ray_order_.resize(ang_rays.size());
+            for (int iray = 0; iray < (int)ang_rays.size(); iray++) {
+                packed.ray_order_[iray] = iray;
+            }
+            packed.bin_offset_   = {0, (int)ang_rays.size()};
+            packed.color_offset_ = {0, 1};
+
+            plane_packed.push_back(std::move(packed));
+        }
+        packed_.push_back(std::move(plane_packed));
+    }
+
+    return;
+}
+
+void RayData::modularize()
+{
+    size_t n_seg_flat  = 0;
+    size_t n_seg_chord = 0;
+    for (size_t iplane = 0; iplane < n_planes_; iplane++) {
+        int n_ang = packed_[iplane].size();
+#pragma omp parallel for schedule(dynamic, 1) \
+    reduction(+ : n_seg_flat, n_seg_chord)
+        for (int iang = 0; iang < n_ang; iang++) {
+            auto &packed         = packed_[iplane][iang];
+            const auto &ang_rays = rays_[iplane][iang];
+            std::unordered_map<std::vector<int64_t>, int, ChordHash> chords;
+
+            packed.chord_offset_ = {0};
+            packed.mod_offset_   = {0};
+            std::vector<int64_t> key;
+            for (int iray = 0; iray < packed.n_rays(); iray++) {
+                const ray_len_t *seg_len     = packed.seg_len(iray);
+                const ray_index_t *seg_index = packed.seg_index(iray);
+                int iseg                     = 0;
+                for (int nseg : ang_rays[iray].pin_nseg()) {
+                    if (nseg == 0) {
+                        continue;
+                    }
+                    // Chord-local region indices are relative to the lowest
+                    // index in the chord
+                    int base = *std::min_element(seg_index + iseg,
+                                                 seg_index + iseg + nseg);
+                    key.clear();
+                    for (int i = iseg; i < iseg + nseg; i++) {
+                        key.push_back(seg_index[i] - base);
+                        key.push_back(
+                            std::llround(seg_len[i] / chord_length_resolution));
+                    }
+
+                    auto inserted = chords.emplace(key, packed.n_chords());
+                    if (inserted.second) {
+                        for (int i = iseg; i < iseg + nseg; i++) {
+                            packed.chord_len_.push_back(seg_len[i]);
+                            packed.chord_index_.push_back(seg_index[i] - base);
+                        }
+                        packed.chord_offset_.push_back(
+                            packed.chord_len_.size());
+                    }
+                    packed.mod_chord_.push_back(inserted.first->second);
+                    packed.mod_base_.push_back(base);
+
+                    iseg += nseg;
+                }
+                assert(iseg == packed.nseg(iray));
+                packed.mod_offset_.push_back(packed.mod_chord_.size());
+            }
+
+            n_seg_flat += packed.n_seg();
+            n_seg_chord += packed.chord_len_.size();
+
+            // Release the flat storage
+            std::vector<ray_len_t>().swap(packed.seg_len_);
+            std::vector<ray_index_t>().swap(packed.seg_index_);
+            packed.modular_ = true;
+        }
+
+        // The rays no longer have anywhere to point
+        for (auto &ang_rays : rays_[iplane]) {
+            for (auto &ray : ang_rays) {
+                ray.release_segments();
+            }
+        }
+    }
+
+    LogFile << "Modular ray storage: " << n_seg_chord << " unique chord "
+            << "segments in place of " << n_seg_flat << " ray segments"
+            << std::endl;
+
+    return;
+}
+
+void RayData::balance(int n_bin)
+{
+    assert(n_bin > 0);
+
+    LogFile << "Partitioning rays into 2 colors of " << n_bin
+            << " bins. Load imbalance (critical path/mean segments per bin):"
+            << std::endl;
+
+    const int n_color = 2;
+
+    int iplane = 0;
+    for (auto &plane_packed : packed_) {
+        real_t worst = 1.0;
+        int iang     = 0;
+        for (auto &packed : plane_packed) {
+            const auto &ang_rays = rays_[iplane][iang];
+            int n_rays           = packed.n_rays();
+            real_t alpha         = ang_quad_[iang].alpha;
+            real_t sin_a         = std::abs(std::sin(alpha));
+            real_t cos_a         = std::abs(std::cos(alpha));
+
+            // Position of each ray across the ray direction, and the width of
+            // the widest pin cell in that direction. Pad the width a little,
+            // so that rounding can't put two rays crossing the same pin in
+            // non-adjacent bands.
+            real_t width = (max_pin_dx_ * sin_a + max_pin_dy_ * cos_a) *
+                           (1.0 + 1.0e-6);
+            VecF offset(n_rays);
+            real_t offset_min = std::numeric_limits<real_t>::max();
+            for (int iray = 0; iray < n_rays; iray++) {
+                Point2 p     = ang_rays[iray].p1();
+                offset[iray] = p.y * std::cos(alpha) - p.x * std::sin(alpha);
+                offset_min   = std::min(offset_min, offset[iray]);
+            }
+
+            // Cut the rays into bands, and tally the work in each
+            VecI band(n_rays);
+            int n_band = 0;
+            for (int iray = 0; iray < n_rays; iray++) {
+                band[iray] = (int)((offset[iray] - offset_min) / width);
+                n_band     = std::max(n_band, band[iray] + 1);
+            }
+            std::vector<long> band_load(n_band, 0);
+            for (int iray = 0; iray < n_rays; iray++) {
+                band_load[band[iray]] += packed.nseg(iray);
+            }
+
+            // Within each color, sort the bands by decreasing work, then put
+            // each in the bin with the least work so far
+            VecI band_bin(n_band);
+            long critical_path = 0;
+            for (int icolor = 0; icolor < n_color; icolor++) {
+                VecI by_size;
+                for (int iband = icolor; iband < n_band; iband += n_color) {
+                    by_size.push_back(iband);
+                }
+                std::stable_sort(by_size.begin(), by_size.end(),
+                                 [&band_load](int l, int r) {
+                                     return band_load[l] > band_load[r];
+                                 });
+
+                std::vector<long> load(n_bin, 0);
+                for (int iband : by_size) {
+                    int ibin = std::distance(
+                        load.begin(),
+                        std::min_element(load.begin(), load.end()));
+                    band_bin[iband] = icolor * n_bin + ibin;
+                    load[ibin] += band_load[iband];
+                }
+                critical_path += *std::max_element(load.begin(), load.end());
+            }
+
+            // Group the rays by bin, keeping them in ascending order within
+            // each bin
+            packed.bin_offset_.assign(n_color * n_bin + 1, 0);
+            for (int iray = 0; iray < n_rays; iray++) {
+                packed.bin_offset_[band_bin[band[iray]] + 1]++;
+            }
+            for (int ibin = 0; ibin < n_color * n_bin; ibin++) {
+                packed.bin_offset_[ibin + 1] += packed.bin_offset_[ibin];
+            }
+            VecI pos(packed.bin_offset_.begin(), packed.bin_offset_.end() - 1);
+            packed.ray_order_.resize(n_rays);
+            for (int iray = 0; iray < n_rays; iray++) {
+                packed.ray_order_[pos[band_bin[band[iray]]]++] = iray;
+            }
+            packed.color_offset_.resize(n_color + 1);
+            for (int icolor = 0; icolor <= n_color; icolor++) {
+                packed.color_offset_[icolor] = icolor * n_bin;
+            }
+
+            real_t mean = (real_t)packed.n_seg() / n_bin;
+            if (mean > 0.0) {
+                worst = std::max(worst, critical_path / mean);
+            }
+            iang++;
+        }
+        LogFile << "    Plane " << iplane << ": " << worst << std::endl;
+        iplane++;
+    }
+
+    return;
+}
+
 std::pair<int, int> RayData::modularize_angle(Angle ang, real_t hx, real_t hy,
                                               real_t nominal_spacing) const
 {
@@ -16,8 +16,11 @@
 
 #pragma once
 
+#include <cassert>
+#include <cstdint>
 #include <iosfwd>
 #include <memory>
+#include <string>
 #include <vector>
 #include "util/pugifwd.hpp"
 #include "core/angular_quadrature.hpp"
@@ -50,6 +53,311 @@ std::ostream &operator<<(std::ostream &os, VolumeCorrection vc);
  * conventions.
 */
 
+/**
+ * \brief Contiguous storage of the segment data for all of the rays in a
+ * single plane and angle.
+ *
+ * The segment lengths and FSR indices of every ray are stored back-to-back in
+ * a compressed sparse row (CSR) layout, with an array of offsets marking the
+ * first segment of each ray. The boundary condition indices for each ray are
+ * stored alongside. This allows the MoC sweeper to stream through all of the
+ * rays for an angle without chasing a separate allocation for each \ref Ray.
+ *
+ * Alternatively, the segments may be stored modularly. In that case, the
+ * segments of each distinct pin crossing (a "chord") are stored once, and
+ * each ray is described as a sequence of chords, each with the index of its
+ * first region. Since most pins in a lattice are geometrically identical,
+ * and pin-modular rays cross each of them in the same way, this is much
+ * smaller than the flat layout. The segments of a ray are then reconstructed
+ * on the fly with \ref expand(), usually by way of a \ref SegmentBuffer.
+ */
+class PackedRays {
+public:
+    PackedRays() : ray_offset_(1, 0), modular_(false)
+    {
+        return;
+    }
+
+    /**
+     * \brief Return the number of rays
+     */
+    int n_rays() const
+    {
+        return ray_offset_.size() - 1;
+    }
+
+    /**
+     * \brief Return the total number of segments for all rays
+     */
+    int n_seg() const
+    {
+        return ray_offset_.back();
+    }
+
+    /**
+     * \brief Return the number of segments in the indexed ray
+     */
+    int nseg(int iray) const
+    {
+        return ray_offset_[iray + 1] - ray_offset_[iray];
+    }
+
+    /**
+     * \brief Return a pointer to the first segment length of the indexed ray
+     */
+    const ray_len_t *seg_len(int iray) const
+    {
+        assert(!modular_);
+        return seg_len_.data() + ray_offset_[iray];
+    }
+
+    /**
+     * \brief Return a pointer to the first segment index of the indexed ray
+     */
+    const ray_index_t *seg_index(int iray) const
+    {
+        assert(!modular_);
+        return seg_index_.data() + ray_offset_[iray];
+    }
+
+    /**
+     * \brief Return the boundary condition index of the indexed ray, for the
+     * given direction
+     */
+    int bc(int iray, int dir) const
+    {
+        return bc_[2 * iray + dir];
+    }
+
+    /**
+     * \brief Return the number of bins that the rays are partitioned into
+     *
+     * Each bin is meant to be swept by a single thread. Until \ref
+     * RayData::balance() is called, all rays are in a single bin.
+     */
+    int n_bins() const
+    {
+        return bin_offset_.size() - 1;
+    }
+
+    /**
+     * \brief Return the number of colors that the bins are grouped into
+     *
+     * No two bins of the same color cross the same flat source region, so
+     * the bins of a color may be swept concurrently, with each thread
+     * tallying straight into the scalar flux. The colors themselves must be
+     * swept one after the other.
+     */
+    int n_colors() const
+    {
+        return color_offset_.size() - 1;
+    }
+
+    /**
+     * \brief Return the index of the first bin of the indexed color
+     */
+    int color_begin(int icolor) const
+    {
+        return color_offset_[icolor];
+    }
+
+    /**
+     * \brief Return the index one past the last bin of the indexed color
+     */
+    int color_end(int icolor) const
+    {
+        return color_offset_[icolor + 1];
+    }
+
+    /**
+     * \brief Return the position in \ref ray_order() of the first ray in the
+     * indexed bin
+     */
+    int bin_begin(int ibin) const
+    {
+        return bin_offset_[ibin];
+    }
+
+    /**
+     * \brief Return the position in \ref ray_order() one past the last ray in
+     * the indexed bin
+     */
+    int bin_end(int ibin) const
+    {
+        return bin_offset_[ibin + 1];
+    }
+
+    /**
+     * \brief Return the index of the ray at the passed position in the
+     * binned ordering
+     */
+    int ray_order(int i) const
+    {
+        return ray_order_[i];
+    }
+
+    /**
+     * \brief Return whether the segments are stored modularly
+     */
+    bool modular() const
+    {
+        return modular_;
+    }
+
+    /**
+     * \brief Return the number of unique chords in the modular storage
+     */
+    int n_chords() const
+    {
+        return chord_offset_.size() - 1;
+    }
+
+    /**
+     * \brief Reconstruct the segments of the indexed ray from the modular
+     * storage.
+     *
+     * \param iray the index of the ray
+     * \param len storage for the segment lengths, with room for at least
+     * \ref nseg() entries
+     * \param index storage for the plane-local segment region indices, with
+     * room for at least \ref nseg() entries
+     */
+    void expand(int iray, ray_len_t *len, ray_index_t *index) const
+    {
+        assert(modular_);
+        for (int imod = mod_offset_[iray]; imod < mod_offset_[iray + 1];
+             imod++) {
+            int ichord = mod_chord_[imod];
+            int base   = mod_base_[imod];
+            for (int i = chord_offset_[ichord]; i < chord_offset_[ichord + 1];
+                 i++) {
+                *len++   = chord_len_[i];
+                *index++ = chord_index_[i] + base;
+            }
+        }
+        return;
+    }
+
+    /**
+     * \brief Return the whole array of segment lengths for all rays
+     *
+     * This is empty for modular storage.
+     */
+    const std::vector<ray_len_t> &seg_len() const
+    {
+        return seg_len_;
+    }
+
+    /**
+     * \brief Return the whole array of segment indices for all rays
+     *
+     * This is empty for modular storage.
+     */
+    const std::vector<ray_index_t> &seg_index() const
+    {
+        return seg_index_;
+    }
+
+    friend class RayData;
+
+private:
+    // Segment lengths for all rays, stored contiguously
+    std::vector<ray_len_t> seg_len_;
+    // Plane-local FSR index for all segments, stored contiguously
+    std::vector<ray_index_t> seg_index_;
+    // Index of the first segment of each ray. There is one extra entry at
+    // the end, so that the segments of ray i lie in [ray_offset_[i],
+    // ray_offset_[i+1])
+    std::vector<size_t> ray_offset_;
+    // Forward and backward boundary condition indices for each ray
+    VecI bc_;
+    // Ray indices, grouped by bin. Rays within a bin are in ascending order
+    VecI ray_order_;
+    // Position in ray_order_ of the first ray in each bin, plus one extra
+    // entry at the end
+    VecI bin_offset_;
+    // Index of the first bin of each color, plus one extra entry at the end
+    VecI color_offset_;
+
+    // Whether the segments are stored in the modular form below, rather than
+    // in seg_len_ and seg_index_
+    bool modular_;
+    // Segment lengths and chord-local region indices of each unique chord,
+    // stored contiguously
+    std::vector<ray_len_t> chord_len_;
+    std::vector<ray_index_t> chord_index_;
+    // Index of the first segment of each chord, plus one extra entry at the
+    // end
+    VecI chord_offset_;
+    // Position in mod_chord_ and mod_base_ of the first chord of each ray,
+    // plus one extra entry at the end
+    VecI mod_offset_;
+    // Chord index of each pin crossing, for all rays
+    VecI mod_chord_;
+    // Plane-local index of the region that the chord-local region indices
+    // are relative to, for each pin crossing
+    std::vector<ray_index_t> mod_base_;
+};
+
+/**
+ * \brief Scratch space for the segments of a single ray.
+ *
+ * \ref load() makes \ref len() and \ref index() refer to the segments of a
+ * ray. For flat storage these point straight into the \ref PackedRays; for
+ * modular storage the ray is expanded into the buffer. Each thread in a sweep
+ * should have its own.
+ */
+class SegmentBuffer {
+public:
+    SegmentBuffer(int max_seg)
+        : len_buf_(max_seg),
+          index_buf_(max_seg),
+          len_(nullptr),
+          index_(nullptr)
+    {
+        return;
+    }
+
+    /**
+     * \brief Make the buffer refer to the segments of the indexed ray
+     */
+    void load(const PackedRays &packed, int iray)
+    {
+        if (packed.modular()) {
+            packed.expand(iray, len_buf_.data(), index_buf_.data());
+            len_   = len_buf_.data();
+            index_ = index_buf_.data();
+        } else {
+            len_   = packed.seg_len(iray);
+            index_ = packed.seg_index(iray);
+        }
+        return;
+    }
+
+    /**
+     * \brief Return a pointer to the segment lengths of the loaded ray
+     */
+    const ray_len_t *len() const
+    {
+        return len_;
+    }
+
+    /**
+     * \brief Return a pointer to the plane-local segment region indices of
+     * the loaded ray
+     */
+    const ray_index_t *index() const
+    {
+        return index_;
+    }
+
+private:
+    std::vector<ray_len_t> len_buf_;
+    std::vector<ray_index_t> index_buf_;
+    const ray_len_t *len_;
+    const ray_index_t *index_;
+};
+
 /**
 * The \ref RayData class is a collection of \ref Ray objects, organized by
 * plane, then by angle. Rays are traced only for the set of
@@ -79,6 +387,12 @@ std::ostream &operator<<(std::ostream &os, VolumeCorrection vc);
 |                                |
 +- 4-- 5-- 6-- 7-- 8-- 9--10--11-+ \endverbatim
 *
+* Once all of the rays are traced, the segment data for each plane and angle
+* are packed into a \ref PackedRays, and the \ref Ray objects become views into
+* that storage. The \ref Ray objects are still useful for their coarse ray data,
+* but the sweeper kernel should prefer the \ref PackedRays, accessible via
+* \ref packed().
+*
 */
 class RayData {
     /**
@@ -91,6 +405,11 @@ public:
     RayData(const pugi::xml_node &input, const AngularQuadrature &ang_quad,
             const CoreMesh &mesh);
 
+    // The Rays point into the packed storage, so copying would leave them
+    // pointing at the wrong data.
+    RayData(const RayData &other) = delete;
+    RayData &operator=(const RayData &other) = delete;
+
     /**
      * Iterator to the beginning of the ray data (by plane)
      */
@@ -176,6 +495,45 @@ public:
         return rays_[id];
     }
 
+    /**
+     * \brief Return whether the segment data are stored modularly
+     *
+     * When they are, the segment lengths and indices of the individual
+     * \ref Ray objects are not available; only the \ref PackedRays should be
+     * used to access segment data.
+     */
+    bool modular() const
+    {
+        return modular_;
+    }
+
+    /**
+     * \brief Return a const reference to the packed segment data for the
+     * indexed plane and angle.
+     */
+    const PackedRays &packed(size_t iplane, size_t iang) const
+    {
+        return packed_[iplane][iang];
+    }
+
+    /**
+     * \brief Partition the rays for each plane and angle into bins of
+     * roughly equal work, which may be swept concurrently.
+     *
+     * \param n_bin the number of bins of each color, typically the number of
+     * threads
+     *
+     * The rays of an angle are parallel, so they are cut into bands across
+     * their direction, each at least as wide as the largest pin cell seen
+     * along the rays. Since every flat source region lies within a pin cell,
+     * rays in bands that are not adjacent never cross the same region. The
+     * even bands make up the first color and the odd bands the second, and
+     * the bands of each color are assigned to bins using
+     * longest-processing-time-first bin packing, with the number of segments
+     * as the cost. The resulting load imbalance is reported in the log file.
+     */
+    void balance(int n_bin);
+
 private:
     // Methods
     std::pair<int, int> modularize_angle(Angle ang, real_t hx, real_t hy,
@@ -191,6 +549,11 @@ private:
     // treats all of the rays for the given plane and angle.
     RaySet_t rays_;
 
+    // Contiguous segment storage for each plane and angle. This is indexed
+    // in the same way as rays_, and each Ray in rays_ refers to its
+    // segments in here.
+    std::vector<std::vector<PackedRays>> packed_;
+
     // Ray spacings for each angle. These vary from those specified due to
     // modularization
     VecF spacing_;
@@ -213,6 +576,14 @@ private:
     // Maximum number of ray segments in a single ray
     int max_seg_;
 
+    // Largest pin cell dimensions on the core mesh. Every flat source region
+    // lies within a pin cell, so this bounds the extent of any region.
+    real_t max_pin_dx_;
+    real_t max_pin_dy_;
+
+    // Whether the segment data are stored modularly
+    bool modular_;
+
     /**
      * Perform a volume-correction of the ray segment lengths. This can be
      * done in two ways: using an angular integral of the ray volumes, or
@@ -223,6 +594,50 @@ private:
      */
     void correct_volume(const CoreMesh &mesh);
 
+    /**
+     * Trace the rays for all unique planes and angles, using the modularized
+     * angular quadrature and ray spacings.
+     */
+    void trace(const CoreMesh &mesh);
+
+    /**
+     * \brief Replace the flat segment storage of each \ref PackedRays with
+     * modular storage.
+     *
+     * This is done after volume correction, and chords are considered the
+     * same if their (corrected) segment data agree, so the modular storage
+     * reproduces the flat storage to within a tiny tolerance, regardless of
+     * the ray modularity.
+     */
+    void modularize();
+
+    /**
+     * \brief Return a hash of everything that determines the traced rays:
+     * the unique plane geometry, the modularized angular quadrature and ray
+     * spacings, and the ray tracing options.
+     */
+    uint64_t cache_key(const CoreMesh &mesh, bool core_modular) const;
+
+    /**
+     * \brief Try to read the traced rays from a cache file.
+     *
+     * Returns \c true if the file exists and was written for the same \p
+     * key, in which case \ref rays_ is filled with the volume-corrected rays.
+     * Otherwise, returns \c false and leaves \ref rays_ alone.
+     */
+    bool read_cache(const std::string &fname, uint64_t key);
+
+    /**
+     * \brief Write the traced, volume-corrected rays to a cache file.
+     */
+    void write_cache(const std::string &fname, uint64_t key) const;
+
+    /**
+     * Move the segment data from all of the traced \ref Ray objects into
+     * contiguous \ref PackedRays storage for each plane and angle.
+     */
+    void pack_rays();
+
     Modularization modularization_method_;
 };
 
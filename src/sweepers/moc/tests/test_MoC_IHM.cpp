@@ -16,6 +16,7 @@
 
 #include "UnitTest++/UnitTest++.h"
 
+#include <cmath>
 #include <iostream>
 #include <string>
 #include "pugixml.hpp"
@@ -91,8 +92,36 @@ public:
         }
         return;
     }
+
+    const moc::RayData &rays() const
+    {
+        return rays_;
+    }
 };
 
+// Trace a ray again, the same way that moc::Ray does, but keeping the segment
+// lengths in full precision
+VecF trace_uncompacted(const moc::Ray &ray, int iplane, const CoreMesh &mesh)
+{
+    std::vector<Point2> ps;
+    ps.push_back(ray.p1());
+    ps.push_back(ray.p2());
+    mesh.trace(ps);
+
+    VecF seg_len;
+    VecI seg_index;
+    auto p_prev = ps.front();
+    for (auto pi = ps.begin() + 1; pi != ps.end(); ++pi) {
+        auto pin_p             = Midpoint(*pi, p_prev);
+        int first_reg          = 0;
+        const PinMeshTuple pmt = mesh.get_pinmesh(pin_p, iplane, first_reg);
+        pmt.pm->trace(p_prev - pin_p, *pi - pin_p, first_reg, seg_len,
+                      seg_index);
+        p_prev = *pi;
+    }
+    return seg_len;
+}
+
 // This routine generates the reference solution
 void reference_solution(real_t &k_eff, ArrayB1 &flux, ArrayB1 &psi);
 
@@ -149,6 +178,274 @@ TEST(moc_ihm)
     }
 }
 
+// Same as above, but sweep all groups at once with Jacobi-style group
+// iteration. Use a group block that doesn't divide the number of groups, to
+// catch problems with a partial block.
+TEST(moc_ihm_multigroup)
+{
+    auto result = xml_doc.load_string(ihm_xml.c_str());
+    CHECK(result);
+    xml_doc.child("sweeper").append_attribute("group_block").set_value(3);
+
+    int ng = 7;
+    ArrayB1 flux_ref(ng);
+    ArrayB1 psi_ref(ng);
+    real_t k_ref;
+    reference_solution(k_ref, flux_ref, psi_ref);
+
+    CoreMesh core_mesh(xml_doc);
+
+    TestMoCSweeper sweeper(xml_doc.child("sweeper"), core_mesh);
+    auto source = sweeper.create_source(xml_doc.child("source"));
+    sweeper.assign_source(source.get());
+
+    sweeper.set_spectrum(flux_ref);
+
+    ArrayB1 fission_source(sweeper.n_reg());
+    fission_source = 0.0;
+    sweeper.calc_fission_source(k_ref, fission_source);
+
+    ArrayB2 mg_source(sweeper.n_reg(), ng);
+    for (int ig = 0; ig < ng; ig++) {
+        source->initialize_group(ig);
+        source->fission(fission_source, ig);
+        source->in_scatter(ig);
+        for (int ireg = 0; ireg < sweeper.n_reg(); ireg++) {
+            mg_source(ireg, ig) = (*source)[ireg];
+        }
+    }
+
+    sweeper.sweep_multigroup(mg_source);
+
+    for (int ig = 0; ig < ng; ig++) {
+        for (int ireg = 0; ireg < sweeper.n_reg(); ireg++) {
+            CHECK_CLOSE(flux_ref(ig), sweeper.flux(ig, ireg),
+                        0.005 * flux_ref(ig));
+        }
+    }
+}
+
+// Same again, with threads owning whole angles
+TEST(moc_ihm_angle_parallel)
+{
+    auto result = xml_doc.load_string(ihm_xml.c_str());
+    CHECK(result);
+    xml_doc.child("sweeper").append_attribute("parallel").set_value("angle");
+
+    int ng = 7;
+    ArrayB1 flux_ref(ng);
+    ArrayB1 psi_ref(ng);
+    real_t k_ref;
+    reference_solution(k_ref, flux_ref, psi_ref);
+
+    CoreMesh core_mesh(xml_doc);
+
+    TestMoCSweeper sweeper(xml_doc.child("sweeper"), core_mesh);
+    auto source = sweeper.create_source(xml_doc.child("source"));
+    sweeper.assign_source(source.get());
+
+    sweeper.set_spectrum(flux_ref);
+
+    ArrayB1 fission_source(sweeper.n_reg());
+    fission_source = 0.0;
+    sweeper.calc_fission_source(k_ref, fission_source);
+
+    for (int ig = 0; ig < ng; ig++) {
+        source->initialize_group(ig);
+        source->fission(fission_source, ig);
+        source->in_scatter(ig);
+        sweeper.sweep(ig);
+
+        for (int ireg = 0; ireg < sweeper.n_reg(); ireg++) {
+            CHECK_CLOSE(flux_ref(ig), sweeper.flux(ig, ireg),
+                        0.005 * flux_ref(ig));
+        }
+    }
+}
+
+// Sweep all groups at once with concurrent group blocks, and make sure that the
+// flux and CMFD currents match those from sweeping the groups one at a time.
+// Open up the east and west sides so that there is some net current to
+// compare.
+TEST(moc_group_parallel_currents)
+{
+    auto result = xml_doc.load_string(ihm_xml.c_str());
+    CHECK(result);
+    xml_doc.child("core").attribute("east").set_value("vacuum");
+    xml_doc.child("core").attribute("west").set_value("vacuum");
+    xml_doc.child("sweeper").attribute("n_inner").set_value(5);
+
+    int ng = 7;
+    ArrayB1 flux_ref(ng);
+    ArrayB1 psi_ref(ng);
+    real_t k_ref;
+    reference_solution(k_ref, flux_ref, psi_ref);
+
+    CoreMesh core_mesh(xml_doc);
+
+    // Serial, one group at a time
+    TestMoCSweeper serial(xml_doc.child("sweeper"), core_mesh);
+    auto serial_source = serial.create_source(xml_doc.child("source"));
+    serial.assign_source(serial_source.get());
+    CoarseData serial_data(core_mesh, ng);
+    serial.set_coarse_data(&serial_data);
+    serial.set_spectrum(flux_ref);
+
+    // Group blocks swept concurrently. Use a group block that doesn't divide
+    // the number of groups, to catch problems with a partial block.
+    xml_doc.child("sweeper").append_attribute("parallel").set_value("group");
+    xml_doc.child("sweeper").append_attribute("group_block").set_value(3);
+    TestMoCSweeper parallel(xml_doc.child("sweeper"), core_mesh);
+    auto parallel_source = parallel.create_source(xml_doc.child("source"));
+    parallel.assign_source(parallel_source.get());
+    CoarseData parallel_data(core_mesh, ng);
+    parallel.set_coarse_data(&parallel_data);
+    parallel.set_spectrum(flux_ref);
+
+    ArrayB1 fission_source(serial.n_reg());
+    fission_source = 0.0;
+    serial.calc_fission_source(k_ref, fission_source);
+
+    ArrayB2 mg_source(serial.n_reg(), ng);
+    for (int ig = 0; ig < ng; ig++) {
+        serial_source->initialize_group(ig);
+        serial_source->fission(fission_source, ig);
+        serial_source->in_scatter(ig);
+        for (int ireg = 0; ireg < serial.n_reg(); ireg++) {
+            mg_source(ireg, ig) = (*serial_source)[ireg];
+        }
+    }
+
+    parallel.sweep_multigroup(mg_source);
+    for (int ig = 0; ig < ng; ig++) {
+        for (int ireg = 0; ireg < serial.n_reg(); ireg++) {
+            (*serial_source)[ireg] = mg_source(ireg, ig);
+        }
+        serial.sweep(ig);
+    }
+
+    for (int ig = 0; ig < ng; ig++) {
+        for (int ireg = 0; ireg < serial.n_reg(); ireg++) {
+            CHECK_CLOSE(serial.flux(ig, ireg), parallel.flux(ig, ireg),
+                        1.0e-10 * flux_ref(ig));
+        }
+        for (int is = 0; is < (int)serial_data.current.extent(0); is++) {
+            real_t scale = std::abs(serial_data.surface_flux(is, ig));
+            CHECK_CLOSE(serial_data.current(is, ig),
+                        parallel_data.current(is, ig), 1.0e-10 * scale);
+            CHECK_CLOSE(serial_data.surface_flux(is, ig),
+                        parallel_data.surface_flux(is, ig), 1.0e-10 * scale);
+        }
+    }
+    CHECK(parallel_data.has_radial_data());
+}
+
+// Perform one power iteration, starting from the reference solution, and make
+// sure that the resulting eigenvalue is unchanged. This is mostly here to
+// make sure that the COMPACT_RAYS segment layout doesn't cost any accuracy;
+// the same tolerance applies to both. See moc_ihm_uncompacted for a direct
+// comparison of the ray segments.
+TEST(moc_ihm_eigenvalue)
+{
+    auto result = xml_doc.load_string(ihm_xml.c_str());
+    CHECK(result);
+
+    int ng = 7;
+    ArrayB1 flux_ref(ng);
+    ArrayB1 psi_ref(ng);
+    real_t k_ref;
+    reference_solution(k_ref, flux_ref, psi_ref);
+
+    CoreMesh core_mesh(xml_doc);
+
+    TestMoCSweeper sweeper(xml_doc.child("sweeper"), core_mesh);
+    auto source = sweeper.create_source(xml_doc.child("source"));
+    sweeper.assign_source(source.get());
+
+    sweeper.set_spectrum(flux_ref);
+
+    ArrayB1 fission_source(sweeper.n_reg());
+    fission_source = 0.0;
+    sweeper.calc_fission_source(k_ref, fission_source);
+
+    for (int ig = 0; ig < ng; ig++) {
+        source->initialize_group(ig);
+        source->fission(fission_source, ig);
+        source->in_scatter(ig);
+        sweeper.sweep(ig);
+    }
+
+    // The reference fission source is unity everywhere, so the new estimate
+    // of the eigenvalue is just k_ref times the volume-averaged new fission
+    // source.
+    ArrayB1 new_fission_source(sweeper.n_reg());
+    new_fission_source = 0.0;
+    sweeper.calc_fission_source(k_ref, new_fission_source);
+    real_t fs  = 0.0;
+    real_t vol = 0.0;
+    for (int ireg = 0; ireg < sweeper.n_reg(); ireg++) {
+        fs += new_fission_source(ireg) * sweeper.volumes()[ireg];
+        vol += sweeper.volumes()[ireg];
+    }
+    real_t k = k_ref * fs / vol;
+    std::cout << "reference k-inf: " << k_ref << " MoC k-inf: " << k
+              << std::endl;
+
+    CHECK_CLOSE(k_ref, k, 0.0001);
+}
+
+// Compare the stored ray segments against the same rays traced in full
+// precision. Without COMPACT_RAYS they should be identical; with it, the
+// segment lengths and the track-length region volumes that the sweeper sees
+// should only differ by single-precision rounding. Volume correction is
+// disabled, so that the stored lengths are exactly those that were traced.
+TEST(moc_ihm_uncompacted)
+{
+    auto result = xml_doc.load_string(ihm_xml.c_str());
+    CHECK(result);
+    xml_doc.child("sweeper")
+        .child("rays")
+        .append_attribute("volume_correction")
+        .set_value("none");
+
+#ifdef COMPACT_RAYS
+    real_t tol = 1.0e-6;
+#else
+    real_t tol = 0.0;
+#endif
+
+    CoreMesh core_mesh(xml_doc);
+    TestMoCSweeper sweeper(xml_doc.child("sweeper"), core_mesh);
+    const auto &rays = sweeper.rays();
+
+    for (int iplane = 0; iplane < (int)core_mesh.n_unique_planes();
+         iplane++) {
+        int n_reg = core_mesh.unique_plane(iplane).n_reg();
+        int iang  = 0;
+        for (const auto &ang_rays : rays[iplane]) {
+            VecF vol(n_reg, 0.0);
+            VecF vol_uncompacted(n_reg, 0.0);
+            for (const auto &ray : ang_rays) {
+                VecF seg_len = trace_uncompacted(ray, iplane, core_mesh);
+                REQUIRE CHECK_EQUAL((int)seg_len.size(), ray.nseg());
+                for (int iseg = 0; iseg < ray.nseg(); iseg++) {
+                    CHECK_CLOSE(seg_len[iseg], ray.seg_len(iseg),
+                                tol * seg_len[iseg]);
+                    vol[ray.seg_index(iseg)] +=
+                        ray.seg_len(iseg) * rays.spacing(iang);
+                    vol_uncompacted[ray.seg_index(iseg)] +=
+                        seg_len[iseg] * rays.spacing(iang);
+                }
+            }
+            for (int ireg = 0; ireg < n_reg; ireg++) {
+                CHECK_CLOSE(vol_uncompacted[ireg], vol[ireg],
+                            tol * vol_uncompacted[ireg]);
+            }
+            iang++;
+        }
+    }
+}
+
 void reference_solution(real_t &k_eff, ArrayB1 &flux, ArrayB1 &psi)
 {
     const MaterialLib mat_lib(xml_doc.child("material_lib"));
@@ -300,9 +300,16 @@ TEST(weird_ray)
         0.12752525252525249,  0.12752525252525249,  0.12752525252525268,
         0.12752525252525249,  0.089267676767675302, 0.038257575757577197};
 
+    // Segment lengths are stored in single precision with COMPACT_RAYS
+#ifdef COMPACT_RAYS
+    real_t len_tol = 0.0000001;
+#else
+    real_t len_tol = 0.000000000000001;
+#endif
+
     REQUIRE CHECK_EQUAL(36, ray.nseg());
     CHECK_ARRAY_EQUAL(seg_index_expect, ray.seg_index(), 36);
-    CHECK_ARRAY_CLOSE(seg_len_expect, ray.seg_len(), 36, 0.000000000000001);
+    CHECK_ARRAY_CLOSE(seg_len_expect, ray.seg_len(), 36, len_tol);
 }
 
 int main()
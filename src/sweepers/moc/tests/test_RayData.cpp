@@ -16,8 +16,12 @@
 
 #include "UnitTest++/UnitTest++.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include "pugixml.hpp"
 #include "util/global_config.hpp"
@@ -73,6 +77,280 @@ TEST(raydata)
     }
 }
 
+// Make sure that the packed segment storage agrees with the data on each Ray
+TEST(raydata_packed)
+{
+    pugi::xml_document geom_xml;
+    pugi::xml_parse_result result = geom_xml.load_file("square.xml");
+
+    CoreMesh mesh(geom_xml);
+
+    pugi::xml_document angquad_xml;
+    result = angquad_xml.load_string("<ang_quad type=\"ls\" order=\"4\" />");
+
+    CHECK(result);
+
+    AngularQuadrature ang_quad(angquad_xml.child("ang_quad"));
+
+    pugi::xml_document ray_xml;
+    ray_xml.load_string("<rays spacing=\"0.01\" />");
+
+    moc::RayData ray_data(ray_xml.child("rays"), ang_quad, mesh);
+
+    int iplane = 0;
+    for (auto &plane_rays : ray_data) {
+        int iang = 0;
+        for (auto &angle_rays : plane_rays) {
+            const auto &packed = ray_data.packed(iplane, iang);
+            CHECK_EQUAL((int)angle_rays.size(), packed.n_rays());
+            int nseg_total = 0;
+            for (int iray = 0; iray < packed.n_rays(); iray++) {
+                const auto &ray = angle_rays[iray];
+                CHECK_EQUAL(ray.nseg(), packed.nseg(iray));
+                CHECK_EQUAL(ray.bc(0), packed.bc(iray, 0));
+                CHECK_EQUAL(ray.bc(1), packed.bc(iray, 1));
+                // The rays should be views into the packed storage
+                CHECK(&ray.seg_len()[0] == packed.seg_len(iray));
+                CHECK_ARRAY_EQUAL(ray.seg_index(), packed.seg_index(iray),
+                                  ray.nseg());
+                nseg_total += ray.nseg();
+            }
+            CHECK_EQUAL(nseg_total, packed.n_seg());
+            iang++;
+        }
+        iplane++;
+    }
+}
+
+TEST(raydata_balance)
+{
+    pugi::xml_document geom_xml;
+    pugi::xml_parse_result result = geom_xml.load_file("square.xml");
+
+    CoreMesh mesh(geom_xml);
+
+    pugi::xml_document angquad_xml;
+    result = angquad_xml.load_string("<ang_quad type=\"ls\" order=\"4\" />");
+
+    CHECK(result);
+
+    AngularQuadrature ang_quad(angquad_xml.child("ang_quad"));
+
+    pugi::xml_document ray_xml;
+    ray_xml.load_string("<rays spacing=\"0.01\" />");
+
+    moc::RayData ray_data(ray_xml.child("rays"), ang_quad, mesh);
+
+    int n_bin = 3;
+    ray_data.balance(n_bin);
+
+    int iplane = 0;
+    for (auto &plane_rays : ray_data) {
+        for (int iang = 0; iang < (int)plane_rays.size(); iang++) {
+            const auto &packed = ray_data.packed(iplane, iang);
+            CHECK_EQUAL(2, packed.n_colors());
+            CHECK_EQUAL(2 * n_bin, packed.n_bins());
+
+            // Every ray should show up in exactly one bin, and no two bins of
+            // the same color should cross the same region
+            std::vector<int> count(packed.n_rays(), 0);
+            for (int icolor = 0; icolor < packed.n_colors(); icolor++) {
+                CHECK_EQUAL(n_bin, packed.color_end(icolor) -
+                                       packed.color_begin(icolor));
+                VecI owner(mesh.n_reg(MeshTreatment::PLANE), -1);
+                for (int ibin = packed.color_begin(icolor);
+                     ibin < packed.color_end(icolor); ibin++) {
+                    for (int ir = packed.bin_begin(ibin);
+                         ir < packed.bin_end(ibin); ir++) {
+                        int iray = packed.ray_order(ir);
+                        count[iray]++;
+                        for (int iseg = 0; iseg < packed.nseg(iray);
+                             iseg++) {
+                            int ireg = packed.seg_index(iray)[iseg];
+                            CHECK(owner[ireg] < 0 || owner[ireg] == ibin);
+                            owner[ireg] = ibin;
+                        }
+                    }
+                }
+            }
+            for (auto c : count) {
+                CHECK_EQUAL(1, c);
+            }
+        }
+        iplane++;
+    }
+}
+
+TEST(raydata_cache)
+{
+    pugi::xml_document geom_xml;
+    pugi::xml_parse_result result = geom_xml.load_file("square.xml");
+
+    CoreMesh mesh(geom_xml);
+
+    pugi::xml_document angquad_xml;
+    result = angquad_xml.load_string("<ang_quad type=\"ls\" order=\"4\" />");
+
+    CHECK(result);
+
+    AngularQuadrature ang_quad(angquad_xml.child("ang_quad"));
+
+    pugi::xml_document ray_xml;
+    ray_xml.load_string(
+        "<rays spacing=\"0.01\" cache=\"test_raydata.cache\" />");
+
+    // The first one traces and writes the cache, the second one reads it
+    std::remove("test_raydata.cache");
+    moc::RayData traced(ray_xml.child("rays"), ang_quad, mesh);
+    moc::RayData cached(ray_xml.child("rays"), ang_quad, mesh);
+
+    CHECK_EQUAL(traced.max_segments(), cached.max_segments());
+
+    int iplane = 0;
+    for (auto &plane_rays : traced) {
+        for (int iang = 0; iang < (int)plane_rays.size(); iang++) {
+            const auto &p_traced = traced.packed(iplane, iang);
+            const auto &p_cached = cached.packed(iplane, iang);
+            CHECK_EQUAL(p_traced.n_rays(), p_cached.n_rays());
+            CHECK_EQUAL(p_traced.n_seg(), p_cached.n_seg());
+            CHECK_ARRAY_EQUAL(p_traced.seg_len(), p_cached.seg_len(),
+                              p_traced.n_seg());
+            CHECK_ARRAY_EQUAL(p_traced.seg_index(), p_cached.seg_index(),
+                              p_traced.n_seg());
+            for (int iray = 0; iray < p_traced.n_rays(); iray++) {
+                const auto &r_traced = plane_rays[iang][iray];
+                const auto &r_cached = cached[iplane][iang][iray];
+                CHECK_EQUAL(r_traced.bc(0), r_cached.bc(0));
+                CHECK_EQUAL(r_traced.bc(1), r_cached.bc(1));
+                CHECK_EQUAL(r_traced.cm_cell_fw(), r_cached.cm_cell_fw());
+                CHECK_EQUAL(r_traced.cm_surf_bw(), r_cached.cm_surf_bw());
+                CHECK_EQUAL(r_traced.ncseg(), r_cached.ncseg());
+            }
+        }
+        iplane++;
+    }
+    std::remove("test_raydata.cache");
+}
+
+// A truncated cache should be rejected cleanly, and the rays re-traced and the
+// cache rewritten
+TEST(raydata_cache_truncated)
+{
+    pugi::xml_document geom_xml;
+    pugi::xml_parse_result result = geom_xml.load_file("square.xml");
+
+    CoreMesh mesh(geom_xml);
+
+    pugi::xml_document angquad_xml;
+    result = angquad_xml.load_string("<ang_quad type=\"ls\" order=\"4\" />");
+
+    CHECK(result);
+
+    AngularQuadrature ang_quad(angquad_xml.child("ang_quad"));
+
+    pugi::xml_document ray_xml;
+    ray_xml.load_string(
+        "<rays spacing=\"0.01\" cache=\"test_raydata_trunc.cache\" />");
+
+    std::remove("test_raydata_trunc.cache");
+    moc::RayData traced(ray_xml.child("rays"), ang_quad, mesh);
+
+    std::string full;
+    {
+        std::ifstream in("test_raydata_trunc.cache", std::ios::binary);
+        full.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+    }
+    CHECK(full.size() > 64);
+
+    // Cut the file inside the header, just past the header (inside the first
+    // size field), and somewhere in the middle of the ray data
+    std::vector<size_t> cuts = {10, 21, full.size() / 2, full.size() - 1};
+    for (auto cut : cuts) {
+        {
+            std::ofstream out("test_raydata_trunc.cache", std::ios::binary);
+            out.write(full.data(), cut);
+        }
+
+        moc::RayData retraced(ray_xml.child("rays"), ang_quad, mesh);
+
+        CHECK_EQUAL(traced.max_segments(), retraced.max_segments());
+        int iplane = 0;
+        for (auto &plane_rays : traced) {
+            for (int iang = 0; iang < (int)plane_rays.size(); iang++) {
+                const auto &p_traced   = traced.packed(iplane, iang);
+                const auto &p_retraced  = retraced.packed(iplane, iang);
+                CHECK_EQUAL(p_traced.n_seg(), p_retraced.n_seg());
+                CHECK_ARRAY_EQUAL(p_traced.seg_len(), p_retraced.seg_len(),
+                                  p_traced.n_seg());
+                CHECK_ARRAY_EQUAL(p_traced.seg_index(),
+                                  p_retraced.seg_index(), p_traced.n_seg());
+            }
+            iplane++;
+        }
+
+        // Re-tracing should have rewritten the whole cache
+        std::ifstream in("test_raydata_trunc.cache",
+                         std::ios::binary | std::ios::ate);
+        CHECK_EQUAL(full.size(), (size_t)in.tellg());
+    }
+    std::remove("test_raydata_trunc.cache");
+}
+
+// Make sure that the modular storage reproduces the flat storage, and is
+// actually smaller
+TEST(raydata_modular)
+{
+    pugi::xml_document geom_xml;
+    pugi::xml_parse_result result = geom_xml.load_file("square.xml");
+
+    CoreMesh mesh(geom_xml);
+
+    pugi::xml_document angquad_xml;
+    result = angquad_xml.load_string("<ang_quad type=\"ls\" order=\"4\" />");
+
+    CHECK(result);
+
+    AngularQuadrature ang_quad(angquad_xml.child("ang_quad"));
+
+    pugi::xml_document flat_xml;
+    flat_xml.load_string("<rays spacing=\"0.01\" modularity=\"pin\" />");
+    pugi::xml_document modular_xml;
+    modular_xml.load_string(
+        "<rays spacing=\"0.01\" modularity=\"pin\" storage=\"modular\" />");
+
+    moc::RayData flat(flat_xml.child("rays"), ang_quad, mesh);
+    moc::RayData modular(modular_xml.child("rays"), ang_quad, mesh);
+
+    CHECK(!flat.modular());
+    CHECK(modular.modular());
+
+    std::vector<moc::ray_len_t> len(modular.max_segments());
+    std::vector<moc::ray_index_t> index(modular.max_segments());
+    int iplane = 0;
+    for (auto &plane_rays : flat) {
+        for (int iang = 0; iang < (int)plane_rays.size(); iang++) {
+            const auto &p_flat    = flat.packed(iplane, iang);
+            const auto &p_modular = modular.packed(iplane, iang);
+            CHECK_EQUAL(p_flat.n_rays(), p_modular.n_rays());
+            CHECK_EQUAL(p_flat.n_seg(), p_modular.n_seg());
+            CHECK(p_modular.modular());
+
+            for (int iray = 0; iray < p_flat.n_rays(); iray++) {
+                CHECK_EQUAL(p_flat.nseg(iray), p_modular.nseg(iray));
+                p_modular.expand(iray, len.data(), index.data());
+                CHECK_ARRAY_CLOSE(p_flat.seg_len(iray), len,
+                                  p_flat.nseg(iray), 0.00000001);
+                CHECK_ARRAY_EQUAL(p_flat.seg_index(iray), index,
+                                  p_flat.nseg(iray));
+            }
+            CHECK(p_modular.n_chords() > 0);
+            CHECK(p_modular.n_chords() < p_modular.n_rays() * 9);
+        }
+        iplane++;
+    }
+}
+
 TEST(raydata_performance) {
     pugi::xml_document geom_xml;
     pugi::xml_parse_result result = geom_xml.load_file("c5g7_2d.xml");
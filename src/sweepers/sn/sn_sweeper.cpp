@@ -36,7 +36,8 @@ BC_Size_t boundary_helper(const Mesh &mesh)
 
 const std::vector<std::string> recognized_attributes = {
     "type",  "n_inner",         "equation",
-    "axial", "boundary_update", "update_incoming"};
+    "axial", "boundary_update", "update_incoming",
+    "inner_tol", "wavefront"};
 }
 
 namespace mocc {
@@ -54,7 +55,8 @@ SnSweeper::SnSweeper(const pugi::xml_node &input, const CoreMesh &mesh)
       bc_in_(mesh.mat_lib().n_group(), ang_quad_, bc_type_,
              boundary_helper(mesh)),
       bc_out_(1, ang_quad_, bc_type_, boundary_helper(mesh)),
-      gs_boundary_(true)
+      gs_boundary_(true),
+      wavefront_(false)
 {
     LogFile << "Constructing a base Sn sweeper" << std::endl;
     validate_input(input, recognized_attributes);
@@ -95,6 +97,16 @@ SnSweeper::SnSweeper(const pugi::xml_node &input, const CoreMesh &mesh)
     }
     n_inner_ = int_in;
 
+    // Adaptive inner iterations. When enabled, n_inner is the maximum
+    real_t inner_tol = 0.0;
+    if (!input.attribute("inner_tol").empty()) {
+        inner_tol = input.attribute("inner_tol").as_float(-1.0);
+        if (inner_tol <= 0.0) {
+            throw EXCEPT("Invalid inner iteration tolerance (inner_tol).");
+        }
+    }
+    inner_control_.configure(n_group_, n_inner_, inner_tol);
+
     // Try to read boundary update option
     if (!input.attribute("boundary_update").empty()) {
         std::string in_string = input.attribute("boundary_update").value();
@@ -118,12 +130,55 @@ SnSweeper::SnSweeper(const pugi::xml_node &input, const CoreMesh &mesh)
              "in parallel Sn");
     }
 
+    // Wavefront sweeps
+    wavefront_ = input.attribute("wavefront").as_bool(false);
+    if (wavefront_) {
+        this->setup_wavefront();
+    }
+
     timer_.toc();
     timer_init_.toc();
 
     return;
 } // SnSweeper::SnSweeper( input, mesh )
 
+/**
+ * The cells are stored in sweep order for an octant with all-positive
+ * direction cosines. Sweepers map them to the actual cell positions for other
+ * octants by reversing the appropriate indices.
+ */
+void SnSweeper::setup_wavefront()
+{
+    int nx      = mesh_.nx();
+    int ny      = mesh_.ny();
+    int nz      = mesh_.nz();
+    int n_plane = nx + ny + nz - 2;
+
+    wavefront_cells_.clear();
+    wavefront_cells_.reserve(nx * ny * nz);
+    wavefront_offset_.clear();
+    wavefront_offset_.reserve(n_plane + 1);
+
+    for (int ip = 0; ip < n_plane; ip++) {
+        wavefront_offset_.push_back(wavefront_cells_.size());
+        for (int iz = std::max(0, ip - nx - ny + 2); iz <= std::min(ip, nz - 1);
+             iz++) {
+            for (int iy = std::max(0, ip - iz - nx + 1);
+                 iy <= std::min(ip - iz, ny - 1); iy++) {
+                int ix = ip - iz - iy;
+                wavefront_cells_.push_back(Position(ix, iy, iz));
+            }
+        }
+    }
+    wavefront_offset_.push_back(wavefront_cells_.size());
+    assert((int)wavefront_cells_.size() == nx * ny * nz);
+
+    LogFile << "Sn sweeper using wavefront sweeps over " << n_plane
+            << " diagonal planes" << std::endl;
+
+    return;
+}
+
 /**
  * This just decides what method should be used to update the incoming flux
  * and instantiates an appropriate lambda function to carry out the update
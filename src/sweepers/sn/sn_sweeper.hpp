@@ -87,6 +87,32 @@ public:
      */
     void update_incoming_flux() override final;
 
+    /**
+     * \brief \copybrief TransportSweeper::n_boundary_values()
+     */
+    int n_boundary_values() const override final
+    {
+        return bc_in_.size();
+    }
+
+    /**
+     * \brief \copybrief TransportSweeper::get_boundary_values()
+     */
+    void get_boundary_values(real_t *out) const override final
+    {
+        bc_in_.copy_all(out);
+        return;
+    }
+
+    /**
+     * \brief \copybrief TransportSweeper::set_boundary_values()
+     */
+    void set_boundary_values(const real_t *in) override final
+    {
+        bc_in_.set_all(in);
+        return;
+    }
+
     ArrayB3 pin_powers() const override final;
 
     ArrayB2 pin_powers_2d() const;
@@ -201,6 +227,16 @@ protected:
     // Gauss-Seidel BC update?
     bool gs_boundary_;
 
+    // Whether to sweep the mesh in diagonal planes, rather than one angle
+    // at a time
+    bool wavefront_;
+
+    // Cells of the mesh, in order of the diagonal plane (ix + iy + iz) that
+    // they lie on, and the index of the first cell in each plane. See
+    // setup_wavefront().
+    std::vector<Position> wavefront_cells_;
+    VecI wavefront_offset_;
+
     // Protected methods
     /**
      * \brief Grab data (XS, etc.) from one or more external files
@@ -213,6 +249,12 @@ protected:
      */
     void check_balance(int group) const;
 
+    /**
+     * \brief Sort the cells of the mesh by the diagonal plane that they lie
+     * on, for wavefront sweeps
+     */
+    void setup_wavefront();
+
     /**
      * This funtion template is used to permit flexibility in the
      * incoming
@@ -113,10 +113,12 @@ public:
         flux_1g_.reference(flux_(blitz::Range::all(), group));
 
         // Perform inner iterations
-        for (unsigned inner = 0; inner < n_inner_; inner++) {
+        unsigned n_inner = inner_control_.n_inner(group);
+        inner_control_.begin(group, flux_1g_);
+        for (unsigned inner = 0; inner < n_inner; inner++) {
             // Set the source (add upscatter and divide by 4PI)
             source_->self_scatter(group);
-            if (inner == n_inner_ - 1 && coarse_data_) {
+            if (inner == n_inner - 1 && coarse_data_) {
                 // Wipe out the existing currents
                 coarse_data_->zero_data(group);
                 coarse_data_->source() = "Sn Sweeper";
@@ -134,6 +136,7 @@ public:
                     this->sweep_1g<sn::NoCurrent>(group);
                 }
             }
+            inner_control_.observe(group, flux_1g_);
         }
 
         // Clean up zeros
@@ -165,6 +168,11 @@ protected:
      */
     template <typename CurrentWorker> void sweep_1g(int group)
     {
+        if (wavefront_) {
+            this->sweep_1g_wavefront<CurrentWorker>(group);
+            return;
+        }
+
         flux_1g_ = 0.0;
 #pragma omp parallel default(shared)
         {
@@ -296,6 +304,152 @@ protected:
         return;
     } // sweep_1g (3-D)
 
+    /**
+     * \brief Wavefront (KBA-style) version of \ref sweep_1g().
+     *
+     * All of the angles in an octant share the same upwind directions, so
+     * for all of them, the cells on a diagonal plane (ix + iy + iz, counted
+     * in sweep order) only depend on cells in earlier planes. Each octant is
+     * therefore swept one diagonal plane at a time, with the work on each
+     * plane shared among the threads over both the cells on the plane and
+     * the angles in the octant. This exposes more parallelism than the
+     * angles alone when there are few of them.
+     */
+    template <typename CurrentWorker> void sweep_1g_wavefront(int group)
+    {
+        assert(ang_quad_.ndir() == 8 * ang_quad_.ndir_oct());
+
+        flux_1g_ = 0.0;
+
+        int nx      = mesh_.nx();
+        int ny      = mesh_.ny();
+        int nz      = mesh_.nz();
+        int n_oct   = ang_quad_.ndir_oct();
+        int n_plane = wavefront_offset_.size() - 1;
+
+        // Angular flux face storage for each angle in the current octant
+        std::vector<std::array<real_t *, 3>> faces(n_oct);
+
+#pragma omp parallel default(shared)
+        {
+            CurrentWorker cw(coarse_data_, &mesh_);
+
+            ArrayB1 t_flux(n_reg_);
+            t_flux = 0.0;
+
+            for (int ioct = 0; ioct < 8; ioct++) {
+                int first_ang = ioct * n_oct;
+                Angle angle   = ang_quad_[first_ang];
+                // Configure the current worker for this octant
+                cw.set_octant(angle);
+
+                bool flip_x = angle.ox < 0.0;
+                bool flip_y = angle.oy < 0.0;
+                bool flip_z = angle.oz < 0.0;
+
+// initialize upwind condition
+#pragma omp for
+                for (int ia = 0; ia < n_oct; ia++) {
+                    int iang     = first_ang + ia;
+                    Angle ang_bc = ang_quad_[iang];
+
+                    real_t *x_flux =
+                        bc_out_.get_face(0, iang, Normal::X_NORM).second;
+                    real_t *y_flux =
+                        bc_out_.get_face(0, iang, Normal::Y_NORM).second;
+                    real_t *z_flux =
+                        bc_out_.get_face(0, iang, Normal::Z_NORM).second;
+                    bc_in_.copy_face(group, iang, Normal::X_NORM, x_flux);
+                    bc_in_.copy_face(group, iang, Normal::Y_NORM, y_flux);
+                    bc_in_.copy_face(group, iang, Normal::Z_NORM, z_flux);
+
+                    cw.upwind_work(x_flux, y_flux, z_flux, ang_bc, group);
+
+                    faces[ia] = {{x_flux, y_flux, z_flux}};
+                }
+
+                for (int ip = 0; ip < n_plane; ip++) {
+                    int stt    = wavefront_offset_[ip];
+                    int n_cell = wavefront_offset_[ip + 1] - stt;
+
+#pragma omp for schedule(static)
+                    for (int iwork = 0; iwork < n_cell * n_oct; iwork++) {
+                        int ia   = iwork / n_cell;
+                        int iang = first_ang + ia;
+
+                        Angle ang = ang_quad_[iang];
+                        ThreadState t_state;
+                        t_state.iang    = iang;
+                        t_state.iang_2d = iang % (ang_quad_.ndir() / 2);
+                        t_state.angle   = ang;
+                        t_state.ox      = std::abs(ang.ox);
+                        t_state.oy      = std::abs(ang.oy);
+                        t_state.oz      = std::abs(ang.oz);
+
+                        real_t wgt = ang.weight * HPI;
+
+                        const Position &pos =
+                            wavefront_cells_[stt + iwork % n_cell];
+                        int ix = flip_x ? nx - 1 - pos.x : pos.x;
+                        int iy = flip_y ? ny - 1 - pos.y : pos.y;
+                        int iz = flip_z ? nz - 1 - pos.z : pos.z;
+
+                        t_state.ty         = t_state.oy / mesh_.dy(iy);
+                        t_state.tz         = t_state.oz / mesh_.dz(iz);
+                        t_state.macroplane = macroplanes_[iz];
+
+                        real_t *x_flux = faces[ia][0];
+                        real_t *y_flux = faces[ia][1];
+                        real_t *z_flux = faces[ia][2];
+
+                        auto &q = source_->get_transport(iang);
+
+                        // Gross. really need an Sn mesh abstraction
+                        real_t psi_x = x_flux[ny * iz + iy];
+                        real_t psi_y = y_flux[nx * iz + ix];
+                        real_t psi_z = z_flux[nx * iy + ix];
+
+                        int i = mesh_.coarse_cell(Position(ix, iy, iz));
+
+                        real_t psi = this->evaluate(psi_x, psi_y, psi_z, q[i],
+                                                    xstr_[i], i, t_state);
+
+                        x_flux[ny * iz + iy] = psi_x;
+                        y_flux[nx * iz + ix] = psi_y;
+                        z_flux[nx * iy + ix] = psi_z;
+
+                        t_flux(i) += psi * wgt;
+
+                        cw.current_work(x_flux[ny * iz + iy],
+                                        y_flux[nx * iz + ix],
+                                        z_flux[nx * iy + ix], i, ang, group);
+                    }
+                } // Diagonal planes
+
+                if (gs_boundary_) {
+#pragma omp for
+                    for (int ia = 0; ia < n_oct; ia++) {
+                        bc_in_.update(group, first_ang + ia, bc_out_);
+                    }
+                }
+            } // Octants
+
+// Update the boundary condition
+#pragma omp single
+            if (!gs_boundary_) {
+                bc_in_.update(group, bc_out_);
+            }
+
+// Reduce scalar flux
+#pragma omp critical
+            {
+                flux_1g_ += t_flux;
+            }
+        } // OMP Parallel
+
+        return;
+    } // sweep_1g_wavefront
+
     /**
      * \brief Generic Sn sweep procedure for 2-D orthogonal mesh.
      *
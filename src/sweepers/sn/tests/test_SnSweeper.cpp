@@ -0,0 +1,105 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "UnitTest++/UnitTest++.h"
+
+#include <cmath>
+#include <string>
+#include "pugixml.hpp"
+#include "util/blitz_typedefs.hpp"
+#include "util/global_config.hpp"
+#include "core/coarse_data.hpp"
+#include "core/core_mesh.hpp"
+#include "core/tests/pugi_utils.hpp"
+#include "sweepers/sn_sweeper_factory.hpp"
+#include "solvers/tests/inputs.hpp"
+
+using namespace mocc;
+
+// Sweep each group of the 3-D small problem once, from a flat fission source,
+// and store the resulting scalar flux and coarse currents
+void sweep_3d(const std::string &sweeper_attributes, ArrayB2 &flux,
+              ArrayB2 &current)
+{
+    std::string input = small_core_3d_geometry_xml +
+                        "<source scattering=\"P0\" />"
+                        "<sweeper type=\"sn\" n_inner=\"3\" " +
+                        sweeper_attributes +
+                        " >"
+                        "    <ang_quad type=\"ls\" order=\"4\" />"
+                        "</sweeper>";
+    auto xml = inline_xml(input.c_str());
+
+    CoreMesh mesh(*xml);
+    auto sweeper = SnSweeperFactory(xml->child("sweeper"), mesh);
+    auto source  = sweeper->create_source(xml->child("source"));
+    sweeper->assign_source(source.get());
+    CoarseData coarse_data(mesh, sweeper->n_group());
+    sweeper->set_coarse_data(&coarse_data);
+    sweeper->initialize();
+
+    ArrayB1 fission_source(sweeper->n_reg_fission());
+    fission_source = 0.0;
+    sweeper->calc_fission_source(1.0, fission_source);
+
+    for (int ig = 0; ig < sweeper->n_group(); ig++) {
+        source->initialize_group(ig);
+        source->fission(fission_source, ig);
+        source->in_scatter(ig);
+        sweeper->sweep(ig);
+    }
+
+    flux.resize(sweeper->flux().shape());
+    flux = sweeper->flux();
+    current.resize(coarse_data.current.shape());
+    current = coarse_data.current;
+    return;
+}
+
+// Wavefront sweeps visit the cells in a different order, but should produce
+// the same solution
+TEST(wavefront)
+{
+    ArrayB2 flux;
+    ArrayB2 current;
+    sweep_3d("", flux, current);
+
+    ArrayB2 wavefront_flux;
+    ArrayB2 wavefront_current;
+    sweep_3d("wavefront=\"t\"", wavefront_flux, wavefront_current);
+
+    REQUIRE CHECK_EQUAL(flux.size(), wavefront_flux.size());
+    for (int ig = 0; ig < (int)flux.extent(1); ig++) {
+        for (int i = 0; i < (int)flux.extent(0); i++) {
+            CHECK_CLOSE(flux(i, ig), wavefront_flux(i, ig),
+                        1.0e-10 * flux(i, ig));
+        }
+    }
+
+    REQUIRE CHECK_EQUAL(current.size(), wavefront_current.size());
+    real_t scale = max(abs(current));
+    for (int ig = 0; ig < (int)current.extent(1); ig++) {
+        for (int i = 0; i < (int)current.extent(0); i++) {
+            CHECK_CLOSE(current(i, ig), wavefront_current(i, ig),
+                        1.0e-10 * scale);
+        }
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
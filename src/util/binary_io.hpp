@@ -0,0 +1,89 @@
+/*
+   Copyright 2016 Mitchell Young
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace mocc {
+/**
+ * \brief Write the raw bytes of a trivially-copyable value to a binary stream
+ */
+template <typename T> void write_binary(std::ostream &os, const T &v)
+{
+    os.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+/**
+ * \brief Write the size of a vector, followed by its contents, to a binary
+ * stream
+ */
+template <typename T>
+void write_binary(std::ostream &os, const std::vector<T> &v)
+{
+    write_binary(os, (uint64_t)v.size());
+    os.write(reinterpret_cast<const char *>(v.data()), sizeof(T) * v.size());
+}
+
+/**
+ * \brief Read a trivially-copyable value from a binary stream
+ *
+ * The value is value-initialized, so a failed read yields zero rather than
+ * garbage. Check the stream state after reading.
+ */
+template <typename T> T read_binary(std::istream &is)
+{
+    T v{};
+    is.read(reinterpret_cast<char *>(&v), sizeof(T));
+    return v;
+}
+
+/**
+ * \brief Read a vector written by \ref write_binary() from a binary stream
+ *
+ * \param is the stream to read from
+ * \param v the vector to read into
+ * \param max_bytes an upper bound on the size of the stored data, usually
+ * the size of the file being read
+ *
+ * If the stream is already in a failed state, the stored size cannot be
+ * read, or the stored size exceeds \p max_bytes, the vector is cleared and
+ * the failbit is set; nothing is allocated on the basis of a corrupt size.
+ * Passing the bound in, rather than asking the stream how much is left,
+ * avoids seeking around the stream for every vector.
+ */
+template <typename T>
+void read_binary(std::istream &is, std::vector<T> &v, uint64_t max_bytes)
+{
+    v.clear();
+    uint64_t n = read_binary<uint64_t>(is);
+    if (!is) {
+        return;
+    }
+    if (n > max_bytes / sizeof(T)) {
+        is.setstate(std::ios::failbit);
+        return;
+    }
+    v.resize(n);
+    is.read(reinterpret_cast<char *>(v.data()), sizeof(T) * v.size());
+    if (!is) {
+        v.clear();
+    }
+}
+}
@@ -149,6 +149,29 @@ void H5Node::write(std::string path, const VecF &data, VecI dims)
     return;
 }
 
+void H5Node::write(std::string path, const VecI &data, VecI dims)
+{
+    std::vector<hsize_t> dims_a(dims.begin(), dims.end());
+    int size = 1;
+    for (auto d : dims) {
+        size *= d;
+    }
+    assert(size == (int)data.size());
+
+    try {
+        H5::DataSpace space(dims_a.size(), dims_a.data());
+        H5::DataSet dataset =
+            node_->createDataSet(path, H5::PredType::NATIVE_INT, space);
+        dataset.write(data.data(), H5::PredType::NATIVE_INT);
+    } catch (...) {
+        std::stringstream msg;
+        msg << "Failed to write dataset: " << path;
+        throw EXCEPT(msg.str().c_str());
+    }
+
+    return;
+}
+
 void H5Node::write(std::string path, const ArrayB1 &data, VecI dims)
 {
     if (!data.isStorageContiguous()) {
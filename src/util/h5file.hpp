@@ -137,6 +137,12 @@ public:
      */
     void write(std::string path, const VecF &data, VecI dims);
 
+    /**
+     * \brief Write an std::vector<int> to the file, using specified
+     * dimensions.
+     */
+    void write(std::string path, const VecI &data, VecI dims);
+
     void write(std::string path, const std::string &str);
 
     /**
@@ -25,3 +25,30 @@
 #include "omp_stubs.h"
 
 #endif
+
+#include <algorithm>
+
+namespace mocc {
+/**
+ * \brief Allow at least a given number of nested active parallel regions
+ * for the lifetime of the object, restoring the old setting afterwards.
+ *
+ * Use this around nested parallel regions, rather than changing the setting
+ * for the rest of the program.
+ */
+class ScopedActiveLevels {
+public:
+    ScopedActiveLevels(int levels) : old_levels_(omp_get_max_active_levels())
+    {
+        omp_set_max_active_levels(std::max(old_levels_, levels));
+    }
+
+    ~ScopedActiveLevels()
+    {
+        omp_set_max_active_levels(old_levels_);
+    }
+
+private:
+    int old_levels_;
+};
+}